@@ -0,0 +1,376 @@
+/*************************************************************************************************************************************
+ * @file balance_core.h
+ * @author va3wam
+ * @brief Numeric core of the balance by angle method, usable with float or with Q16.16 fixed point numbers
+ * @details balanceByAngle() in main.cpp hands the current tilt to balanceCore<>::step() and gets back the motor speed, as the
+ *          number of 20uS timer ticks per step. The number type is picked at compile time by controlFixedPoint in main.cpp.
+ *          With float, the math is the same as it always was. With q16, the tilt comes straight from the DMP's Q30 quaternion
+ *          integers, and nothing between the IMU and the tick setting does a floating point divide.
+ * @version 0.0.9
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.9   2026-10-16 balanceParams<>: the whole set of control params, tables and filter designs, built in the background
+ *                    and load()ed into balanceCore<> between steps. balanceCore<> no longer rebuilds its tables in place
+ * 0.0.8   2026-10-16 speedTable & speedForPid(), steps per second for each ticksTable entry, for the gain schedule
+ * 0.0.7   2026-10-16 tiltFromQ14() works out only the roll from a float path quaternion, optionally with polyAtan2Deg()
+ * 0.0.6   2026-10-16 Batched mode: sample() runs the tilt filter bank and D filter on every DMP sample, step() uses the result
+ * 0.0.5   2026-10-16 ticksForPid() split out of step(), so the relay autotuner can drive the motors through the same table
+ * 0.0.4   2026-10-16 Optional biquad filter banks (biquad.h) on the tilt going in, and on the D part
+ * 0.0.3   2026-10-16 D part can use the DMP's gyro rate, through an optional first order filter, instead of error differences
+ * 0.0.2   2026-10-16 Map pid onto motor ticks with a table built by buildTicksTable(), instead of the formula every cycle
+ * 0.0.1   2026-10-16 Include file created, with PID error ring buffer moved in from main.cpp
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef balanceCore_h
+#define balanceCore_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+#include <biquad.h> // low pass and notch filter sections, for tiltBank and dBank
+// our own creation
+
+#define errHistorySize 200   // capacity of errHistory ring buffer, and so the upper limit for pidICount
+#define errResumCycles 1000  // re-add the whole window this often, so rounding in errSum can't build up
+#define pidLimit 400         // pid is range limited to +/- this, and ticksTable has an entry for each whole number up to it
+#define gyroLsbPerDegSec 16.4  // dmpInitialize() sets the gyro to +/-2000 deg/sec full scale
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Signed Q16.16 fixed point number: 16 bits of whole number, 16 bits of fraction, range about +/-32767
+/// @note  Products are done in 64 bits and saturate rather than wrap. Only conversions from float touch the FPU,
+///        and those happen when control params are loaded, not per cycle
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct q16
+{
+   int32_t raw;                                            // value times 65536
+   q16() : raw(0) {}
+   q16(int i) : raw(i * 65536) {}
+   explicit q16(float f) : raw((int32_t)(f * 65536.0f)) {}
+   static q16 fromRaw(int64_t r)                           // build from a raw value, saturating at the int32 limits
+   {  q16 v;
+      v.raw = r > INT32_MAX ? INT32_MAX : (r < INT32_MIN ? INT32_MIN : (int32_t)r);
+      return v;
+   }
+   q16 operator+(q16 b) const { return fromRaw((int64_t)raw + b.raw); }
+   q16 operator-(q16 b) const { return fromRaw((int64_t)raw - b.raw); }
+   q16 operator-() const { return fromRaw(-(int64_t)raw); }
+   q16 operator*(q16 b) const { return fromRaw(((int64_t)raw * b.raw) >> 16); }
+   q16 operator/(int n) const { return fromRaw(raw / n); }  // integer divide, e.g. averaging a sum
+   q16& operator+=(q16 b) { *this = *this + b; return *this; }
+   q16& operator-=(q16 b) { *this = *this - b; return *this; }
+   bool operator< (q16 b) const { return raw <  b.raw; }
+   bool operator> (q16 b) const { return raw >  b.raw; }
+   bool operator<=(q16 b) const { return raw <= b.raw; }
+   bool operator>=(q16 b) const { return raw >= b.raw; }
+   bool operator==(q16 b) const { return raw == b.raw; }
+   bool operator!=(q16 b) const { return raw != b.raw; }
+};
+
+// conversions that work the same way for either number type, so templated code doesn't care which one it has
+inline float ctlToFloat(float v) { return v; }
+inline float ctlToFloat(q16 v)   { return v.raw * (1.0f / 65536.0f); }
+inline int   ctlToInt(float v)   { return int(v); }          // truncates towards zero
+inline int   ctlToInt(q16 v)     { return v.raw / 65536; }   // also truncates towards zero
+inline int   ctlAbsRound(float v) { return int((v < 0 ? -v : v) + 0.5f); }               // nearest whole number to |v|
+inline int   ctlAbsRound(q16 v)   { return (int)(((v.raw < 0 ? -(int64_t)v.raw : v.raw) + 32768) >> 16); }
+
+// raw gyro reading to degrees per millisecond, the same units as the error slope the D part used to be based on
+inline void rateFromGyro(float &rate, int16_t raw) { rate = raw * (1.0f / (gyroLsbPerDegSec * 1000)); }
+inline void rateFromGyro(q16 &rate, int16_t raw)   { rate = q16::fromRaw((int64_t)raw * 65536 / (int)(gyroLsbPerDegSec * 1000)); }
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Robot tilt in degrees from the DMP's Q30 quaternion, without any floating point
+/// @param qI quaternion [w, x, y, z] as read by mpu.dmpGetQuaternion(int32_t*), 1.0 = 2^30
+/// @return tilt, using the same convention as readIMU(): roll - 90 degrees, with values past -180 folded to +90
+/// @note  gravity y & z are the same formulas as dmpGetGravity(), and roll = atan2(gravity y, gravity z) is done with
+///        16 iterations of CORDIC, good to about 0.002 degrees
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline q16 tiltFromQ30(const int32_t *qI)
+{
+   static const int32_t cordicAtan[16] =                     // atan(2^-i) in degrees, Q16.16
+   { 2949120, 1740967, 919879, 466945, 234379, 117304, 58666, 29335, 14668, 7334, 3667, 1833, 917, 458, 229, 115 };
+   int64_t w = qI[0], x = qI[1], y = qI[2], z = qI[3];
+   // gravity in Q30, then down to Q28 so CORDIC's gain of 1.65 can't overflow 32 bits
+   int32_t gy = (int32_t)(((w * x + y * z) >> 29) >> 2);     // 2 * (wx + yz)
+   int32_t gz = (int32_t)(((w * w - x * x - y * y + z * z) >> 30) >> 2);
+   int32_t angle = 0;                                        // accumulated rotation, degrees Q16.16
+   if (gz < 0)                                               // CORDIC only converges within +/-90, so flip into that half
+   {  angle = gy >= 0 ? 180 * 65536 : -180 * 65536;
+      gy = -gy;
+      gz = -gz;
+   }
+   for (int i = 0; i < 16; i++)                              // rotate (gz, gy) onto the x axis, adding up the angles used
+   {  int32_t nz;
+      if (gy > 0) { nz = gz + (gy >> i); gy -= gz >> i; angle += cordicAtan[i]; }
+      else        { nz = gz - (gy >> i); gy += gz >> i; angle -= cordicAtan[i]; }
+      gz = nz;
+   }
+   if (angle > 180 * 65536) angle -= 360 * 65536;            // keep roll in the (-180, 180] range that atan2 returns
+   q16 tilt = q16::fromRaw((int64_t)angle - 90 * 65536);     // same adjustment as readIMU's float path
+   if (tilt < q16(-180)) tilt = q16(90);                     // avoid abrupt change from +90 to -270, past a face plant
+   return tilt;
+} // tiltFromQ30()
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief atan2(y, x) in degrees from a polynomial, good to about 0.001 degrees all the way round
+/// @note  Folding by octant leaves atan(t) for t in 0..1, which a 9th order odd minimax polynomial covers. One divide,
+///        and no library calls. Returns (-180, 180], and 0 for (0, 0)
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline float polyAtan2Deg(float y, float x)
+{
+   float ax = fabsf(x), ay = fabsf(y);
+   if (ax == 0 && ay == 0) return 0;
+   bool steep = ay > ax;                                     // past 45 degrees, so work out the angle from the y axis
+   float t = steep ? ax / ay : ay / ax;
+   float t2 = t * t;
+   float a = t * (57.28810f + t2 * (-18.92477f + t2 * (10.32132f + t2 * (-4.877762f + t2 * 1.193763f))));
+   if (steep) a = 90 - a;
+   if (x < 0) a = 180 - a;
+   return y < 0 ? -a : a;
+} // polyAtan2Deg()
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Robot tilt in degrees from the DMP's Q14 quaternion, working out only the roll that balancing uses
+/// @param qI quaternion [w, x, y, z] as read by mpu.dmpGetQuaternion(int16_t*), 1.0 = 2^14
+/// @param polyAtan2 true to use polyAtan2Deg(), false for atan2f()
+/// @return tilt, the same as dmpGetGravity() then dmpGetYawPitchRoll() gave readIMU(): roll - 90 degrees, with values
+///         past -180 folded to +90
+/// @note  gravity y & z are dmpGetGravity()'s formulas on the integers. atan2 doesn't care about scale, so there's no
+///        conversion to 1.0, and yaw, pitch and their sqrt aren't worked out at all. One atan2 is all the float work
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline float tiltFromQ14(const int16_t *qI, bool polyAtan2)
+{
+   int32_t w = qI[0], x = qI[1], y = qI[2], z = qI[3];
+   float gy = (float)(2 * ((int64_t)(w * x) + y * z));       // sums in 64 bits, in case the DMP hands over a bad packet
+   float gz = (float)((int64_t)(w * w) - x * x - y * y + z * z);
+   float roll = polyAtan2 ? polyAtan2Deg(gy, gz) : atan2f(gy, gz) * RAD_TO_DEG;
+   float tilt = roll - 90;                                   // same adjustment as tiltFromQ30()
+   if (tilt < -180) tilt = 90;                               // avoid abrupt change from +90 to -270, past a face plant
+   return tilt;
+} // tiltFromQ14()
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Map a range checked PID value onto a signed motor interval in 20uS timer ticks
+/// @note  Only used by balanceParams<>::buildTicksTable(), when slowTicks, fastTicks or wheel geometry change.
+///        The float version is the original ground speed formula. The q16 version is the same thing with
+///        distancePerTick cancelled out: ticks = slow*fast*395 / ((|pid|-5)*slow + (400-|pid|)*fast), an integer divide.
+///        It still takes distancePerTick, unused, so buildTicksTable() can make the same call for either number type
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline int ticksFromPid(float pid, int slowTicks, int fastTicks, float distancePerTick)
+{
+   float minGroundSpeed = distancePerTick / ( 20 * .000001 * slowTicks);
+   float maxGroundSpeed = distancePerTick / ( 20 * .000001 * fastTicks);
+   float groundSpeed = 0;  // setting value avoids compiler nagging
+
+   if(pid > 0) { groundSpeed = ((pid-5)/395) * (maxGroundSpeed - minGroundSpeed) + minGroundSpeed; }
+   if(pid < 0) { groundSpeed = ((pid+5)/395) * (maxGroundSpeed - minGroundSpeed) - minGroundSpeed; }
+   if(pid == 0 || groundSpeed == 0) { return 0; }
+   return int( distancePerTick / groundSpeed / .000020 );
+} // ticksFromPid(float)
+
+inline int ticksFromPid(q16 pid, int slowTicks, int fastTicks, float)   // distancePerTick cancels out, see above
+{
+   if (pid == q16(0)) return 0;
+   int64_t mag = pid.raw < 0 ? -(int64_t)pid.raw : pid.raw;  // |pid| in Q16.16, between 5 and 400 after range checks
+   int64_t den = (mag - 5 * 65536) * slowTicks + (400 * 65536 - mag) * fastTicks;
+   if (den <= 0) return 0;
+   int ticks = (int)(((int64_t)slowTicks * fastTicks * 395 * 65536) / den);
+   return pid.raw < 0 ? -ticks : ticks;
+} // ticksFromPid(q16)
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Control params for balanceCore<>, with the pid to motor ticks tables and the filter bank designs worked out
+/// @note  loadBalanceCore() fills one in, then hands it to controlTask through a commandBlock, and controlTask load()s it
+///        between steps. So step() never sees an iCount that hasn't been range checked yet, or a half rebuilt table
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename num> struct balanceParams
+{
+   num pGain;                   // see balanceCore<> for what each of these does
+   num iGain;
+   num dGain;
+   int iCount = 0;              // 0 .. errHistorySize
+   bool selectiveI = false;
+   num perMsec;
+   bool dFromGyro = false;
+   num dWeight;
+   num sampleWeight;
+   num targetAngle;
+   num smoother;
+   int slowTicks = 0;
+   int fastTicks = 0;
+   float distancePerTick = 0;
+   int ticksTable[pidLimit + 1];
+   num speedTable[pidLimit + 1];
+   biquadBankDesign tiltFilters; // for tiltBank
+   biquadBankDesign dFilters;   // for dBank
+
+   void buildTicksTable()       // fill ticksTable & speedTable from slowTicks, fastTicks & distancePerTick. Dead band is 0
+   {  for (int p = 0; p <= pidLimit; p++)
+      {  ticksTable[p] = p < 5 ? 0 : ticksFromPid(num(p), slowTicks, fastTicks, distancePerTick);
+         speedTable[p] = ticksTable[p] > 0 ? num(1000000.0f / (20 * ticksTable[p])) : num(0);   // 20 uS ticks
+      }
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief PID state and math for balance by angle, for either number type
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename num> struct balanceCore
+{
+   // control params, load()ed from the balanceParams<> loadBalanceCore() builds whenever they change
+   num pGain;                   // multiplier for the P part of PID
+   num iGain;                   // multiplier for the I part of PID
+   num dGain;                   // multiplier for the D part of PID
+   int iCount = 0;              // number of recent errors to include in I part of PID, at most errHistorySize
+   bool selectiveI = false;     // only use the I in PID if it pushes us towards vertical
+   num perMsec;                 // 1 / tmrIMU, so the D slope is a multiply
+   bool dFromGyro = false;      // D part from measured tiltRate (true) or from the last two errors (false)
+   num dWeight;                 // weight of newest tiltRate in the D filter. 1 = no filtering
+   num targetAngle;             // angle we're aiming for
+   num smoother;                // new = old + smoother * (new - old). 0 disables smoothing
+   int slowTicks = 0;           // timer ticks per step at slowest practical speed
+   int fastTicks = 0;           // timer ticks per step at fastest practical speed
+   float distancePerTick = 0;   // wheel travel per step, only needed by the float tick mapping
+   int ticksTable[pidLimit + 1];  // motor ticks for |pid| = 0 .. pidLimit, so the per cycle mapping is one indexed load
+   num speedTable[pidLimit + 1];  // steps per second for each ticksTable entry, so the gain schedule doesn't divide per cycle
+   biquadBank<num> tiltBank;    // filters tilt before anything else uses it. All sections off = raw tilt, as before
+   biquadBank<num> dBank;       // filters the D part's slope or rate, after the dWeight filter
+   bool batched = false;        // tiltBank and the dWeight filter run in sample(), once per DMP sample, not in step()
+   num sampleWeight;            // weight of each sample's tiltRate in the D filter when batched, the same smoothing as dWeight
+
+   // input, set by readIMU()
+   num tilt;                    // forward/backward angle of robot, in degrees
+   num tiltRate;                // rate tilt is changing, from the gyro, in degrees per millisecond
+   num filteredTilt;            // tiltBank's output for the newest sample(), when batched
+
+   // ring buffer of remembered angle errors, with a running sum, so I and D cost the same whatever iCount is
+   // with q16, the sum stays in range because bs_active ends at maxAngleMotorActive degrees: 200 * 30 < 32767
+   num errHistory[errHistorySize];
+   int errNewest = 0;           // index in errHistory of most recently remembered error
+   int errCount = 0;            // number of remembered errors in the running sum, never more than iCount
+   num errSum;                  // running sum of the last errCount remembered errors
+   int errResumCountdown = errResumCycles;  // cycles left before next full resum of errSum
+
+   // results of the last step(), kept for telemetry
+   num angleErr;                // difference between current angle and target angle
+   num pidRaw;                  // PID before range checking
+   num pid;                     // PID after range checking and dead band
+   num pidISum;                 // the I part of PID, average of remembered errors
+   num pidDSlope;               // the D part of PID, error slope per millisecond
+   num dRate;                   // filtered tiltRate, the D filter's memory
+   int motorTicks = 0;          // signed interval between steps in timer ticks
+
+   void resetErrHistory()       // zero remembered errors, keeping the count. Zeros still count as history
+   {  for (int t = 0; t < errHistorySize; t++) errHistory[t] = num(0);
+      errSum = num(0);
+      dRate = tiltRate;         // D filter starts from where we are, not from 0
+      tiltBank.prime(tilt);     // and so do the filter banks
+      filteredTilt = tilt;
+      dBank.prime(dFromGyro ? tiltRate : num(0));
+      errResumCountdown = errResumCycles;
+   }
+
+   void pushErrHistory(num err) // O(1): the oldest error drops out of the sum as the newest goes in
+   {  int window = iCount;
+      int newest = (errNewest + 1) % errHistorySize;
+      if (errCount >= window)                                    // window full, so oldest error drops out of the sum
+      {  errSum -= errHistory[(newest - window + errHistorySize) % errHistorySize];
+      }                                                          // (read before write, in case window == errHistorySize)
+      else errCount ++;
+      errHistory[newest] = err;
+      errSum += err;
+      errNewest = newest;
+
+      errResumCountdown --;
+      if (errCount > window || errResumCountdown <= 0)          // iCount was lowered, or it's time to clean up drift
+      {  if (errCount > window) errCount = window;
+         num sum = num(0);
+         for (int t = 0; t < errCount; t++) sum += errHistory[(newest - t + errHistorySize) % errHistorySize];
+         errSum = sum;
+         errResumCountdown = errResumCycles;
+      }
+   }
+
+   void load(const balanceParams<num> &p)   // a new set of control params. Only between steps, from the task that runs them
+   {  pGain = p.pGain;
+      iGain = p.iGain;
+      dGain = p.dGain;
+      iCount = p.iCount;
+      selectiveI = p.selectiveI;
+      perMsec = p.perMsec;
+      dFromGyro = p.dFromGyro;
+      dWeight = p.dWeight;
+      sampleWeight = p.sampleWeight;
+      targetAngle = p.targetAngle;
+      smoother = p.smoother;
+      slowTicks = p.slowTicks;
+      fastTicks = p.fastTicks;
+      distancePerTick = p.distancePerTick;
+      for (int n = 0; n <= pidLimit; n++)
+      {  ticksTable[n] = p.ticksTable[n];
+         speedTable[n] = p.speedTable[n];
+      }
+      tiltBank.load(p.tiltFilters);
+      dBank.load(p.dFilters);
+   }
+
+   num speedForPid(num p)       // |steps per second| ticksForPid(p) asks for
+   {  return speedTable[ctlAbsRound(p)];
+   }
+
+   int ticksForPid(num p)       // speed for the nearest whole |p|, with sign put back. p has to be range checked already
+   {  int ticks = ticksTable[ctlAbsRound(p)];
+      return p < num(0) ? -ticks : ticks;
+   }
+
+   void sample(num t, num rate) // one DMP sample, oldest first, when batched. Sets tilt and tiltRate to it, as readIMU() would
+   {  tilt = t;
+      tiltRate = rate;
+      filteredTilt = tiltBank.step(t);
+      dRate += sampleWeight * (rate - dRate);
+   }
+
+   int step(int lastSpeed)      // one PID cycle on the current tilt. Returns the new motorTicks
+   {  if (!batched) filteredTilt = tiltBank.step(tilt);
+      angleErr = filteredTilt - targetAngle;                     // difference between current (filtered) and desired angles
+      pid = pGain * angleErr;                                    // P part
+
+      num prevErr = errHistory[errNewest];                       // previous error for D, before it's pushed down the ring
+      pidISum = num(0);
+      if (iCount > 0)                                            // I part = average of recent errors, including this one
+      {  pushErrHistory(angleErr);
+         pidISum = errSum / errCount;
+      }
+      if (!selectiveI || angleErr * pidISum > num(0)) pid += iGain * pidISum;
+
+      pidDSlope = num(0);
+      if (dFromGyro)                                             // D part = measured tilt rate, optionally low pass filtered
+      {  if (!batched) dRate += dWeight * (tiltRate - dRate);   // rate of tilt, not of error, so the outer loop moving targetAngle doesn't kick it
+         pidDSlope = dRate;
+      }
+      else if (iCount >= 2) pidDSlope = (angleErr - prevErr) * perMsec;  // or slope between current and last errors
+      pidDSlope = dBank.step(pidDSlope);
+      pid += dGain * pidDSlope;
+
+      pidRaw = pid;
+      if (pid > num(pidLimit)) pid = num(pidLimit);              // range limit pid
+      if (pid < num(-pidLimit)) pid = num(-pidLimit);
+      if (pid < num(5) && pid > num(-5)) pid = num(0);           // dead band to stop motors when robot is balanced
+
+      motorTicks = ticksForPid(pid);
+      if (smoother != num(0))                                    // smooth changes in speed, if enabled
+      {  motorTicks = ctlToInt(num(lastSpeed) + smoother * num(motorTicks - lastSpeed));
+      }
+      return motorTicks;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,145 @@
+/*************************************************************************************************************************************
+ * @file biquad.h
+ * @author va3wam
+ * @brief Include file with a bank of biquad filter sections, for smoothing balanceCore's tilt and D inputs
+ * @details Each section is a second order low pass or notch filter, with coefficients worked out on the robot from a cutoff
+ *          (or notch) frequency and Q, using the formulas from Robert Bristow-Johnson's Audio EQ Cookbook. Sections run
+ *          one after the other, up to bqSections of them, in direct form II transposed: 5 multiplies and 2 remembered
+ *          values per section, and no divides. Like balanceCore, the bank works in float or q16.
+ *          A bank is only ever touched by the task that step()s it. Designs made anywhere else go into a biquadBankDesign,
+ *          which can be handed over whole with a commandBlock (step_command.h) and load()ed between steps.
+ *          With q16, coefficients only have 16 fraction bits, so a low pass much below 1/50 of the sample rate gets coarse.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * @ref https://www.w3.org/TR/audio-eq-cookbook/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.2   2026-10-16 biquadBankDesign, so a whole bank's design can be handed to the task that runs it, and load() there
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef biquad_h
+#define biquad_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define bqSections 4            // most sections in one bank
+   // values for a section's type
+   #define bq_off 0             // section passes its input straight through
+   #define bq_lowPass 1         // second order low pass at hz. Q 0.707 is Butterworth, i.e. flat with no peak
+   #define bq_notch 2           // cuts out hz, e.g. a wobble. Higher Q is a narrower notch
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief One section's coefficients, already divided through by a0
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   float b0, b1, b2;
+   float a1, a2;
+} biquadCoeffs;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Design for a whole bank: which sections are on, and their coefficients
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   bool on[bqSections];
+   biquadCoeffs c[bqSections];  // only meaningful where on[] is true
+} biquadBankDesign;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Work out a section's coefficients
+/// @param sampleHz how often the bank's step() gets called
+/// @return false if the section should be off: bq_off, an unknown type, or hz or q out of range
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline bool biquadDesign(int type, float hz, float q, float sampleHz, biquadCoeffs &c)
+{
+   if (type != bq_lowPass && type != bq_notch) return false;
+   if (hz <= 0 || hz >= sampleHz / 2 || q <= 0) return false;   // has to be below Nyquist
+   float w0 = 2 * PI * hz / sampleHz;
+   float cosW0 = cosf(w0);
+   float alpha = sinf(w0) / (2 * q);
+   float a0 = 1 + alpha;
+   if (type == bq_lowPass)
+   {  c.b0 = (1 - cosW0) / 2 / a0;
+      c.b1 = (1 - cosW0) / a0;
+      c.b2 = c.b0;
+   }
+   else
+   {  c.b0 = 1 / a0;
+      c.b1 = -2 * cosW0 / a0;
+      c.b2 = c.b0;
+   }
+   c.a1 = -2 * cosW0 / a0;
+   c.a2 = (1 - alpha) / a0;
+   return true;
+} // biquadDesign()
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Cascade of up to bqSections biquads, for either number type
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename num> struct biquadBank
+{
+   bool on[bqSections] = {};    // sections that are filtering. Off ones pass their input through
+   num b0[bqSections], b1[bqSections], b2[bqSections], a1[bqSections], a2[bqSections];
+   num dcGain[bqSections];      // output / input once settled, for prime()
+   num s1[bqSections], s2[bqSections];  // direct form II transposed memory
+   num input[bqSections];       // last thing fed to each section, off or on, so a section turned on can start from there
+
+   void set(int n, bool enable, const biquadCoeffs &c)   // new coefficients for section n. Between step()s, in the same task
+   {  bool wasOn = on[n];
+      on[n] = false;
+      if (!enable) return;
+      b0[n] = num(c.b0);
+      b1[n] = num(c.b1);
+      b2[n] = num(c.b2);
+      a1[n] = num(c.a1);
+      a2[n] = num(c.a2);
+      dcGain[n] = num((c.b0 + c.b1 + c.b2) / (1 + c.a1 + c.a2));
+      if (!wasOn) primeSection(n, input[n]);   // otherwise it would start from 0, and kick balancing
+      on[n] = true;
+   }
+
+   void load(const biquadBankDesign &d)   // every section at once
+   {  for (int n = 0; n < bqSections; n++) set(n, d.on[n], d.c[n]);
+   }
+
+   void primeSection(int n, num x)   // memory as if x had been going in for ever
+   {  num y = x * dcGain[n];
+      s2[n] = b2[n] * x - a2[n] * y;
+      s1[n] = b1[n] * x - a1[n] * y + s2[n];
+   }
+
+   void prime(num x)            // whole bank, e.g. when balancing starts
+   {  for (int n = 0; n < bqSections; n++)
+      {  input[n] = x;
+         if (on[n])
+         {  primeSection(n, x);
+            x = x * dcGain[n];
+         }
+      }
+   }
+
+   num step(num x)              // one sample through every section that's on
+   {  for (int n = 0; n < bqSections; n++)
+      {  input[n] = x;
+         if (!on[n]) continue;
+         num y = b0[n] * x + s1[n];
+         s1[n] = b1[n] * x - a1[n] * y + s2[n];
+         s2[n] = b2[n] * x - a2[n] * y;
+         x = y;
+      }
+      return x;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,130 @@
+/*************************************************************************************************************************************
+ * @file gain_schedule.h
+ * @author va3wam
+ * @brief Include file with a 2-D schedule of PID gains, looked up by how far we're leaning and how fast the wheels are going
+ * @details One set of P, I and D gains can be tuned for standing still near vertical, or for catching a big lean, but not both.
+ *          The schedule has P, I and D at every point of a gsTilts x gsSpeeds grid, and balanceByAngle() interpolates
+ *          between the 4 points around the current |tilt error| and |wheel speed| (bilinear interpolation). Outside the grid
+ *          it uses the nearest edge.
+ *          The grid arrives over MQTT as one binary gainTable (see gainTableFromBlob() for the layout). It's checked, then
+ *          handed to controlTask through a commandBlock, so balanceByAngle() picks up a whole new table between cycles,
+ *          never half of one. load() does the one-off work: converting to the control number type and working out
+ *          1 / spacing between grid points, so lookup() is a few compares and multiplies and no divides.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.2   2026-10-16 Blob layout documented as it is: 4 byte header 'G' 'S' gsVersion 0, where the last byte is padding.
+ *                    gainTableFromBlob() now turns down a blob whose padding byte isn't 0
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef gainSchedule_h
+#define gainSchedule_h
+
+#include <balance_core.h> // q16 and conversions, so the schedule works in the same number type as balanceCore
+// our own creation
+
+#define gsTilts 4               // grid points along the |tilt error| axis
+#define gsSpeeds 4              // grid points along the |wheel speed| axis
+#define gsP 0                   // index of each gain in gainTable.gain
+#define gsI 1
+#define gsD 2
+#define gsGains 3
+#define gsMagic0 'G'            // first bytes of a gainTable blob, so a stray message isn't taken for one
+#define gsMagic1 'S'
+#define gsVersion 1             // blob layout version
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Gain schedule as it comes over MQTT, in float
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   float tilt[gsTilts];                      // |tilt error| at each grid point, degrees, increasing
+   float speed[gsSpeeds];                    // |wheel speed| at each grid point, steps/second, increasing
+   float gain[gsGains][gsTilts][gsSpeeds];   // P, I and D at each grid point
+} gainTable;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Unpack and check a gainTable blob
+/// @details Layout, little endian as the ESP32 is: a 4 byte header, 'G' 'S', then gsVersion (currently 1), then a 0 byte
+///          of padding, so the floats after it start 4 bytes in. Then the gainTable floats in order: tilt axis, speed axis,
+///          then P, I and D grids, each tilt major. Axes have to be strictly increasing, gains finite
+/// @return NULL if the table is good, otherwise what's wrong with it, for the event message
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline const char *gainTableFromBlob(const uint8_t *blob, size_t len, gainTable &t)
+{
+   if (len != 4 + sizeof(gainTable)) return "wrong length";
+   if (blob[0] != gsMagic0 || blob[1] != gsMagic1) return "not a gain table";
+   if (blob[2] != gsVersion) return "wrong version";
+   if (blob[3] != 0) return "bad header padding";
+   memcpy(&t, blob + 4, sizeof(gainTable));
+   const float *f = (const float *)&t;
+   for (size_t n = 0; n < sizeof(gainTable) / sizeof(float); n++) if (!std::isfinite(f[n])) return "bad number";
+   for (int k = 1; k < gsTilts; k++) if (!(t.tilt[k] > t.tilt[k - 1])) return "tilt axis not increasing";
+   for (int k = 1; k < gsSpeeds; k++) if (!(t.speed[k] > t.speed[k - 1])) return "speed axis not increasing";
+   return NULL;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Gain schedule ready for lookup() in the control number type. Only touched by controlTask
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename num> struct gainSchedule
+{
+   bool loaded = false;                      // false until the first table arrives
+   num tilt[gsTilts];
+   num tiltSpan[gsTilts];                    // 1 / (tilt[k + 1] - tilt[k])
+   num speed[gsSpeeds];
+   num speedSpan[gsSpeeds];                  // 1 / (speed[k + 1] - speed[k])
+   num gain[gsGains][gsTilts][gsSpeeds];
+
+   void load(const gainTable &t)
+   {  for (int k = 0; k < gsTilts; k++)
+      {  tilt[k] = num(t.tilt[k]);
+         tiltSpan[k] = k + 1 < gsTilts ? num(1.0f / (t.tilt[k + 1] - t.tilt[k])) : num(0);
+      }
+      for (int k = 0; k < gsSpeeds; k++)
+      {  speed[k] = num(t.speed[k]);
+         speedSpan[k] = k + 1 < gsSpeeds ? num(1.0f / (t.speed[k + 1] - t.speed[k])) : num(0);
+      }
+      for (int g = 0; g < gsGains; g++)
+         for (int a = 0; a < gsTilts; a++)
+            for (int b = 0; b < gsSpeeds; b++) gain[g][a][b] = num(t.gain[g][a][b]);
+      loaded = true;
+   }
+
+   static int locate(const num *axis, const num *span, int n, num v, num &w)  // grid cell v is in, and how far across, 0..1
+   {  if (v <= axis[0]) { w = num(0); return 0; }
+      if (v >= axis[n - 1]) { w = num(1); return n - 2; }
+      int k = 0;
+      while (v >= axis[k + 1]) k++;
+      w = (v - axis[k]) * span[k];
+      return k;
+   }
+
+   void lookup(num absTilt, num absSpeed, num &p, num &i, num &d) const  // interpolated gains at this tilt and speed
+   {  num wt, ws;
+      int a = locate(tilt, tiltSpan, gsTilts, absTilt, wt);
+      int b = locate(speed, speedSpan, gsSpeeds, absSpeed, ws);
+      num out[gsGains];
+      for (int g = 0; g < gsGains; g++)
+      {  num lo = gain[g][a][b] + ws * (gain[g][a][b + 1] - gain[g][a][b]);         // along speed, at the lower tilt
+         num hi = gain[g][a + 1][b] + ws * (gain[g][a + 1][b + 1] - gain[g][a + 1][b]);  // and at the upper tilt
+         out[g] = lo + wt * (hi - lo);                                                  // then along tilt
+      }
+      p = out[gsP];
+      i = out[gsI];
+      d = out[gsD];
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,180 @@
+/*************************************************************************************************************************************
+ * @file i2c_async.h
+ * @author va3wam
+ * @brief Include file with an asynchronous I2C transaction engine on the ESP-IDF I2C driver, for the IMU's bus
+ * @details Wire makes whoever calls it wait out the whole bus transfer, about a millisecond at 400 kHz for a couple of DMP
+ *          packets. Here a transaction is an i2cTxn the caller owns: register address, bytes to write after it, and/or
+ *          bytes to read back after a repeated start. submit() puts it on a FreeRTOS queue and returns straight away. A bus
+ *          task sitting in run() takes transactions off the queue one at a time, builds an ESP-IDF command link for each and
+ *          hands it to i2c_master_cmd_begin(), which waits on the driver's interrupt, not the CPU.
+ *          When a transaction's over, its complete() callback is called in the bus task. The callback can change the
+ *          transaction and return true to have it go again straight away, ahead of anything else queued, so a read that
+ *          depends on the last one, e.g. FIFO count then FIFO data, chains without the caller waking up in between. After
+ *          that, the done semaphore (if any) is given, so the caller can do other work and then wait().
+ *          readRegs() and writeRegs() are the same thing made synchronous, with the argument and return conventions of
+ *          I2Cdev::readBytes() and writeBytes(), so they can be I2Cdev's hooks and carry all the MPU6050 library's traffic.
+ *          The engine has to own its I2C port: nothing else, Wire included, can use it once begin() has run.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * @ref https://docs.espressif.com/projects/esp-idf/en/v3.3/api-reference/peripherals/i2c.html
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef i2cAsync_h
+#define i2cAsync_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+#include "driver/i2c.h"        // ESP-IDF I2C driver and its command link API
+// Comes with Platform.io ?
+#include "freertos/FreeRTOS.h" // Required for the queue of pending transactions
+// Comes with Platform.io ?
+#include "freertos/queue.h"
+// Comes with Platform.io ?
+#include "freertos/semphr.h"   // Required for waiting on a transaction to finish
+// Comes with Platform.io ?
+
+#define i2cQueueLength 8        // transactions that can be waiting for the bus
+#define i2cTxnTimeoutMs 10      // longest the driver lets one transaction hold the bus before giving up on it
+   // values for i2cTxn.status
+   #define it_idle 0            // never submitted
+   #define it_queued 1          // submitted, and not over yet
+   #define it_done 2            // over, and the device acked everything
+   #define it_failed 3          // over, but NACKed, timed out, or couldn't be queued
+
+struct i2cTxn;
+typedef bool (*i2cCallback)(i2cTxn &t);  // called in the bus task when t is over. Return true to run t again
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief One register transaction. The caller owns it, and leaves it alone from submit() until it's over
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct i2cTxn
+{
+   uint8_t devAddr = 0;         // 7 bit device address
+   uint8_t regAddr = 0;         // register to start at
+   uint8_t *wrData = NULL;      // bytes to write after regAddr
+   uint8_t wrLen = 0;
+   uint8_t *rdData = NULL;      // bytes to read after a repeated start
+   uint16_t rdLen = 0;
+   i2cCallback complete = NULL; // NULL = no callback
+   SemaphoreHandle_t done = NULL;  // given when it's over, if not NULL. Make it with xSemaphoreCreateBinary()
+   volatile int status = it_idle;
+   esp_err_t err = ESP_OK;      // what the driver said about the last run
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Engine for one I2C port. submit() and wait() from any task, run() in the bus task only
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class i2cAsync
+{
+public:
+   volatile uint32_t transactions = 0;  // runs through the driver, chained ones included
+   volatile uint32_t failures = 0;      // of those, ones that failed, plus ones that couldn't be queued
+
+   bool begin(i2c_port_t p, int sda, int scl, uint32_t hz)  // before the bus task starts
+   {  port = p;
+      i2c_config_t conf = {};
+      conf.mode = I2C_MODE_MASTER;
+      conf.sda_io_num = sda;
+      conf.sda_pullup_en = GPIO_PULLUP_ENABLE;
+      conf.scl_io_num = scl;
+      conf.scl_pullup_en = GPIO_PULLUP_ENABLE;
+      conf.master.clk_speed = hz;
+      if (i2c_param_config(port, &conf) != ESP_OK) return false;
+      if (i2c_driver_install(port, I2C_MODE_MASTER, 0, 0, 0) != ESP_OK) return false;
+      pending = xQueueCreate(i2cQueueLength, sizeof(i2cTxn *));
+      syncLock = xSemaphoreCreateMutex();
+      sync.done = xSemaphoreCreateBinary();
+      return pending != NULL && syncLock != NULL && sync.done != NULL;
+   }
+
+   bool submit(i2cTxn &t)       // never waits. False if the queue's full, and t is it_failed
+   {  i2cTxn *p = &t;
+      t.status = it_queued;
+      if (pending != NULL && xQueueSend(pending, &p, 0) == pdPASS) return true;
+      t.status = it_failed;
+      failures++;
+      return false;
+   }
+
+   bool wait(i2cTxn &t, TickType_t ticks)  // true once t is over, however it went. Needs t.done, and a submit() that worked
+   {  return t.done != NULL && xSemaphoreTake(t.done, ticks) == pdTRUE;
+   }
+
+   void run()                   // body of the bus task. Waits for a transaction and runs it, and anything chained on
+   {  i2cTxn *t;
+      if (xQueueReceive(pending, &t, portMAX_DELAY) != pdPASS) return;
+      bool again;
+      do
+      {  t->err = transfer(*t);
+         transactions++;
+         if (t->err != ESP_OK) failures++;
+         t->status = t->err == ESP_OK ? it_done : it_failed;
+         again = t->complete != NULL && t->complete(*t);
+         if (again) t->status = it_queued;
+      } while (again);
+      if (t->done != NULL) xSemaphoreGive(t->done);
+   }
+
+   int8_t readRegs(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data)  // like I2Cdev::readBytes()
+   {  if (!runSync(devAddr, regAddr, NULL, 0, data, length)) return -1;
+      return length;
+   }
+
+   bool writeRegs(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data)   // like I2Cdev::writeBytes()
+   {  return runSync(devAddr, regAddr, data, length, NULL, 0);
+   }
+
+private:
+   i2c_port_t port = I2C_NUM_0;
+   QueueHandle_t pending = NULL;
+   SemaphoreHandle_t syncLock = NULL;   // one readRegs()/writeRegs() at a time, since they share sync
+   i2cTxn sync;
+
+   bool runSync(uint8_t devAddr, uint8_t regAddr, uint8_t *wr, uint8_t wrLen, uint8_t *rd, uint16_t rdLen)
+   {  if (syncLock == NULL) return false;
+      xSemaphoreTake(syncLock, portMAX_DELAY);
+      sync.devAddr = devAddr;
+      sync.regAddr = regAddr;
+      sync.wrData = wr;
+      sync.wrLen = wrLen;
+      sync.rdData = rd;
+      sync.rdLen = rdLen;
+      bool ok = submit(sync);
+      if (ok)
+      {  xSemaphoreTake(sync.done, portMAX_DELAY);  // the driver's timeout bounds this, so sync is never left queued
+         ok = sync.status == it_done;
+      }
+      xSemaphoreGive(syncLock);
+      return ok;
+   }
+
+   esp_err_t transfer(i2cTxn &t)   // one START ... STOP on the bus
+   {  i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+      i2c_master_start(cmd);
+      i2c_master_write_byte(cmd, (t.devAddr << 1) | I2C_MASTER_WRITE, true);
+      i2c_master_write_byte(cmd, t.regAddr, true);
+      if (t.wrLen > 0) i2c_master_write(cmd, t.wrData, t.wrLen, true);
+      if (t.rdLen > 0)
+      {  i2c_master_start(cmd);                                  // repeated start, to turn the bus around
+         i2c_master_write_byte(cmd, (t.devAddr << 1) | I2C_MASTER_READ, true);
+         i2c_master_read(cmd, t.rdData, t.rdLen, I2C_MASTER_LAST_NACK);
+      }
+      i2c_master_stop(cmd);
+      esp_err_t err = i2c_master_cmd_begin(port, cmd, pdMS_TO_TICKS(i2cTxnTimeoutMs));
+      i2c_cmd_link_delete(cmd);
+      return err;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,163 @@
+/*************************************************************************************************************************************
+ * @file oscillation_monitor.h
+ * @author va3wam
+ * @brief Include file with a tilt oscillation detector, so chatter from too much P or D shows up while the robot is running
+ * @details controlTask push()es each tilt it balances on into a FreeRTOS queue, which costs it next to nothing and never
+ *          waits. A low priority task sits in run(), keeping the last oscSamples tilts in a ring, and every oscHop new ones
+ *          takes the spectrum of the ring with Goertzel's algorithm, one bin at a time from 1 to oscSamples/2 - 1 cycles per
+ *          window. The mean is taken out first, and a Hann window keeps a strong low frequency lean from leaking into the
+ *          higher bins.
+ *          Results are the biggest bin's frequency and amplitude, and the RMS tilt within a band of frequencies. They go out
+ *          through a commandBlock for getHealthTelemetry() to pick up. With warnRms set, the band RMS going over it sets
+ *          warn, which stays set until the RMS drops back under half of warnRms, so one bout of chatter is one warning.
+ *          A gap of more than oscGapUs between samples, e.g. from leaving bs_active, empties the ring, so the spectrum is
+ *          only ever of one unbroken run of balancing.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * @ref https://en.wikipedia.org/wiki/Goertzel_algorithm
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef oscillationMonitor_h
+#define oscillationMonitor_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+#include <step_command.h> // Lock free handoff of results to other tasks
+// our own creation
+#include "freertos/FreeRTOS.h" // Required for the queue controlTask hands samples over in
+// Comes with Platform.io ?
+#include "freertos/queue.h"
+// Comes with Platform.io ?
+
+#define oscSamples 64           // tilts in the analysis window. At tmrIMU = 12 that's 0.77 seconds, and bins 1.3 Hz apart
+#define oscBins (oscSamples / 2)  // bins 1 .. oscBins - 1 are looked at. 0 is the mean, which was taken out
+#define oscHop 16               // new samples between analyses
+#define oscGapUs 100000         // samples further apart than this start a new window
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief One tilt, as queued by push()
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   uint32_t us;                 // micros() when the tilt was read
+   float tilt;                  // degrees
+} oscSample;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Results of the last analysis
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   float sampleHz;              // sample rate, from the window's timestamps
+   float peakHz;                // frequency of the biggest bin
+   float peakAmp;               // and its amplitude, degrees either side of the mean
+   float bandRms;               // RMS degrees of everything between bandLoHz and bandHiHz
+   bool warn;                   // bandRms went over warnRms, and hasn't dropped back under half of it yet
+   uint32_t analyses;           // number of analyses done, so a reader can tell a fresh result from an old one
+   uint32_t dropped;            // samples push() couldn't queue, because run() had fallen behind
+} oscResult;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Oscillation detector. push() from controlTask, run() in its own task, latest() from anywhere
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class oscillationMonitor
+{
+public:
+   // params, set by loadBalanceCore() whenever they change
+   float bandLoHz = 3;          // band to watch for chatter
+   float bandHiHz = 40;
+   float warnRms = 0;           // band RMS degrees that raises a warning. 0 = never warn
+
+   void begin()
+   {  samples = xQueueCreate(oscSamples, sizeof(oscSample));
+      for (int n = 0; n < oscSamples; n++) window[n] = 0.5f - 0.5f * cosf(2 * PI * n / (oscSamples - 1));
+      for (int k = 1; k < oscBins; k++) coeff[k] = 2 * cosf(2 * PI * k / oscSamples);
+   }
+
+   void push(uint32_t us, float tilt)  // from controlTask. Never waits
+   {  oscSample s = {us, tilt};
+      if (samples != NULL && xQueueSend(samples, &s, 0) != pdPASS) dropped++;
+   }
+
+   void run()                   // body of the monitor task. Waits for a sample, and analyses every oscHop of them
+   {  oscSample s;
+      if (xQueueReceive(samples, &s, portMAX_DELAY) != pdPASS) return;
+      if (filled > 0 && s.us - ring[head].us > oscGapUs) filled = 0;   // gap, so start a new window
+      head = (head + 1) % oscSamples;
+      ring[head] = s;
+      if (filled < oscSamples) filled++;
+      if (++sinceAnalysis >= oscHop && filled == oscSamples)
+      {  sinceAnalysis = 0;
+         analyse();
+      }
+   }
+
+   void latest(oscResult &r, uint32_t &seen)   // r is left alone if nothing new, or analyse() was busy with it
+   {  results.fetch(r, seen);
+   }
+
+private:
+   QueueHandle_t samples = NULL;
+   oscSample ring[oscSamples];
+   int head = oscSamples - 1;   // slot of the newest sample
+   int filled = 0;              // how many slots have samples in the current unbroken run
+   int sinceAnalysis = 0;
+   float window[oscSamples];    // Hann window
+   float coeff[oscBins];        // Goertzel 2cos(w) for each bin
+   oscResult result = {};
+   volatile uint32_t dropped = 0;
+   commandBlock<oscResult> results;
+
+   void analyse()
+   {  float x[oscSamples];
+      int oldest = (head + 1) % oscSamples;
+      float mean = 0;
+      for (int n = 0; n < oscSamples; n++) mean += ring[n].tilt;
+      mean /= oscSamples;
+      float windowSum = 0;
+      for (int n = 0; n < oscSamples; n++)
+      {  x[n] = (ring[(oldest + n) % oscSamples].tilt - mean) * window[n];
+         windowSum += window[n];
+      }
+      uint32_t spanUs = ring[head].us - ring[oldest].us;
+      result.sampleHz = spanUs > 0 ? (oscSamples - 1) * 1000000.0f / spanUs : 0;
+      float binHz = result.sampleHz / oscSamples;
+      result.peakAmp = 0;
+      float bandSquares = 0;
+      for (int k = 1; k < oscBins; k++)
+      {  float s1 = 0, s2 = 0;                                     // Goertzel: one 2nd order resonator per bin
+         for (int n = 0; n < oscSamples; n++)
+         {  float s0 = x[n] + coeff[k] * s1 - s2;
+            s2 = s1;
+            s1 = s0;
+         }
+         float power = s1 * s1 + s2 * s2 - coeff[k] * s1 * s2;    // |X[k]|^2
+         float amp = 2 * sqrtf(power) / windowSum;                  // a sine exactly on bin k gives its own amplitude
+         if (amp > result.peakAmp)
+         {  result.peakAmp = amp;
+            result.peakHz = k * binHz;
+         }
+         float hz = k * binHz;
+         if (hz >= bandLoHz && hz <= bandHiHz) bandSquares += amp * amp;
+      }
+      result.bandRms = sqrtf(bandSquares / 2 / 1.5f);               // Hann spreads a sine's power over 1.5 bins' worth
+      if (warnRms > 0 && result.bandRms > warnRms) result.warn = true;
+      if (warnRms <= 0 || result.bandRms < warnRms / 2) result.warn = false;
+      result.analyses++;
+      result.dropped = dropped;
+      results.publish(result);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
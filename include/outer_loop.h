@@ -0,0 +1,76 @@
+/*************************************************************************************************************************************
+ * @file outer_loop.h
+ * @author va3wam
+ * @brief Include file with the position & velocity loop that sits outside balanceByAngle's PID and moves its targetAngle
+ * @details balanceByAngle() holds the robot at targetAngle, but a robot balanced at a slightly wrong angle rolls off across the
+ *          floor. This loop watches where the wheels have got to (wheel_odometry.h) and leans the target angle to bring them
+ *          back: position error from a hold point, plus velocity error from a commanded velocity. To stop rolling forward the
+ *          robot has to lean back, so a positive error gives a negative adjustment.
+ *          It runs every outerEvery balance cycles. The inner loop has to settle on one target before it's handed the next,
+ *          and wheel speed over a few cycles is all the odometry can give us anyway.
+ *          With a velocity commanded, the hold point moves along at that velocity, so the robot tracks it rather than
+ *          being pulled back to where it started.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef outerLoop_h
+#define outerLoop_h
+
+#define outerEvery 5            // outer loop runs once every this many balance cycles
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Outer loop state. Distances in inches, so gains don't depend on wheel size or microstepping
+/// @note  Runs once per outerEvery cycles, so it's in float even when balanceByAngle's math is fixed point
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct outerLoop
+{
+   // control params, copied in from the balance struct by loadBalanceCore() whenever they change
+   float posGain = 0;           // degrees of lean per inch from the hold point. 0 = don't hold position
+   float velGain = 0;           // degrees of lean per inch/second off the commanded velocity. 0 = don't control velocity
+   float maxAdjust = 0;         // most the loop may move targetAngle, in degrees either way
+   float velCommand = 0;        // inches/second to travel at, positive is forward. 0 = stay put
+
+   // state, and results of the last step() for telemetry
+   float holdPos = 0;           // where we're trying to be, in inches from where the step counts started
+   float posErr = 0;            // inches ahead of the hold point
+   float velErr = 0;            // inches/second faster than velCommand
+   float adjust = 0;            // degrees added to targetAngle
+   int countdown = outerEvery;  // balance cycles until the next step()
+
+   void reset(float position)   // hold position wherever we are, with no adjustment. Used when balancing starts
+   {  holdPos = position;
+      posErr = velErr = adjust = 0;
+      countdown = outerEvery;
+   }
+
+   bool due()                   // call every balance cycle. true once every outerEvery
+   {  if (--countdown > 0) return false;
+      countdown = outerEvery;
+      return true;
+   }
+
+   float step(float position, float velocity, float dt)  // new adjustment for targetAngle, dt seconds after the last one
+   {  holdPos += velCommand * dt;
+      posErr = position - holdPos;
+      velErr = velocity - velCommand;
+      adjust = -(posGain * posErr + velGain * velErr);
+      if (adjust > maxAdjust) adjust = maxAdjust;
+      if (adjust < -maxAdjust) adjust = -maxAdjust;
+      return adjust;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
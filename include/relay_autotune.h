@@ -0,0 +1,149 @@
+/*************************************************************************************************************************************
+ * @file relay_autotune.h
+ * @author va3wam
+ * @brief Include file with a relay feedback autotuner, which finds PID gains for balanceByAngle() on the robot
+ * @details While it runs, balanceByAngle() drives the wheels with step()'s output instead of PID: +relayPid when the tilt
+ *          error is over +hysteresis, -relayPid when it's under -hysteresis, and no change in between. Held loosely, the robot
+ *          settles into rocking back and forth across the target angle. After settleCycles rocks to get going, the next
+ *          measureCycles give the average amplitude a (degrees) and period Tu (seconds) of the rocking. For a relay of
+ *          amplitude d and hysteresis h, the gain at which P alone would keep rocking like that is about
+ *          Ku = 4 d / (pi sqrt(a^2 - h^2)), in pid units per degree, the same as pidPGain (Astrom & Hagglund's describing
+ *          function approximation).
+ *          Ku and Tu give gains by Ziegler-Nichols (quick, with overshoot) and by Tyreus-Luyben (slower, more damping).
+ *          Gains come out in balanceCore's units:
+ *             pGain = Kp
+ *             iGain = Kp / Ti * seconds per cycle * iCount, since the I part there is the average of the last iCount errors
+ *                     rather than a true integral. If pidICount is 0, there's no I part to give a gain to
+ *             dGain = Kp * Td * 1000, since the D part there is degrees per millisecond
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef relayAutotune_h
+#define relayAutotune_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define settleCycles 2          // rocks ignored while the rocking gets going
+#define measureCycles 5         // rocks averaged for Ku and Tu
+#define tuneTimeoutMs 15000     // give up if it hasn't rocked enough times in this long
+   // values for relayAutotune.status
+   #define at_idle 0            // never run
+   #define at_running 1         // relay is driving the wheels
+   #define at_done 2            // finished, Ku, Tu and gains are good
+   #define at_timeout 3         // didn't rock enough times before tuneTimeoutMs
+   #define at_aborted 4         // stopped before finishing, e.g. by AUTOTUNE,STOP or leaving bs_active
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief PID gains from one tuning rule
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   float p;
+   float i;
+   float d;
+} tunedGains;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Relay autotuner. start(), step() and abort() from controlTask only. Results are read once status isn't at_running
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct relayAutotune
+{
+   // params, copied in from the balance struct by loadBalanceCore() whenever they change
+   float relayPid = 100;        // relay amplitude in pid units, i.e. how hard the wheels are driven either way
+   float hysteresis = 0.3;      // degrees of error either side of 0 before the relay flips, so noise can't flip it
+
+   // state
+   volatile int status = at_idle;
+   volatile uint32_t ended = 0; // runs that have ended, however they ended, so a reader can tell when there's news
+   float out = 0;               // relay output, +/-relayPid
+   unsigned long startMs = 0;
+   unsigned long cycleStartMs = 0;  // when the relay last flipped from - to +
+   int cycles = 0;              // - to + flips so far
+   float errMax = 0;            // extremes of error since the last - to + flip
+   float errMin = 0;
+   float ampSum = 0;            // totals over the measured cycles
+   float periodSum = 0;
+
+   // results
+   float ku = 0;                // ultimate gain, pid units per degree
+   float tu = 0;                // ultimate period, seconds
+   tunedGains zieglerNichols = {0, 0, 0};
+   tunedGains tyreusLuyben = {0, 0, 0};
+
+   bool running() { return status == at_running; }
+
+   void start(float err, unsigned long nowMs)
+   {  out = err >= 0 ? relayPid : -relayPid;
+      startMs = cycleStartMs = nowMs;
+      cycles = 0;
+      errMax = errMin = err;
+      ampSum = periodSum = 0;
+      status = at_running;
+   }
+
+   void abort() { if (status == at_running) end(at_aborted); }
+
+   void end(int why)            // results have to be in memory before ended says there's news
+   {  status = why;
+      __sync_synchronize();
+      ended++;
+   }
+
+   float step(float err, unsigned long nowMs)  // relay output for this tilt error, in pid units
+   {  if (err > errMax) errMax = err;
+      if (err < errMin) errMin = err;
+      if (out < 0 && err > hysteresis)         // - to +: one whole rock since the last one
+      {  out = relayPid;
+         if (cycles >= settleCycles)
+         {  ampSum += (errMax - errMin) / 2;
+            periodSum += (nowMs - cycleStartMs) / 1000.0f;
+         }
+         cycles++;
+         cycleStartMs = nowMs;
+         errMax = errMin = err;
+         if (cycles >= settleCycles + measureCycles) finish();
+      }
+      else if (out > 0 && err < -hysteresis) out = -relayPid;
+      if (status == at_running && nowMs - startMs > tuneTimeoutMs) end(at_timeout);
+      return out;
+   }
+
+   void finish()
+   {  float amp = ampSum / measureCycles;
+      tu = periodSum / measureCycles;
+      if (amp <= hysteresis || tu <= 0)
+      {  end(at_timeout);
+         return;
+      }
+      ku = 4 * relayPid / (PI * sqrtf(amp * amp - hysteresis * hysteresis));
+      end(at_done);
+   }
+
+   tunedGains gainsFor(float kp, float ti, float td, int iCount, int tmrIMU)  // standard form PID into balanceCore's units
+   {  tunedGains g;
+      g.p = kp;
+      g.i = iCount > 0 ? kp / ti * (tmrIMU / 1000.0f) * iCount : 0;
+      g.d = kp * td * 1000;
+      return g;
+   }
+
+   void workOutGains(int iCount, int tmrIMU)  // once status is at_done. iCount & tmrIMU are the ones that will be used
+   {  zieglerNichols = gainsFor(0.6f * ku, tu / 2, tu / 8, iCount, tmrIMU);
+      tyreusLuyben = gainsFor(ku / 2.2f, 2.2f * tu, tu / 6.3f, iCount, tmrIMU);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,70 @@
+/*************************************************************************************************************************************
+ * @file run_stats.h
+ * @author va3wam
+ * @brief Include file with running statistics on how well one balancing run went, from entering bs_active to falling out of it
+ * @details add() is called once per balancing cycle and only updates counts, a sum of squares and a peak, so it costs the same
+ *          however long the run goes. end() marks when the run ended, so the summary can be worked out from a copy
+ *          later, by whoever publishes it.
+ *          Sum of squares is float. Over an hour of 12 mS cycles that's good to a fraction of a percent, plenty for comparing
+ *          one tuning with another.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ * 0.0.2   2026-10-16 end() & endMs, so seconds() works on a copy published after the run
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef runStats_h
+#define runStats_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Statistics for one balancing run. Only touched by controlTask. Copies go elsewhere once it's ended
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct balanceRun
+{
+   uint32_t runs = 0;           // runs started since power up, so summaries can be told apart
+   unsigned long startMs = 0;   // millis() when bs_active was entered
+   unsigned long endMs = 0;     // millis() when it fell out of bs_active
+   uint32_t cycles = 0;         // balancing cycles in this run
+   uint32_t deadbandCycles = 0; // cycles with the motors stopped because pid was inside the dead band
+   uint32_t saturatedCycles = 0;  // cycles where the controller wanted more than it's allowed, e.g. pid clamped at pidLimit
+   float errSquares = 0;        // sum of tilt error squared, degrees^2
+   float peakErr = 0;           // largest |tilt error|, degrees
+
+   void start(unsigned long nowMs)
+   {  runs++;
+      startMs = endMs = nowMs;
+      cycles = deadbandCycles = saturatedCycles = 0;
+      errSquares = peakErr = 0;
+   }
+
+   void add(float err, bool deadband, bool saturated)  // one balancing cycle
+   {  cycles++;
+      errSquares += err * err;
+      if (err < 0) err = -err;
+      if (err > peakErr) peakErr = err;
+      if (deadband) deadbandCycles++;
+      if (saturated) saturatedCycles++;
+   }
+
+   void end(unsigned long nowMs) { endMs = nowMs; }
+
+   float seconds() { return (endMs - startMs) / 1000.0f; }
+   float rmsErr() { return cycles > 0 ? sqrtf(errSquares / cycles) : 0; }
+   float deadbandPercent() { return cycles > 0 ? 100.0f * deadbandCycles / cycles : 0; }
+   float saturatedPercent() { return cycles > 0 ? 100.0f * saturatedCycles / cycles : 0; }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,70 @@
+/*************************************************************************************************************************************
+ * @file state_feedback.h
+ * @author va3wam
+ * @brief Include file with the full state feedback balancing method, bm_state, as an alternative to balanceByAngle's PID
+ * @details The state is tilt error (degrees), tilt rate (degrees/second), wheel position from the hold point (inches) and wheel
+ *          speed (inches/second). Wheel acceleration, in inches/second/second, is minus the dot product of the state with
+ *          the gain vector k, and that's integrated into the speed the wheels are told to go. Steppers don't slip, so the
+ *          speed the wheels were last told is used as the speed part of the state: it's up to date, where odometry's
+ *          speed is averaged over the last odoWindow cycles.
+ *          Gains come from tools/lqr_gains, which works them out by discrete LQR from the robot's dimensions and tmrIMU, and
+ *          prints them as setvar commands.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stateFeedback_h
+#define stateFeedback_h
+
+#define sfTilt 0                // index in state and gain vectors of each state variable
+#define sfRate 1
+#define sfPos 2
+#define sfVel 3
+#define sfStates 4
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief State feedback controller. Float, since it's 4 multiplies a cycle either way
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct stateFeedback
+{
+   // control params, copied in from the balance struct by loadBalanceCore() whenever they change
+   float k[sfStates] = {0, 0, 0, 0};  // gain vector, from tools/lqr_gains
+   float maxSpeed = 0;          // fastest the wheels may be told to go, inches/second
+
+   // state, and results of the last step() for telemetry
+   float x[sfStates];           // state vector used by the last step()
+   float holdPos = 0;           // wheel position to hold, inches from where the step counts started
+   float accel = 0;             // wheel acceleration, inches/second/second
+   float speed = 0;             // wheel speed, inches/second, positive is forward
+
+   void reset(float position)   // hold position wherever we are, starting from standstill. Used when balancing starts
+   {  holdPos = position;
+      accel = speed = 0;
+   }
+
+   float step(float tiltErr, float tiltRate, float position, float dt)  // new wheel speed, dt seconds after the last one
+   {  x[sfTilt] = tiltErr;
+      x[sfRate] = tiltRate;
+      x[sfPos] = position - holdPos;
+      x[sfVel] = speed;
+      accel = -(k[sfTilt] * x[sfTilt] + k[sfRate] * x[sfRate] + k[sfPos] * x[sfPos] + k[sfVel] * x[sfVel]);
+      speed += accel * dt;
+      if (speed > maxSpeed) speed = maxSpeed;
+      if (speed < -maxSpeed) speed = -maxSpeed;
+      return speed;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
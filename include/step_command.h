@@ -0,0 +1,63 @@
+/*************************************************************************************************************************************
+ * @file step_command.h
+ * @author va3wam
+ * @brief Include file with a double buffered, sequence numbered block for handing commands from a task to an ISR without locking
+ * @details The writer fills in whichever of the two slots the ISR isn't reading from, then bumps the sequence number, which
+ *          says which slot is newest. The ISR copies that slot and checks the sequence number didn't move while it did. If it
+ *          did, the copy may be torn, so the ISR throws it away and keeps what it had, untouched. It'll get the newer command
+ *          on its next interrupt. Neither side ever waits for the other, and interrupts are never turned off.
+ *          For the copy to be torn, the writer has to publish twice during one ISR copy of a few words. So in practice the
+ *          ISR gets every command first time, and when it doesn't it only costs one interrupt's delay.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.2   2026-10-16 fetch() copies into a local, and only hands it over once the sequence number shows it's clean
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepCommand_h
+#define stepCommand_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Command block for a command of type cmd, which should be a plain struct of a few words
+/// @note  There must only be one writer at a time. If several tasks publish, they have to take turns some other way
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename cmd> struct commandBlock
+{
+   volatile uint32_t seq = 0;   // number of commands published, times 2. Slot (seq / 2) & 1 holds the newest
+   cmd slot[2] = {};
+
+   void publish(const cmd &c)   // writer side
+   {  uint32_t next = seq + 2;
+      slot[(next >> 1) & 1] = c;               // the slot the reader isn't using, unless it's 2 commands behind
+      __sync_synchronize();                    // command has to be in memory before the sequence number says it is
+      seq = next;
+   }
+
+   bool IRAM_ATTR fetch(cmd &c, uint32_t &seen)  // reader side. true, and a clean copy in c, if there's a command newer than seen.
+   {                                             // false leaves c alone
+      uint32_t s = seq;
+      if (s == seen) return false;
+      __sync_synchronize();                    // read the sequence number before the command
+      cmd copy = slot[(s >> 1) & 1];           // into a local, so a torn copy never reaches the caller
+      __sync_synchronize();
+      if (seq != s) return false;              // writer may have been filling this slot while we copied it. Try again next time
+      c = copy;
+      seen = s;
+      return true;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
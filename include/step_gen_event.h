@@ -0,0 +1,214 @@
+/*************************************************************************************************************************************
+ * @file step_gen_event.h
+ * @author va3wam
+ * @brief Include file with an event driven software step pulse generator: the timer alarm is set for the next STEP edge due
+ * @details Timer0 free runs at 1 MHz. Each wheel remembers when its next STEP edge is due, and the alarm is always set for
+ *          whichever wheel is due first. So there are 2 interrupts per step (rising and falling edge), and none at all while
+ *          both wheels are stopped, rather than 50,000 a second regardless. Edges land on the microsecond they're due, not on
+ *          the next 20uS tick.
+ *          A new speed is applied against the time of the last rising edge, so speeding up, slowing down or reversing takes
+ *          effect right away rather than after the step that was in progress. That does the job of the soft ISR's 9999 trick.
+ *          With setAccel() on, a new speed is a target instead: each falling edge asks the wheel's stepRamp for the period to
+ *          the next rising edge, so speed changes spread over as many steps as the acceleration limit needs.
+ * @version 0.0.3
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.3   2026-10-16 Count steps
+ * 0.0.2   2026-10-16 Acceleration limit, see step_ramp.h
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepGenEvent_h
+#define stepGenEvent_h
+
+#include <step_generator.h> // stepGenerator interface
+// our own creation
+#include <step_ramp.h> // Acceleration limited speed ramp
+// our own creation
+#include "freertos/FreeRTOS.h" // portMUX_TYPE spinlock, shared by setTicks() and the ISR
+// Comes with Platform.io ?
+
+#define stepEdgeNever UINT64_MAX  // nextEdge value for a wheel with nothing scheduled
+#define stepAlarmLeadUs 3         // never set the alarm closer than this to now, or it could be in the past by the time it's set
+#define stepDirSetupUs 2          // wait between changing DIR and raising STEP. DRV8825 needs 650nS
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief State for one wheel. Shared between setTicks() and the ISR, always under the class's spinlock
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   int periodUs;               // signed microseconds between steps, as last set or as the ramp has got to. 0 = stopped
+   int32_t target;             // speed last set, for the ramp
+   stepRamp ramp;              // speed each step is actually made at, when acceleration is limited
+   uint64_t nextEdge;          // timer count when next STEP edge is due, or stepEdgeNever
+   uint64_t lastRise;          // timer count of last rising edge, which the next one is timed from
+   bool stepHigh;              // STEP is high, so next edge is the falling one
+   bool forward;               // level DIR is set to
+   volatile int32_t steps;     // +1 for every step forward, -1 for every step back. Read by getSteps() without the lock
+   uint8_t stepPin;            // DRV8825 STEP
+   uint8_t dirPin;             // DRV8825 DIR
+} eventStepChannel;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Step generator with a one shot timer alarm per STEP edge
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class stepGenEventISR : public stepGenerator
+{
+public:
+   stepGenEventISR(uint8_t leftStep, uint8_t leftDir, uint8_t rightStep, uint8_t rightDir)
+   {  initChannel(left, leftStep, leftDir);
+      initChannel(right, rightStep, rightDir);
+      instance = this;
+   }
+
+   void begin()
+   {  uint8_t timerNumber = 0;                                    // Timer0 will be used to control the motors
+      uint16_t prescaleDivider = 80;                              // Timer0 uses presaler (divider) of 80 so it counts microseconds
+      bool countUp = true;                                        // Timer0 will count up not down
+      timer = timerBegin(timerNumber, prescaleDivider, countUp);  // Set Timer0 configuration, and start it counting
+      bool intOnEdge = true;                                      // Interrupt on rising edge of Timer0 signal
+      timerAttachInterrupt(timer, &isr, intOnEdge);               // Attach ISR to Timer0
+   }                                                              // alarm gets enabled when there's a step to make
+
+   void setTicks(int leftTicks, int rightTicks)
+   {  if (timer == NULL) return;      // MQTT motor commands can show up before setupDriverMotors()
+      portENTER_CRITICAL(&mux);
+      uint64_t now = timerRead(timer);
+      setChannel(left, leftTicks * stepTickUs, now);
+      setChannel(right, rightTicks * stepTickUs, now);
+      setAlarm(now);
+      portEXIT_CRITICAL(&mux);
+   }
+
+   void stop()
+   {  if (timer == NULL) return;
+      portENTER_CRITICAL(&mux);
+      stopChannel(left);
+      stopChannel(right);
+      timerAlarmDisable(timer);
+      portEXIT_CRITICAL(&mux);
+   }
+
+   void setAccel(float stepsPerSec2)
+   {  portENTER_CRITICAL(&mux);
+      setChannelAccel(left, stepsPerSec2);
+      setChannelAccel(right, stepsPerSec2);
+      portEXIT_CRITICAL(&mux);
+   }
+
+   const char *name() const { return "event driven ISR"; }
+
+   void getSteps(int32_t &leftSteps, int32_t &rightSteps)
+   {  leftSteps = left.steps;
+      rightSteps = right.steps;
+   }
+
+private:
+   eventStepChannel left;
+   eventStepChannel right;
+   hw_timer_t *timer = NULL;
+   portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+   static stepGenEventISR *instance;   // the ISR has no arguments, so this is how it finds the channels
+
+   static void initChannel(eventStepChannel &c, uint8_t stepPin, uint8_t dirPin)
+   {  c.periodUs = 0;
+      c.target = 0;
+      c.nextEdge = stepEdgeNever;
+      c.lastRise = 0;
+      c.stepHigh = false;
+      c.forward = false;                // setupDriverMotors() starts DIR low
+      c.steps = 0;
+      c.stepPin = stepPin;
+      c.dirPin = dirPin;
+   }
+
+   static void stopChannel(eventStepChannel &c)
+   {  c.periodUs = 0;
+      c.target = 0;
+      c.ramp.reset();
+      c.nextEdge = stepEdgeNever;
+      if (c.stepHigh) digitalWrite(c.stepPin, LOW);
+      c.stepHigh = false;
+   }
+
+   static void setChannel(eventStepChannel &c, int periodUs, uint64_t now)
+   {  c.target = stepRamp::speedFromUs(periodUs);
+      if (c.ramp.on())                  // the ramp takes it from here at each falling edge
+      {  if (c.periodUs != 0 || periodUs == 0) return;
+         c.periodUs = stepRamp::usFromSpeed(c.ramp.next(c.target, 0));   // starting from standstill
+         if (!c.stepHigh) c.nextEdge = now;
+         return;
+      }
+      bool wasStopped = c.periodUs == 0;
+      c.periodUs = periodUs;
+      if (c.stepHigh) return;           // falling edge will time the next step from the new period
+      if (periodUs == 0) { c.nextEdge = stepEdgeNever; return; }
+      uint64_t due = wasStopped ? now : c.lastRise + (periodUs < 0 ? -periodUs : periodUs);
+      c.nextEdge = due > now ? due : now;
+   }
+
+   static void setChannelAccel(eventStepChannel &c, float stepsPerSec2)
+   {  c.ramp.setAccel(stepsPerSec2);
+      c.ramp.speed = stepRamp::speedFromUs(c.periodUs);   // carry on from the speed we're at, rather than ramp up from 0
+   }
+
+   void IRAM_ATTR setAlarm(uint64_t now)   // alarm for whichever wheel is due first, not closer than stepAlarmLeadUs
+   {  uint64_t next = left.nextEdge < right.nextEdge ? left.nextEdge : right.nextEdge;
+      if (next == stepEdgeNever)
+      {  timerAlarmDisable(timer);
+         return;
+      }
+      if (next < now + stepAlarmLeadUs) next = now + stepAlarmLeadUs;
+      timerAlarmWrite(timer, next, false);
+      timerAlarmEnable(timer);
+   }
+
+   static inline void IRAM_ATTR edge(eventStepChannel &c, uint64_t now)
+   {  if (c.nextEdge > now) return;     // not this wheel's turn
+      if (c.stepHigh)                   // end of pulse. Time the next one from the rising edge
+      {  digitalWrite(c.stepPin, LOW);
+         c.stepHigh = false;
+         if (c.ramp.on())               // speed for the next step, given the time since the last one
+            c.periodUs = stepRamp::usFromSpeed(c.ramp.next(c.target, c.periodUs < 0 ? -c.periodUs : c.periodUs));
+         int period = c.periodUs < 0 ? -c.periodUs : c.periodUs;
+         c.nextEdge = period == 0 ? stepEdgeNever : c.lastRise + period;
+         return;
+      }
+      if (c.periodUs == 0) { c.nextEdge = stepEdgeNever; return; }
+      bool forward = c.periodUs > 0;    // negative throttle means backwards
+      if (forward != c.forward)         // change DIR first, and come back for the rising edge once it has settled
+      {  digitalWrite(c.dirPin, forward ? HIGH : LOW);
+         c.forward = forward;
+         c.nextEdge = now + stepDirSetupUs;
+         return;
+      }
+      digitalWrite(c.stepPin, HIGH);
+      c.stepHigh = true;
+      c.steps += c.forward ? 1 : -1;
+      c.lastRise = c.nextEdge;          // when it was due, so interrupt latency doesn't pile up into slower steps
+      c.nextEdge = now + stepPulseUs;
+   }
+
+   static void IRAM_ATTR isr()
+   {  stepGenEventISR *g = instance;
+      portENTER_CRITICAL_ISR(&g->mux);
+      uint64_t now = timerRead(g->timer);
+      edge(g->right, now);
+      edge(g->left, now);
+      g->setAlarm(timerRead(g->timer));
+      portEXIT_CRITICAL_ISR(&g->mux);
+   }
+};
+stepGenEventISR *stepGenEventISR::instance = NULL;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,148 @@
+/*************************************************************************************************************************************
+ * @file step_gen_mcpwm.h
+ * @author va3wam
+ * @brief Include file with a step pulse generator that uses the ESP32's MCPWM peripheral to make STEP pulse trains in hardware
+ * @details Each wheel gets its own MCPWM timer on unit 0, running at the step rate, with operator A driving the STEP pin high
+ *          for stepPulseUs at the start of each period. DIR is a plain GPIO written when the speed is set. Nothing runs at
+ *          interrupt level, so the CPU cost is a few register writes per setTicks() call, whatever the speed.
+ *          With no interrupt per step there's nothing to count steps with, so getSteps() works them out from the rate each
+ *          wheel has been set to and for how long. Good to within a step of what was actually made.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.2   2026-10-16 Add getSteps()
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepGenMcpwm_h
+#define stepGenMcpwm_h
+
+#include <step_generator.h> // stepGenerator interface
+// our own creation
+#include "driver/mcpwm.h"   // ESP-IDF motor control PWM driver
+// Comes with Platform.io ?
+#include "freertos/FreeRTOS.h" // portMUX_TYPE spinlock, for the step count
+// Comes with Platform.io ?
+
+#define mcpwmMinHz 16        // MCPWM timers count at 1 MHz with a 16 bit period, so this is as slow as they go
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief State for one wheel's MCPWM timer
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   mcpwm_timer_t timer;        // MCPWM timer, and its operator A output, that makes this wheel's pulses
+   mcpwm_io_signals_t signal;  // output signal routed to the STEP pin
+   uint8_t stepPin;            // DRV8825 STEP
+   uint8_t dirPin;             // DRV8825 DIR
+   uint32_t hz;                // step rate the timer is set to. 0 = output held low
+   int dir;                    // +1 forward, -1 backward
+   uint32_t countHz;           // hz as far as the step count goes. Changed along with stepUs and sinceUs, under odoMux
+   int64_t stepUs;             // steps made up to sinceUs, times a million so no part steps get lost
+   uint32_t sinceUs;           // micros() when hz or dir last changed
+} mcpwmStepChannel;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Step generator using MCPWM unit 0. Speeds slower than mcpwmMinHz steps per second are treated as stopped
+/// @note  A new rate takes effect at the end of the current period, so a step is never cut short
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class stepGenMcpwm : public stepGenerator
+{
+public:
+   stepGenMcpwm(uint8_t leftStep, uint8_t leftDir, uint8_t rightStep, uint8_t rightDir)
+   {  left = {MCPWM_TIMER_0, MCPWM0A, leftStep, leftDir, 0, 1, 0, 0, 0};
+      right = {MCPWM_TIMER_1, MCPWM1A, rightStep, rightDir, 0, 1, 0, 0, 0};
+   }
+
+   void begin()
+   {  startChannel(left);
+      startChannel(right);
+      started = true;
+   }
+
+   void setTicks(int leftTicks, int rightTicks)
+   {  if (!started) return;     // MQTT motor commands can show up before setupDriverMotors()
+      setChannel(left, leftTicks);
+      setChannel(right, rightTicks);
+   }
+
+   void stop()
+   {  if (!started) return;
+      setChannel(left, 0);
+      setChannel(right, 0);
+   }
+
+   const char *name() const { return "MCPWM"; }
+
+   void getSteps(int32_t &leftSteps, int32_t &rightSteps)
+   {  uint32_t now = micros();
+      portENTER_CRITICAL(&odoMux);
+      leftSteps = (int32_t)(stepUsAt(left, now) / 1000000);
+      rightSteps = (int32_t)(stepUsAt(right, now) / 1000000);
+      portEXIT_CRITICAL(&odoMux);
+   }
+
+private:
+   mcpwmStepChannel left;
+   mcpwmStepChannel right;
+   bool started = false;
+   portMUX_TYPE odoMux = portMUX_INITIALIZER_UNLOCKED;   // keeps getSteps() from seeing half a rate change
+
+   static int64_t stepUsAt(const mcpwmStepChannel &c, uint32_t now)
+   {  return c.stepUs + (int64_t)c.dir * c.countHz * (uint32_t)(now - c.sinceUs);
+   }
+
+   void rebase(mcpwmStepChannel &c, uint32_t hz, int dir)   // count the steps made at the old rate, before changing it
+   {  uint32_t now = micros();
+      portENTER_CRITICAL(&odoMux);
+      c.stepUs = stepUsAt(c, now);
+      c.sinceUs = now;
+      c.dir = dir;
+      c.countHz = hz;
+      portEXIT_CRITICAL(&odoMux);
+   }
+
+   static void startChannel(mcpwmStepChannel &c)
+   {  mcpwm_gpio_init(MCPWM_UNIT_0, c.signal, c.stepPin);
+      mcpwm_config_t cfg;
+      cfg.frequency = 1000;                    // anything will do, the output is held low until a speed is set
+      cfg.cmpr_a = 0;
+      cfg.cmpr_b = 0;
+      cfg.counter_mode = MCPWM_UP_COUNTER;
+      cfg.duty_mode = MCPWM_DUTY_MODE_0;       // high from start of period until the compare value
+      mcpwm_init(MCPWM_UNIT_0, c.timer, &cfg);
+      mcpwm_set_signal_low(MCPWM_UNIT_0, c.timer, MCPWM_OPR_A);
+      c.hz = 0;
+   }
+
+   void setChannel(mcpwmStepChannel &c, int ticks)
+   {  uint32_t hz = 0;
+      if (ticks != 0) hz = 1000000 / ((ticks < 0 ? -ticks : ticks) * stepTickUs);
+      if (hz < mcpwmMinHz) hz = 0;
+      int dir = hz == 0 ? c.dir : (ticks < 0 ? -1 : 1);
+      if (hz != c.countHz || dir != c.dir) rebase(c, hz, dir);
+      if (hz != 0) digitalWrite(c.dirPin, ticks < 0 ? LOW : HIGH);   // negative throttle means backwards
+      if (hz == c.hz) return;                  // nothing to change, so don't disturb the timer
+      if (hz == 0)
+      {  mcpwm_set_signal_low(MCPWM_UNIT_0, c.timer, MCPWM_OPR_A);
+      }
+      else
+      {  mcpwm_set_frequency(MCPWM_UNIT_0, c.timer, hz);
+         mcpwm_set_duty_in_us(MCPWM_UNIT_0, c.timer, MCPWM_OPR_A, stepPulseUs);
+         if (c.hz == 0) mcpwm_set_duty_type(MCPWM_UNIT_0, c.timer, MCPWM_OPR_A, MCPWM_DUTY_MODE_0);  // undo signal low
+      }
+      c.hz = hz;
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,209 @@
+/*************************************************************************************************************************************
+ * @file step_gen_soft.h
+ * @author va3wam
+ * @brief Include file with the software step pulse generator: a hardware timer ISR that bit bangs STEP and DIR
+ * @details This is the motor ISR that used to live in main.cpp, wrapped up as a stepGenerator backend. Timer0 interrupts every
+ *          stepTickUs microseconds. Each wheel counts those ticks, raises STEP at the end of the first one, drops it at the end of
+ *          the second, and starts the next step when the count passes the interval it was asked for.
+ *          With setAccel() on, the interval for each step comes from the wheel's stepRamp instead of straight from setTicks().
+ *          New speeds reach the ISR through a commandBlock (step_command.h), so nothing turns interrupts off to set them.
+ * @version 0.0.4
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.4   2026-10-16 Count steps
+ * 0.0.3   2026-10-16 Hand commands to the ISR through a commandBlock rather than with interrupts off
+ * 0.0.2   2026-10-16 Acceleration limit, see step_ramp.h
+ * 0.0.1   2026-10-16 Include file created, with motorTimerISR() and its timer setup moved in from main.cpp
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepGenSoft_h
+#define stepGenSoft_h
+
+#include <step_generator.h> // stepGenerator interface
+// our own creation
+#include <step_ramp.h> // Acceleration limited speed ramp
+// our own creation
+#include <step_command.h> // Lock free command handoff to the ISR
+// our own creation
+#include "freertos/FreeRTOS.h" // Required for the mutex callers take turns with
+// Comes with Platform.io ?
+#include "freertos/semphr.h"
+// Comes with Platform.io ?
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief ISR level state for one wheel. Only the ISR touches it
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   int tickCounter;            // working counter of timer ticks in motor controller ISR
+   int tickLimit;              // limit that determines step length in timer ticks
+   int tickSetting;            // value for current limit, from the last command picked up
+   int32_t target;             // tickSetting as a speed, for the ramp
+   stepRamp ramp;              // speed each step is actually made at, when acceleration is limited
+   bool forward;               // level DIR is set to
+   volatile int32_t steps;     // +1 for every step forward, -1 for every step back. Read by getSteps() in the background
+   uint8_t stepPin;            // DRV8825 STEP
+   uint8_t dirPin;             // DRV8825 DIR
+} softStepChannel;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief What setTicks(), stop() and setAccel() hand the ISR, through a commandBlock
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   int tickSetting[2];         // left, right. Interval between steps, or 9999 to cut a step short on reversal
+   int32_t target[2];          // left, right. Same as a speed, for the ramp
+   uint32_t accelPerUs;        // stepRamp settings, worked out by setAccel() so the ISR needn't
+   int32_t startSpeed;
+   bool stop;                  // stop now, don't wait for the end of the step
+} softStepCommand;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Step generator using a 50 kHz timer interrupt. Costs the same CPU whether the wheels are turning or not
+/// @note  Callers never turn interrupts off. Commands go to the ISR through a commandBlock, which it checks every tick,
+///        and a mutex makes callers in different tasks take turns at being its one writer
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class stepGenSoftISR : public stepGenerator
+{
+public:
+   stepGenSoftISR(uint8_t leftStep, uint8_t leftDir, uint8_t rightStep, uint8_t rightDir)
+   {  left.stepPin = leftStep;
+      left.dirPin = leftDir;
+      right.stepPin = rightStep;
+      right.dirPin = rightDir;
+      writeLock = xSemaphoreCreateMutex();  // control params get loaded before begin(), so it's needed from the start
+      instance = this;
+   }
+
+   void begin()
+   {  uint8_t timerNumber = 0;                                    // Timer0 will be used to control the motors
+      uint16_t prescaleDivider = 80;                              // Timer0 uses presaler (divider) of 80 so interrupts occur at 1us
+      bool countUp = true;                                        // Timer0 will count up not down
+      timer = timerBegin(timerNumber, prescaleDivider, countUp);  // Set Timer0 configuration
+      bool intOnEdge = true;                                      // Interrupt on rising edge of Timer0 signal
+      timerAttachInterrupt(timer, &isr, intOnEdge);               // Attach ISR to Timer0
+      bool autoReload = true;                                     // Should the ISR timer reload after it runs
+      timerAlarmWrite(timer, stepTickUs, autoReload);             // Set up conditions to call ISR
+      timerAlarmEnable(timer);                                    // Enable timer interrupt
+   }
+
+   void setTicks(int leftTicks, int rightTicks)
+   {  xSemaphoreTake(writeLock, portMAX_DELAY);
+      setChannel(0, leftTicks);
+      setChannel(1, rightTicks);
+      pending.stop = false;
+      commands.publish(pending);
+      xSemaphoreGive(writeLock);
+   }
+
+   void stop()
+   {  xSemaphoreTake(writeLock, portMAX_DELAY);
+      for (int w = 0; w < 2; w++) pending.tickSetting[w] = pending.target[w] = lastSetting[w] = 0;
+      pending.stop = true;
+      commands.publish(pending);
+      xSemaphoreGive(writeLock);
+   }
+
+   void setAccel(float stepsPerSec2)
+   {  stepRamp r;
+      r.setAccel(stepsPerSec2);
+      xSemaphoreTake(writeLock, portMAX_DELAY);
+      pending.accelPerUs = r.accelPerUs;
+      pending.startSpeed = r.startSpeed;
+      pending.stop = false;
+      commands.publish(pending);
+      xSemaphoreGive(writeLock);
+   }
+
+   const char *name() const { return "software ISR"; }
+
+   void getSteps(int32_t &leftSteps, int32_t &rightSteps)
+   {  leftSteps = left.steps;
+      rightSteps = right.steps;
+   }
+
+private:
+   softStepChannel left = {};
+   softStepChannel right = {};
+   hw_timer_t *timer = NULL;
+   static stepGenSoftISR *instance;   // the ISR has no arguments, so this is how it finds the channels
+
+   // writer side, only touched with writeLock held
+   SemaphoreHandle_t writeLock;
+   softStepCommand pending = {};      // last command published, which the next one starts from
+   int lastSetting[2] = {0, 0};       // previous setTicks() value per wheel, to spot a change of direction
+   commandBlock<softStepCommand> commands;
+
+   // ISR side
+   uint32_t seenSeq = 0;              // sequence number of the last command picked up
+
+   void setChannel(int w, int ticks)
+   {  pending.tickSetting[w] = ticks;
+      pending.target[w] = stepRamp::speedFromUs(ticks * stepTickUs);
+      if (pending.accelPerUs == 0 && lastSetting[w] * ticks < 0)   // if old and new signs are different, we've reversed
+      {                                 // desired directions and we should abort current step in the wrong direction
+         pending.tickSetting[w] = 9999; // force counter overflow, and thus reading of the new setting
+      }
+      lastSetting[w] = ticks;
+   }
+
+   static void IRAM_ATTR apply(softStepChannel &c, const softStepCommand &cmd, int w)
+   {  if (!c.ramp.on()) c.ramp.speed = cmd.target[w];   // ramp being turned on starts from the speed we're at, not 0
+      c.ramp.accelPerUs = cmd.accelPerUs;
+      c.ramp.startSpeed = cmd.startSpeed;
+      c.tickSetting = cmd.tickSetting[w];
+      c.target = cmd.target[w];
+      if (cmd.stop)
+      {  c.tickLimit = 0;
+         c.ramp.reset();
+      }
+   }
+
+   static inline void IRAM_ATTR tick(softStepChannel &c)
+   {  c.tickCounter ++;                         // increment our once per interrupt tick counter
+      if(c.tickCounter > c.tickLimit)           // did that take us to the limit value?
+      {  c.tickCounter = 0;                     // yes, reset the counter, which goes upwards
+         if (c.ramp.on())                       // reset upper limit to what the ramp says, starting from the last interval
+            c.tickLimit = stepRamp::usFromSpeed(c.ramp.next(c.target, (c.tickLimit + 1) * stepTickUs)) / stepTickUs;
+         else c.tickLimit = c.tickSetting;      // or to what the background asked for
+         if(c.tickLimit< 0)                     // negative throttle means backwards
+         {  digitalWrite(c.dirPin,LOW);         // write zero to direction bit on DRV8825 motor controller
+            c.tickLimit *= -1;                  // get back to a +ve number for counter comparisons
+            c.forward = false;
+         }
+         else
+         {  digitalWrite(c.dirPin,HIGH);        // if not negative limit value, set wheel direction = forward
+            c.forward = true;
+         }
+      }
+      else if(c.tickCounter == 1)               // start the step pulse at end of first counted tick
+      {  digitalWrite(c.stepPin,HIGH);
+         c.steps += c.forward ? 1 : -1;         // and count it
+      }
+      else if(c.tickCounter == 2) digitalWrite(c.stepPin,LOW);   // end the step pulse at end of second counted tick
+   }
+
+   static void IRAM_ATTR isr()
+   {  stepGenSoftISR *g = instance;
+      softStepCommand cmd;
+      if (g->commands.fetch(cmd, g->seenSeq))   // anything new from the background? Only used at the next step boundary
+      {  apply(g->left, cmd, 0);
+         apply(g->right, cmd, 1);
+      }
+      tick(g->right);
+      tick(g->left);
+   }
+};
+stepGenSoftISR *stepGenSoftISR::instance = NULL;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
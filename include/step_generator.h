@@ -0,0 +1,56 @@
+/*************************************************************************************************************************************
+ * @file step_generator.h
+ * @author va3wam
+ * @brief Include file defining the interface every stepper motor STEP/DIR pulse generator provides
+ * @details balanceByAngle(), motor testing and checkBalanceState() only ever say how fast and which way each wheel should turn,
+ *          through a stepGenerator. How the pulses get made is up to the backend picked by stepGenBackend in main.cpp:
+ *          | Backend        | Header           | How pulses are made                                                      |
+ *          |:---------------|:-----------------|:-------------------------------------------------------------------------|
+ *          | stepGenSoftISR | step_gen_soft.h  | hw_timer ISR every stepTickUs counts ticks and bit bangs STEP and DIR     |
+ *          | stepGenMcpwm   | step_gen_mcpwm.h | MCPWM timer per wheel makes the STEP pulse train, no interrupts at all   |
+ *          | stepGenEventISR| step_gen_event.h | hw_timer alarm is set for the next STEP edge due, 2 interrupts per step  |
+ *          Backends that make each step in an ISR can also limit acceleration, see setAccel() and step_ramp.h.
+ * @version 0.0.4
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.4   2026-10-16 Add getSteps()
+ * 0.0.3   2026-10-16 Add setAccel()
+ * 0.0.2   2026-10-16 Add event driven ISR backend to table
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepGenerator_h
+#define stepGenerator_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define stepTickUs 20        // speeds are given as the interval between steps, in units of this many microseconds
+#define stepPulseUs 20       // width of each STEP pulse. DRV8825 needs at least 1.9uS
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief What every step pulse generator backend provides
+/// @note  Speeds are signed: negative is backwards. 0 stops stepping but leaves the driver enabled, so the wheel holds.
+///        Motor enable pins are not the generator's business, they're still handled by the caller
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class stepGenerator
+{
+public:
+   virtual void begin() = 0;                                // set up pins, timers and interrupts
+   virtual void setTicks(int leftTicks, int rightTicks) = 0; // interval between steps for each wheel, in stepTickUs units
+   virtual void stop() = 0;                                 // stop both wheels now, without finishing the current step
+   virtual const char *name() const = 0;                    // for startup messages
+   virtual void getSteps(int32_t &leftSteps, int32_t &rightSteps) = 0; // signed steps made since startup, + is forward
+   virtual void setAccel(float stepsPerSec2) {}             // most a wheel's speed may change per second. 0 = jump to new speeds
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
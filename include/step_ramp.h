@@ -0,0 +1,85 @@
+/*************************************************************************************************************************************
+ * @file step_ramp.h
+ * @author va3wam
+ * @brief Include file with an acceleration limited speed ramp, worked out one step at a time inside the step generator ISR
+ * @details Same idea as Atmel's AVR446 note: each time a step is made, the wheel's speed moves toward the speed it was asked for
+ *          by no more than maxAccel times the time since the last step, so a new speed from balanceByAngle() is approached
+ *          over as many steps as it takes rather than in one jump. Speeds are signed steps per second in Q8 fixed point (the
+ *          fraction carries over from step to step, like a Bresenham error term), so the ISR only does integer multiply,
+ *          shift and one divide per step. setAccel() does the floating point, in the background.
+ *          Below startSpeed, the speed a wheel can reach from standstill in one step, the ramp jumps straight to the target,
+ *          or to startSpeed, or to 0. That's how a wheel starts, stops, and reverses: slow down to startSpeed, step the
+ *          other way at startSpeed, speed back up.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef stepRamp_h
+#define stepRamp_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define rampQ 8                                    // speeds are steps per second << rampQ
+#define rampUsQ8 (1000000L << rampQ)               // microseconds per step = rampUsQ8 / speed
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Speed ramp for one wheel
+/// @note  next() is called from the ISR, setAccel() and reset() from the background with the ISR locked out
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct stepRamp
+{
+   int32_t speed = 0;           // current signed speed, steps per second Q8
+   int32_t startSpeed = 0;      // fastest speed it's ok to jump to from a standstill, steps per second Q8
+   uint32_t accelPerUs = 0;     // most speed can change per microsecond, steps per second Q8, << 16. 0 = no ramp
+
+   void setAccel(float stepsPerSec2)               // 0 or less turns the ramp off
+   {  if (stepsPerSec2 <= 0)
+      {  accelPerUs = 0;
+         startSpeed = 0;
+         return;
+      }
+      accelPerUs = (uint32_t)(stepsPerSec2 * (1 << rampQ) * 65536.0f / 1000000.0f);
+      if (accelPerUs == 0) accelPerUs = 1;
+      startSpeed = (int32_t)(sqrtf(2.0f * stepsPerSec2) * (1 << rampQ));  // speed after 1 step from rest, v^2 = 2as
+   }
+
+   bool on() const { return accelPerUs != 0; }
+
+   void reset() { speed = 0; }                      // wheel has been stopped without ramping down
+
+   int32_t IRAM_ATTR next(int32_t target, uint32_t dtUs)  // new speed for a step made dtUs after the last one
+   {  int32_t dv = (int32_t)(((uint64_t)accelPerUs * dtUs) >> 16);
+      if (target > speed) speed = target - speed > dv ? speed + dv : target;
+      else speed = speed - target > dv ? speed - dv : target;
+      if (speed > -startSpeed && speed < startSpeed)  // slow enough to start, stop or turn around
+      {  if (target == 0) speed = 0;
+         else if (target > -startSpeed && target < startSpeed) speed = target;
+         else speed = target > 0 ? startSpeed : -startSpeed;
+      }
+      return speed;
+   }
+
+   static int32_t speedFromUs(int periodUs)        // signed microseconds per step to signed speed. 0 = stopped
+   {  if (periodUs == 0) return 0;
+      return periodUs > 0 ? rampUsQ8 / periodUs : -(rampUsQ8 / -periodUs);
+   }
+
+   static int IRAM_ATTR usFromSpeed(int32_t speed) // signed speed to signed microseconds per step. 0 = stopped
+   {  if (speed == 0) return 0;
+      return speed > 0 ? rampUsQ8 / speed : -(rampUsQ8 / -speed);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
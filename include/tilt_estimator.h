@@ -0,0 +1,75 @@
+/*************************************************************************************************************************************
+ * @file tilt_estimator.h
+ * @author va3wam
+ * @brief Include file with a complementary filter that estimates tilt from raw MPU6050 accel and gyro readings
+ * @details Used instead of the DMP when balance.tiltSource is ts_raw. controlTask reads the raw sensor registers in one burst
+ *          every rawImuPeriod milliseconds and hands them to update(). Only the axis the robot tilts around is worked out, so
+ *          each update is one atan2 plus a few multiplies, rather than the DMP quaternion to gravity to yaw/pitch/roll chain.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef tiltEstimator_h
+#define tiltEstimator_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define accelLsbPerG 16384     // dmpInitialize() sets the accelerometer to +/-2g full scale
+#define gyroLsbPerDegSecRaw 16.4 // and the gyro to +/-2000 deg/sec
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Complementary filter on one axis: integrate the gyro for the short term, lean on the accelerometer for the long term
+/// @note  tilt uses the same convention as readIMU()'s DMP path: roll - 90 degrees, with values past -180 folded to +90.
+///        Roll is atan2(accel y, accel z), the same formula dmpGetYawPitchRoll() uses on the DMP's gravity vector
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct tiltEstimator
+{
+   float alpha = 0.998;          // weight given to gyro integration each update. set by setTimeConstant()
+   float roll = 0;               // estimated roll, in degrees, before the -90 adjustment
+   float rate = 0;               // last gyro rate around the roll axis, in degrees per second
+   float tilt = 0;               // estimated tilt, same convention as balance.tilt
+   unsigned long updates = 0;    // number of updates done, for health and debugging
+
+   void setTimeConstant(float tau, float dt)   // tau: seconds for accelerometer to pull in an error. dt: seconds per update
+   {  if (tau <= 0) alpha = 0;                 // pure accelerometer
+      else alpha = tau / (tau + dt);
+   }
+
+   void seed(int16_t ay, int16_t az)           // start from the accelerometer alone, e.g. when switching to this estimator
+   {  roll = atan2f(ay, az) * RAD_TO_DEG;
+      rate = 0;
+      setTilt();
+   }
+
+   void update(int16_t ay, int16_t az, int16_t gx, float dt)  // one raw sample. dt in seconds since the last one
+   {  rate = gx * (1.0f / gyroLsbPerDegSecRaw);
+      float accRoll = atan2f(ay, az) * RAD_TO_DEG;
+      float gyroRoll = roll + rate * dt;
+      if (accRoll - gyroRoll > 180) accRoll -= 360;         // blend across the +/-180 wrap the short way round
+      if (accRoll - gyroRoll < -180) accRoll += 360;
+      roll = alpha * gyroRoll + (1 - alpha) * accRoll;
+      if (roll > 180) roll -= 360;
+      if (roll <= -180) roll += 360;
+      setTilt();
+      updates++;
+   }
+
+   void setTilt()
+   {  tilt = roll - 90;
+      if (tilt < -180) tilt = 90;                           // avoid abrupt change from +90 to -270, past a face plant
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
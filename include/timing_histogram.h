@@ -0,0 +1,97 @@
+/*************************************************************************************************************************************
+ * @file timing_histogram.h
+ * @author va3wam
+ * @brief Include file with a fixed size histogram of microsecond durations, for control loop timing telemetry
+ * @details Durations are dropped into log-linear buckets: 8 buckets per power of 2, so every bucket is within 12.5% of the
+ *          values in it, from 1 uS up to about 67 seconds. record() is a handful of integer operations and no floating point,
+ *          so it's cheap enough to call from controlTask every cycle. Min and max are kept exactly.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef timingHistogram_h
+#define timingHistogram_h
+
+#include <Arduino.h> // Arduino Core for ESP32. https://github.com/espressif/arduino-esp32
+
+#define thSubBits 3                              // 2^3 = 8 buckets per power of 2
+#define thSubBuckets (1 << thSubBits)
+#define thBuckets (27 * thSubBuckets)            // values up to 2^26 uS, past that everything lands in the last bucket
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Histogram of durations in microseconds
+/// @note  Written by one task and read by another. Counts are 32 bit, so a reader never sees half an update to one of them,
+///        but a percentile may be off by the sample or two recorded while it was being worked out. That's fine for telemetry
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct timingHistogram
+{
+   uint32_t counts[thBuckets];
+   uint32_t total;
+   uint32_t minUs;
+   uint32_t maxUs;
+
+   timingHistogram() { reset(); }
+
+   void reset()
+   {  for (int b = 0; b < thBuckets; b++) counts[b] = 0;
+      total = 0;
+      minUs = UINT32_MAX;
+      maxUs = 0;
+   }
+
+   static int bucketOf(uint32_t us)              // values below 8 get a bucket each, then 8 per doubling
+   {  if (us < thSubBuckets) return us;
+      int msb = 31 - __builtin_clz(us);          // position of highest set bit, at least thSubBits
+      int sub = (us >> (msb - thSubBits)) & (thSubBuckets - 1);
+      int b = (msb - thSubBits + 1) * thSubBuckets + sub;
+      return b < thBuckets ? b : thBuckets - 1;
+   }
+
+   static uint32_t bucketTop(int b)              // largest value that lands in bucket b
+   {  if (b < thSubBuckets) return b;
+      int msb = b / thSubBuckets + thSubBits - 1;
+      uint32_t lo = (uint32_t)(thSubBuckets + b % thSubBuckets) << (msb - thSubBits);
+      return lo + (1u << (msb - thSubBits)) - 1;
+   }
+
+   void record(uint32_t us)
+   {  counts[bucketOf(us)]++;
+      total++;
+      if (us < minUs) minUs = us;
+      if (us > maxUs) maxUs = us;
+   }
+
+   uint32_t percentile(int pct) const            // upper edge of the bucket holding the pct'th percentile, capped at max
+   {  if (total == 0) return 0;
+      uint32_t want = (uint32_t)(((uint64_t)total * pct + 99) / 100);
+      uint32_t seen = 0;
+      for (int b = 0; b < thBuckets; b++)
+      {  seen += counts[b];
+         if (seen >= want)
+         {  uint32_t top = bucketTop(b);
+            return top < maxUs ? top : maxUs;
+         }
+      }
+      return maxUs;
+   }
+
+   String summary() const                        // min,p50,p90,p99,max in uS, for telemetry. All 0 if nothing recorded
+   {  if (total == 0) return String("0,0,0,0,0");
+      return String(minUs) + "," + String(percentile(50)) + "," + String(percentile(90)) + ","
+         + String(percentile(99)) + "," + String(maxUs);
+   }
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -0,0 +1,82 @@
+/*************************************************************************************************************************************
+ * @file wheel_odometry.h
+ * @author va3wam
+ * @brief Include file with a wheel speed estimator working from the step generator's signed step counts
+ * @details The step generator counts every step it makes, +1 forward and -1 backward, per wheel. Those counts are where the
+ *          wheels actually are, as far as open loop steppers go. update() is given the counts once per control cycle and
+ *          works out each wheel's speed in steps per second over the last odoWindow cycles: counts are whole steps, so
+ *          looking across several cycles keeps the speed from jumping around by 1 step per cycle.
+ *          The result goes out through a commandBlock, so any task can pick up a consistent snapshot without locking.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.2   2026-10-16 latest() says whether s was updated. It relies on commandBlock::fetch() never handing over a torn copy
+ * 0.0.1   2026-10-16 Include file created
+ *************************************************************************************************************************************/
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Guard against multiple include statements in the project
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef wheelOdometry_h
+#define wheelOdometry_h
+
+#include <step_command.h> // Lock free handoff of the snapshot to other tasks
+// our own creation
+
+#define odoWindow 8             // speed is measured across this many update()s. At tmrIMU = 12 that's 84 mS
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Where the wheels are and how fast they're going, as of the last update()
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+   uint32_t us;                 // micros() when the counts were read
+   int32_t leftSteps;           // signed step count since startup, positive is forward
+   int32_t rightSteps;
+   float leftSpeed;             // steps per second, positive is forward
+   float rightSpeed;
+} wheelSnapshot;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Sliding window speed estimate for both wheels. update() from one task only, latest() from anywhere
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class wheelOdometry
+{
+public:
+   void update(uint32_t us, int32_t leftSteps, int32_t rightSteps)
+   {  head = (head + 1) % odoWindow;
+      when[head] = us;
+      left[head] = leftSteps;
+      right[head] = rightSteps;
+      if (filled < odoWindow) filled++;
+      int oldest = filled < odoWindow ? 0 : (head + 1) % odoWindow;   // once full, the next slot along is the oldest
+      wheelSnapshot s = {us, leftSteps, rightSteps, 0, 0};
+      uint32_t dt = us - when[oldest];
+      if (dt > 0)
+      {  s.leftSpeed = (leftSteps - left[oldest]) * 1000000.0f / dt;
+         s.rightSpeed = (rightSteps - right[oldest]) * 1000000.0f / dt;
+      }
+      snapshots.publish(s);
+   }
+
+   bool latest(wheelSnapshot &s, uint32_t &seen)     // true with a whole snapshot in s. false leaves s alone: nothing
+   {  return snapshots.fetch(s, seen);               // new, or update() was publishing over the one being copied
+   }
+
+private:
+   uint32_t when[odoWindow];
+   int32_t left[odoWindow];
+   int32_t right[odoWindow];
+   int head = odoWindow - 1;                        // slot of the newest sample
+   int filled = 0;                                  // how many slots have samples in them
+   commandBlock<wheelSnapshot> snapshots;
+};
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Close out gaurding against multile includes
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -3,6 +3,7 @@
 // 2013-06-05 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-16 - add readHook & writeHook, so another driver can carry the traffic instead of Wire
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
 //      2013-05-05 - fix issue with writing bit values to words (Sasquatch/Farzanegan)
 //      2012-06-09 - fix major issue with reading > 32 bytes at a time with Arduino Wire
@@ -209,6 +210,7 @@ int8_t I2Cdev::readWord(uint8_t devAddr, uint8_t regAddr, uint16_t *data, uint16
  * @return Number of bytes read (-1 indicates failure)
  */
 int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout) {
+    if (readHook != NULL) return readHook(devAddr, regAddr, length, data, timeout);
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -329,6 +331,13 @@ int8_t I2Cdev::readBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8
  * @return Number of words read (-1 indicates failure)
  */
 int8_t I2Cdev::readWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data, uint16_t timeout) {
+    if (readHook != NULL) {
+        if (length > 63) return -1; // bytes have to fit readBytes()' count
+        uint8_t *bytes = (uint8_t *)data; // read MSB, LSB pairs into the words' own memory, then put each pair together
+        if (readHook(devAddr, regAddr, length * 2, bytes, timeout) != length * 2) return -1;
+        for (uint8_t k = 0; k < length; k++) data[k] = ((uint16_t)bytes[k * 2] << 8) | bytes[k * 2 + 1];
+        return length;
+    }
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -586,6 +595,7 @@ bool I2Cdev::writeWord(uint8_t devAddr, uint8_t regAddr, uint16_t data) {
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t* data) {
+    if (writeHook != NULL) return writeHook(devAddr, regAddr, length, data);
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -647,6 +657,15 @@ bool I2Cdev::writeBytes(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_
  * @return Status of operation (true = success)
  */
 bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t* data) {
+    if (writeHook != NULL) {
+        uint8_t bytes[64];
+        if (length > sizeof(bytes) / 2) return false;
+        for (uint8_t k = 0; k < length; k++) {
+            bytes[k * 2] = data[k] >> 8; // MSB first
+            bytes[k * 2 + 1] = data[k] & 0xFF;
+        }
+        return writeHook(devAddr, regAddr, length * 2, bytes);
+    }
     #ifdef I2CDEV_SERIAL_DEBUG
         Serial.print("I2C (0x");
         Serial.print(devAddr, HEX);
@@ -709,6 +728,11 @@ bool I2Cdev::writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16
  */
 uint16_t I2Cdev::readTimeout = I2CDEV_DEFAULT_READ_TIMEOUT;
 
+/** Drivers that carry the traffic instead of Wire, when set. NULL = use Wire.
+ */
+I2CdevReadHook I2Cdev::readHook = NULL;
+I2CdevWriteHook I2Cdev::writeHook = NULL;
+
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
     // I2C library
     //////////////////////
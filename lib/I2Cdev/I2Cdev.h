@@ -3,6 +3,7 @@
 // 2013-06-05 by Jeff Rowberg <jeff@rowberg.net>
 //
 // Changelog:
+//      2026-10-16 - use ESP32 Wire's I2C_BUFFER_LENGTH (128) for BUFFER_LENGTH, so reads aren't split into 32 byte chunks
 //      2020-01-20 - hardija : complete support for Teensy 3.x
 //      2015-10-30 - simondlevy : support i2c_t3 for Teensy3.1
 //      2013-05-06 - add Francesco Ferrara's Fastwire v0.24 implementation with small modifications
@@ -98,6 +99,12 @@ THE SOFTWARE.
     #endif
 #endif
 
+// ESP32's Wire calls its 128 byte buffer size I2C_BUFFER_LENGTH, not BUFFER_LENGTH. Without this, readBytes() would
+// fall back to 32 byte chunks, each its own register write and read on the bus
+#if !defined(BUFFER_LENGTH) && defined(I2C_BUFFER_LENGTH)
+    #define BUFFER_LENGTH I2C_BUFFER_LENGTH
+#endif
+
 #ifdef SPARK
     #include <spark_wiring_i2c.h>
     #define ARDUINO 101
@@ -107,6 +114,11 @@ THE SOFTWARE.
 // 1000ms default read timeout (modify with "I2Cdev::readTimeout = [ms];")
 #define I2CDEV_DEFAULT_READ_TIMEOUT     1000
 
+// Hooks that let another driver carry the traffic instead of the I2CDEV_IMPLEMENTATION picked above, e.g. an engine
+// on the ESP-IDF I2C driver. Same arguments and returns as readBytes() and writeBytes(). NULL (default) = don't hook
+typedef int8_t (*I2CdevReadHook)(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout);
+typedef bool (*I2CdevWriteHook)(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data);
+
 class I2Cdev {
     public:
         I2Cdev();
@@ -130,6 +142,8 @@ class I2Cdev {
         static bool writeWords(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint16_t *data);
 
         static uint16_t readTimeout;
+        static I2CdevReadHook readHook;
+        static I2CdevWriteHook writeHook;
 };
 
 #if I2CDEV_IMPLEMENTATION == I2CDEV_BUILTIN_FASTWIRE
@@ -2780,6 +2780,87 @@ void MPU6050::getFIFOBytes(uint8_t *data, uint8_t length) {
      return 1;
 }
 
+/** Get the newest whole packet from the FIFO buffer, without ever waiting.
+ * GetCurrentFIFOPacket() above polls the count until it's exactly one packet,
+ * draining extras 32 bytes at a time, and after a reset can spin for up to
+ * 11 msec waiting for the next packet. This reads FIFO_COUNTH/L, then all the
+ * whole packets waiting in one more readBytes(), keeping the newest: two
+ * register reads whether there's one packet waiting or several. Each is a
+ * register address write then the read, and the packets only go in one read
+ * if they fit in BUFFER_LENGTH, which I2Cdev.h sets to ESP32 Wire's 128 bytes.
+ * With a 32 byte BUFFER_LENGTH, readBytes() splits them into 32 byte chunks.
+ * With no whole packet waiting it returns straight after the count.
+ *
+ * If a packet is part way into the FIFO, it's left there, to be whole by the
+ * next call, and only the whole ones before it are read. If the whole packets
+ * come to more than MPU6050_FIFO_BURST_MAX, the FIFO is reset rather than
+ * read, and the next packet in starts clean.
+ * @param data Buffer for the packet, length bytes
+ * @param length Packet size in bytes
+ * @param skipped Set to the number of older packets thrown away to get to the
+ * newest, or lost to a FIFO reset
+ * @return 1 when data has the newest packet, 0 when there's no whole packet
+ * yet, 2 when the FIFO was reset and there's no packet
+ */
+int8_t MPU6050::GetLatestFIFOPacket(uint8_t *data, uint8_t length, uint16_t *skipped) {
+    uint16_t fifoC = getFIFOCount();
+    int8_t plan = PlanLatestFIFORead(fifoC, length, skipped);
+    if (plan == 2) resetFIFO(); // overflowed, or too far behind to be worth reading
+    if (plan != 1) return plan;
+    uint8_t whole = fifoC / length * length; // leaves any packet still being written in the FIFO
+    if (whole == length) {
+        getFIFOBytes(data, length);
+        return 1;
+    }
+    uint8_t burst[MPU6050_FIFO_BURST_MAX];
+    getFIFOBytes(burst, whole); // older packets and the newest, in the one read
+    memcpy(data, burst + whole - length, length);
+    return 1;
+}
+
+/** Get every whole packet waiting in the FIFO buffer, oldest first, without ever waiting.
+ * The same two register reads as GetLatestFIFOPacket(), and the same reset
+ * when too much is waiting, but nothing is thrown away, so a caller can use
+ * every sample rather than just the newest.
+ * @param data Buffer for the packets, at least MPU6050_FIFO_BURST_MAX bytes
+ * @param length Packet size in bytes
+ * @param packets Set to the number of packets put in data
+ * @param skipped Set to the number of packets lost to a FIFO reset
+ * @return 1 when data has packets, 0 when there's no whole packet yet, 2 when
+ * the FIFO was reset and there are no packets
+ */
+int8_t MPU6050::GetAllFIFOPackets(uint8_t *data, uint8_t length, uint8_t *packets, uint16_t *skipped) {
+    *packets = 0;
+    uint16_t fifoC = getFIFOCount();
+    int8_t plan = PlanLatestFIFORead(fifoC, length, skipped);
+    if (plan == 2) resetFIFO(); // overflowed, or too far behind to be worth reading
+    if (plan != 1) return plan;
+    *packets = fifoC / length;
+    getFIFOBytes(data, *packets * length); // leaves any packet still being written in the FIFO
+    *skipped = 0; // all of them are kept
+    return 1;
+}
+
+/** Decide what GetLatestFIFOPacket() does with a FIFO count, without touching the bus.
+ * Split out so a driver that reads the FIFO some other way, e.g. asynchronously,
+ * can make the same decision.
+ * @param fifoC FIFO count, as read from FIFO_COUNTH/L
+ * @param length Packet size in bytes
+ * @param skipped Set to the number of packets that won't be used
+ * @return 1 to read the (fifoC / length) * length bytes of whole packets and keep
+ * the last length of them, 0 to read nothing, 2 to reset the FIFO
+ */
+int8_t MPU6050::PlanLatestFIFORead(uint16_t fifoC, uint8_t length, uint16_t *skipped) {
+    *skipped = 0;
+    if (fifoC < length) return 0; // nothing whole yet
+    uint16_t packets = fifoC / length;
+    if (packets * length > MPU6050_FIFO_BURST_MAX) { // overflowed, or too far behind to be worth reading
+        *skipped = packets;
+        return 2;
+    }
+    *skipped = packets - 1;
+    return 1;
+}
 
 /** Write byte to FIFO buffer.
  * @see getFIFOByte()
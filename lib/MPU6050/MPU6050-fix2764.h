@@ -57,6 +57,17 @@ THE SOFTWARE.
 #define BUFFER_LENGTH 32
 #endif
 
+// most bytes of whole packets GetLatestFIFOPacket() reads in one readBytes(): 4 of the 28 byte DMP packets (5 of 22),
+// under the 127 bytes I2Cdev::readBytes() can count, and under ESP32 Wire's 128 byte buffer, so it's one bus read, not
+// 32 byte chunks. More whole packets than this waiting and it resets the FIFO instead
+#define MPU6050_FIFO_BURST_MAX 112
+
+// what the MotionApps V6.12 DMP puts in each FIFO packet, for dmpSetFIFOFeatures(). Packets hold them in this order
+#define MPU6050_DMP_SEND_QUAT       0x01 // 6 axis low power quaternion, 16 bytes
+#define MPU6050_DMP_SEND_ACCEL      0x02 // accel, 6 bytes
+#define MPU6050_DMP_SEND_GYRO       0x04 // calibrated gyro, 6 bytes
+#define MPU6050_DMP_SEND_ALL        0x07 // what dmpInitialize() leaves it sending, 28 bytes
+
 #define MPU6050_ADDRESS_AD0_LOW     0x68 // address pin low (GND), default for InvenSense evaluation board
 #define MPU6050_ADDRESS_AD0_HIGH    0x69 // address pin high (VCC)
 #define MPU6050_DEFAULT_ADDRESS     MPU6050_ADDRESS_AD0_LOW
@@ -719,6 +730,9 @@ class MPU6050 {
         // FIFO_R_W register
         uint8_t getFIFOByte();
 		int8_t GetCurrentFIFOPacket(uint8_t *data, uint8_t length);
+        int8_t GetLatestFIFOPacket(uint8_t *data, uint8_t length, uint16_t *skipped);
+        static int8_t PlanLatestFIFORead(uint16_t fifoC, uint8_t length, uint16_t *skipped);
+        int8_t GetAllFIFOPackets(uint8_t *data, uint8_t length, uint8_t *packets, uint16_t *skipped);
         void setFIFOByte(uint8_t data);
         void getFIFOBytes(uint8_t *data, uint8_t length);
 
@@ -931,6 +945,9 @@ class MPU6050 {
             void dmpOverrideQuaternion(long *q);
             uint16_t dmpGetFIFOPacketSize();
             uint8_t dmpGetCurrentFIFOPacket(uint8_t *data); // overflow proof
+            int8_t dmpGetLatestFIFOPacket(uint8_t *data, uint16_t *skipped); // never waits
+            int8_t dmpGetAllFIFOPackets(uint8_t *data, uint8_t *packets, uint16_t *skipped); // never waits
+            uint8_t dmpSetFIFOFeatures(uint8_t features); // MPU6050_DMP_SEND_ bits, after dmpInitialize()
         #endif
 
         // special methods for MotionApps 4.1 implementation
@@ -1039,6 +1056,10 @@ class MPU6050 {
     #if defined(MPU6050_INCLUDE_DMP_MOTIONAPPS20) or defined(MPU6050_INCLUDE_DMP_MOTIONAPPS41)
         uint8_t *dmpPacketBuffer;
         uint16_t dmpPacketSize;
+        uint8_t dmpFeatures;     // MPU6050_DMP_SEND_ bits in each packet
+        int8_t dmpAccelOffset;   // where accel starts in a packet, -1 if it isn't sent
+        int8_t dmpGyroOffset;    // same for gyro
+        void dmpSetPacketLayout(uint8_t features);
     #endif
 };
 
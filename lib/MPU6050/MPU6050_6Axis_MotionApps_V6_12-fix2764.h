@@ -129,8 +129,12 @@ THE SOFTWARE.
  | [QUAT W][      ][QUAT X][      ][QUAT Y][      ][QUAT Z][      ] |
  |   0   1   2   3   4   5   6   7   8   9  10  11  12  13  14  15  |
  |                                                                  |
- | [GYRO X][GYRO Y][GYRO Z][ACC X ][ACC Y ][ACC Z ]					|
- |  16  17  18  19  20  21  22  23  24  25  26  27					|
+ | [ACC X ][ACC Y ][ACC Z ][GYRO X][GYRO Y][GYRO Z]                 |
+ |  16  17  18  19  20  21  22  23  24  25  26  27                  |
+ |                                                                  |
+ | dmpSetFIFOFeatures() can leave any of the three out. The rest    |
+ | close up, in the same order, e.g. quat + gyro is 22 bytes with   |
+ | GYRO at 16..21                                                   |
  * ================================================================ */
 
 // this block of memory gets written to the MPU on start-up, and it seems
@@ -376,15 +380,46 @@ uint8_t MPU6050::dmpInitialize() { // Lets get it over with fast Write everythin
 	I2Cdev::writeBit(devAddr,0x6A, 2, 1);      // Reset FIFO one last time just for kicks. (MPUi2cWrite reads 0x6A first and only alters 1 bit and then saves the byte)
 
   setDMPEnabled(false); // disable DMP for compatibility with the MPU6050 library
-/*
-    dmpPacketSize += 16;//DMP_FEATURE_6X_LP_QUAT
-    dmpPacketSize += 6;//DMP_FEATURE_SEND_RAW_ACCEL
-    dmpPacketSize += 6;//DMP_FEATURE_SEND_RAW_GYRO
-*/
-	dmpPacketSize = 28;
+	dmpSetPacketLayout(MPU6050_DMP_SEND_ALL); // the image above sends quaternion, accel and gyro
 	return 0;
 }
 
+// packet size and where each part starts, from the MPU6050_DMP_SEND_ bits the DMP is sending
+void MPU6050::dmpSetPacketLayout(uint8_t features) {
+    dmpFeatures = features;
+    dmpPacketSize = 0;
+    if (features & MPU6050_DMP_SEND_QUAT) dmpPacketSize += 16; //DMP_FEATURE_6X_LP_QUAT
+    dmpAccelOffset = (features & MPU6050_DMP_SEND_ACCEL) ? dmpPacketSize : -1;
+    if (features & MPU6050_DMP_SEND_ACCEL) dmpPacketSize += 6; //DMP_FEATURE_SEND_RAW_ACCEL
+    dmpGyroOffset = (features & MPU6050_DMP_SEND_GYRO) ? dmpPacketSize : -1;
+    if (features & MPU6050_DMP_SEND_GYRO) dmpPacketSize += 6; //DMP_FEATURE_SEND_CAL_GYRO
+}
+
+// DMP memory that decides what goes in the FIFO, as InvenSense's dmp_enable_feature() in inv_mpu_dmp_motion_driver.c writes it
+#define MPU6050_DMP_CFG_8   2718 // 6 axis quaternion: 0x20, 0x28, 0x30, 0x38 sends it, 0xA3s don't
+#define MPU6050_DMP_CFG_15  2727 // 0xA3, accel 0xC0, 0xC8, 0xC2, gyro 0xC4, 0xCC, 0xC6, 0xA3 x3. 0xA3s in place of either don't send it
+
+// Only put what's asked for in each FIFO packet. Call after dmpInitialize(), before setDMPEnabled(true).
+// Returns 0 if it worked, and 1 (with the packet layout unchanged) if the DMP memory write failed
+uint8_t MPU6050::dmpSetFIFOFeatures(uint8_t features) {
+    uint8_t quat[4] = {0xA3, 0xA3, 0xA3, 0xA3};
+    uint8_t send[10] = {0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3, 0xA3};
+    if (features & MPU6050_DMP_SEND_QUAT) {
+        quat[0] = 0x20; quat[1] = 0x28; quat[2] = 0x30; quat[3] = 0x38;
+    }
+    if (features & MPU6050_DMP_SEND_ACCEL) {
+        send[1] = 0xC0; send[2] = 0xC8; send[3] = 0xC2;
+    }
+    if (features & MPU6050_DMP_SEND_GYRO) {
+        send[4] = 0xC4; send[5] = 0xCC; send[6] = 0xC6;
+    }
+    if (!writeMemoryBlock(quat, sizeof(quat), MPU6050_DMP_CFG_8 >> 8, MPU6050_DMP_CFG_8 & 0xFF)) return 1;
+    if (!writeMemoryBlock(send, sizeof(send), MPU6050_DMP_CFG_15 >> 8, MPU6050_DMP_CFG_15 & 0xFF)) return 1;
+    dmpSetPacketLayout(features & MPU6050_DMP_SEND_ALL);
+    resetFIFO();    // anything already in there is the old size
+    return 0;
+}
+
 bool MPU6050::dmpPacketAvailable() {
     return getFIFOCount() >= dmpGetFIFOPacketSize();
 }
@@ -413,31 +448,31 @@ bool MPU6050::dmpPacketAvailable() {
 // uint8_t MPU6050::dmpSendEIS(uint_fast16_t elements, uint_fast16_t accuracy);
 
 uint8_t MPU6050::dmpGetAccel(int32_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpAccelOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    data[0] = (((uint32_t)packet[16] << 8) | packet[17]);
-    data[1] = (((uint32_t)packet[18] << 8) | packet[19]);
-    data[2] = (((uint32_t)packet[20] << 8) | packet[21]);
+    data[0] = (((uint32_t)packet[dmpAccelOffset + 0] << 8) | packet[dmpAccelOffset + 1]);
+    data[1] = (((uint32_t)packet[dmpAccelOffset + 2] << 8) | packet[dmpAccelOffset + 3]);
+    data[2] = (((uint32_t)packet[dmpAccelOffset + 4] << 8) | packet[dmpAccelOffset + 5]);
     return 0;
 }
 uint8_t MPU6050::dmpGetAccel(int16_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpAccelOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    data[0] = (packet[16] << 8) | packet[17];
-    data[1] = (packet[18] << 8) | packet[19];
-    data[2] = (packet[20] << 8) | packet[21];
+    data[0] = (packet[dmpAccelOffset + 0] << 8) | packet[dmpAccelOffset + 1];
+    data[1] = (packet[dmpAccelOffset + 2] << 8) | packet[dmpAccelOffset + 3];
+    data[2] = (packet[dmpAccelOffset + 4] << 8) | packet[dmpAccelOffset + 5];
     return 0;
 }
 uint8_t MPU6050::dmpGetAccel(VectorInt16 *v, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpAccelOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    v -> x = (packet[16] << 8) | packet[17];
-    v -> y = (packet[18] << 8) | packet[19];
-    v -> z = (packet[20] << 8) | packet[21];
+    v -> x = (packet[dmpAccelOffset + 0] << 8) | packet[dmpAccelOffset + 1];
+    v -> y = (packet[dmpAccelOffset + 2] << 8) | packet[dmpAccelOffset + 3];
+    v -> z = (packet[dmpAccelOffset + 4] << 8) | packet[dmpAccelOffset + 5];
     return 0;
 }
 uint8_t MPU6050::dmpGetQuaternion(int32_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (!(dmpFeatures & MPU6050_DMP_SEND_QUAT)) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
     data[0] = (((uint32_t)packet[0] << 24) | ((uint32_t)packet[1] << 16) | ((uint32_t)packet[2] << 8) | packet[3]);
     data[1] = (((uint32_t)packet[4] << 24) | ((uint32_t)packet[5] << 16) | ((uint32_t)packet[6] << 8) | packet[7]);
@@ -446,7 +481,7 @@ uint8_t MPU6050::dmpGetQuaternion(int32_t *data, const uint8_t* packet) {
     return 0;
 }
 uint8_t MPU6050::dmpGetQuaternion(int16_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (!(dmpFeatures & MPU6050_DMP_SEND_QUAT)) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
     data[0] = ((packet[0] << 8) | packet[1]);
     data[1] = ((packet[4] << 8) | packet[5]);
@@ -455,7 +490,6 @@ uint8_t MPU6050::dmpGetQuaternion(int16_t *data, const uint8_t* packet) {
     return 0;
 }
 uint8_t MPU6050::dmpGetQuaternion(Quaternion *q, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
     int16_t qI[4];
     uint8_t status = dmpGetQuaternion(qI, packet);
     if (status == 0) {
@@ -470,27 +504,27 @@ uint8_t MPU6050::dmpGetQuaternion(Quaternion *q, const uint8_t* packet) {
 // uint8_t MPU6050::dmpGet6AxisQuaternion(long *data, const uint8_t* packet);
 // uint8_t MPU6050::dmpGetRelativeQuaternion(long *data, const uint8_t* packet);
 uint8_t MPU6050::dmpGetGyro(int32_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpGyroOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    data[0] = (((uint32_t)packet[22] << 8) | packet[23]);
-    data[1] = (((uint32_t)packet[24] << 8) | packet[25]);
-    data[2] = (((uint32_t)packet[26] << 8) | packet[27]);
+    data[0] = (((uint32_t)packet[dmpGyroOffset + 0] << 8) | packet[dmpGyroOffset + 1]);
+    data[1] = (((uint32_t)packet[dmpGyroOffset + 2] << 8) | packet[dmpGyroOffset + 3]);
+    data[2] = (((uint32_t)packet[dmpGyroOffset + 4] << 8) | packet[dmpGyroOffset + 5]);
     return 0;
 }
 uint8_t MPU6050::dmpGetGyro(int16_t *data, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpGyroOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    data[0] = (packet[22] << 8) | packet[23];
-    data[1] = (packet[24] << 8) | packet[25];
-    data[2] = (packet[26] << 8) | packet[27];
+    data[0] = (packet[dmpGyroOffset + 0] << 8) | packet[dmpGyroOffset + 1];
+    data[1] = (packet[dmpGyroOffset + 2] << 8) | packet[dmpGyroOffset + 3];
+    data[2] = (packet[dmpGyroOffset + 4] << 8) | packet[dmpGyroOffset + 5];
     return 0;
 }
 uint8_t MPU6050::dmpGetGyro(VectorInt16 *v, const uint8_t* packet) {
-    // TODO: accommodate different arrangements of sent data (ONLY default supported now)
+    if (dmpGyroOffset < 0) return 1; // not being sent
     if (packet == 0) packet = dmpPacketBuffer;
-    v -> x = (packet[22] << 8) | packet[23];
-    v -> y = (packet[24] << 8) | packet[25];
-    v -> z = (packet[26] << 8) | packet[27];
+    v -> x = (packet[dmpGyroOffset + 0] << 8) | packet[dmpGyroOffset + 1];
+    v -> y = (packet[dmpGyroOffset + 2] << 8) | packet[dmpGyroOffset + 3];
+    v -> z = (packet[dmpGyroOffset + 4] << 8) | packet[dmpGyroOffset + 5];
     return 0;
 }
 // uint8_t MPU6050::dmpSetLinearAccelFilterCoefficient(float coef);
@@ -621,4 +655,12 @@ uint8_t MPU6050::dmpGetCurrentFIFOPacket(uint8_t *data) { // overflow proof
     return(GetCurrentFIFOPacket(data, dmpPacketSize));
 }
 
+int8_t MPU6050::dmpGetLatestFIFOPacket(uint8_t *data, uint16_t *skipped) { // never waits
+    return(GetLatestFIFOPacket(data, dmpPacketSize, skipped));
+}
+
+int8_t MPU6050::dmpGetAllFIFOPackets(uint8_t *data, uint8_t *packets, uint16_t *skipped) { // never waits
+    return(GetAllFIFOPackets(data, dmpPacketSize, packets, skipped));
+}
+
 #endif /* _MPU6050_6AXIS_MOTIONAPPS20_H_ */
@@ -12,6 +12,94 @@
  * @ref https://semver.org/
  * YYYY-MM-DD Description
  * ---------- ----------------------------------------------------------------------------------------------------------------
+ * 2026-10-16     - with imuInterruptDriven true, balance.tmrIMU is pinned to dmpPeriodMsec, the 10 msec between DMP
+ *                  interrupts, so the D slope, biquad designs, outer loop dt and jitter all use the real control period.
+ *                  setvar BALANCE.TMRIMU is ignored in that mode
+ * 2026-10-16     - controlTask does no OLED or MQTT work. Balance telemetry rows go to housekeeping() through the balTelRows
+ *                  queue, and waking up (bs_sleep to bs_awake) through the wakeUps commandBlock, and housekeeping() does
+ *                  the publishing and the left OLED update. Rows dropped because housekeeping was behind go in health telemetry
+ * 2026-10-16     - setvar BALANCE.TILTSOURCE only takes ts_dmp or ts_raw. Anything else is ignored and counted as a bad
+ *                  setvar, rather than being stored, reported by publishParams() and run as the DMP
+ * 2026-10-16     - gain schedule's |wheel speed| comes from balCore.speedTable, built with ticksTable, for last cycle's pid,
+ *                  instead of a float divide of the last tick setting every cycle
+ * 2026-10-16     - balanceByState() runs speeds slower than slowTicks at slowTicks, and only stops the wheels below
+ *                  stateCreepFraction of that, rather than stopping for anything under about 4 in/s
+ * 2026-10-16     - at a fall, motors stop first. The run's statistics go to getHealthTelemetry() through the runResults
+ *                  commandBlock, and it publishes /balRun, so controlTask doesn't build Strings or publish MQTT
+ * 2026-10-16     - DMP FIFO reads take only the whole packets when one's still being written, instead of waiting for the
+ *                  next cycle. I2Cdev uses ESP32 Wire's 128 byte buffer, so the packets come in one bus read, not 32 byte chunks
+ * 2026-10-16     - i2cBusTask runs one priority above controlTask, so startReadIMU()'s read goes on the bus at once and
+ *                  overlaps updateOdometry(), now done before imuCycle(). IMU bus read time added to health telemetry
+ * 2026-10-16     - loadBalanceCore() builds a whole balanceParams snapshot, range checked iCount, ticksTable, speedTable &
+ *                  biquad designs included, and hands it to controlTask through the coreParams commandBlock. controlTask
+ *                  load()s it into balCore between cycles, instead of the MQTT task writing balCore while step() runs
+ * 2026-10-16     - float path tilt from tiltFromQ14(): roll only, straight from the Q14 quaternion, instead of
+ *                  dmpGetGravity() & dmpGetYawPitchRoll() working out yaw & pitch too. tiltPolyAtan2 true swaps atan2f()
+ *                  for polyAtan2Deg()
+ * 2026-10-16     - DMP packets only carry dmpFifoFeatures: quaternion & gyro, 22 bytes instead of 28 with accel, which
+ *                  readIMU() never used. mpu.dmpSetFIFOFeatures() writes the DMP's FIFO output config after dmpInitialize().
+ *                  What that does to readIMU() time hasn't been measured on the robot
+ * 2026-10-16     - setvar BALANCE.DMPBATCH 1 reads every DMP packet waiting each cycle in one burst, and runs each one
+ *                  through balCore.sample(): tilt filter bank and D filter at the DMP's 100 Hz rather than once per
+ *                  tmrIMU. Samples per cycle added to balance telemetry. 0 (default) = newest packet only, as before
+ * 2026-10-16     - optional asynchronous IMU bus: with imuAsyncI2C true, the i2cAsync engine (i2c_async.h) owns the IMU's
+ *                  I2C port on the ESP-IDF driver, in its own i2cBusTask, and carries all I2Cdev traffic through hooks.
+ *                  controlTask starts the DMP FIFO read with startReadIMU() as soon as it wakes, and readIMU() waits
+ *                  for it only once there's nothing else to do
+ * 2026-10-16     - readIMU() gets the DMP packet with mpu.dmpGetLatestFIFOPacket(): FIFO count then every whole packet
+ *                  waiting in one burst, keeping the newest. Never waits for a packet. Packets skipped to get to the
+ *                  newest, and FIFO resets, counted in health telemetry
+ * 2026-10-16     - per run balance statistics (run_stats.h), from entering bs_active to falling out of it: RMS & peak
+ *                  tilt error, % of cycles in the dead band and saturated, and time to fall. Published on /balRun at the fall
+ * 2026-10-16     - relay feedback autotuner (relay_autotune.h): AUTOTUNE command has balanceByAngle() drive the wheels
+ *                  bang-bang around the target angle, measures Ku & Tu from the rocking, and publishes Ziegler-Nichols
+ *                  and Tyreus-Luyben gains on /tunRes. AUTOTUNE,STOP to stop. setvar BALANCE.TUNEPID, BALANCE.TUNEHYST
+ * 2026-10-16     - tilt oscillation detector (oscillation_monitor.h) in low priority oscillationTask: Goertzel spectrum
+ *                  of the last oscSamples tilts while bs_active. Peak Hz, peak amplitude and band RMS in health telemetry.
+ *                  setvar BALANCE.OSCLOHZ/OSCHIHZ set the band, BALANCE.OSCWARN the band RMS that raises a warning event
+ * 2026-10-16     - biquad filter banks (biquad.h) on balCore's tilt input and D part, up to bqSections low pass or
+ *                  notch sections each, designed on the robot from hz & Q. setvar BALANCE.TILTBQ / BALANCE.DBQ with
+ *                  value section,type,hz,q. Type 0 (default) = off
+ * 2026-10-16     - gain schedule (gain_schedule.h): P, I & D interpolated from a 4x4 grid over |tilt error| and |wheel
+ *                  speed| each balanceByAngle() cycle. Grid loaded by MQTT GAINSCHED command as one binary blob, handed
+ *                  to controlTask whole through a commandBlock. setvar BALANCE.GAINSCHED 1 to use it, 0 (default) = off
+ * 2026-10-16     - add bm_state balance method: full state feedback (state_feedback.h) on tilt, tilt rate, wheel position
+ *                  & wheel speed, gains from host tool tools/lqr_gains by discrete LQR. setvar BALANCE.METHOD and
+ *                  BALANCE.LQRTILT/LQRRATE/LQRPOS/LQRVEL. Balance telemetry moved out to publishBalanceTelemetry()
+ * 2026-10-16     - outer position & velocity loop (outer_loop.h) every outerEvery balance cycles leans balCore's target
+ *                  angle off balance.targetAngle to hold position, or track BALANCE.VELCMD. setvar BALANCE.POSGAIN,
+ *                  VELGAIN, OUTERMAX. Gains default to 0, i.e. off. Position & velocity errors and target in balTel
+ * 2026-10-16     - wheel odometry: step generators count signed steps per wheel (getSteps()), and controlTask feeds
+ *                  them to a sliding window speed estimator (wheel_odometry.h) each cycle. Lock free wheelSnapshot for
+ *                  any task to read. Step counts and speeds added to health telemetry
+ * 2026-10-16     - sg_softISR no longer turns interrupts off to take new speeds. setTicks() publishes them to a double
+ *                  buffered, sequence numbered commandBlock (step_command.h) that the ISR picks up from on its next tick
+ * 2026-10-16     - acceleration limit in the step generator ISRs (step_ramp.h): each step's speed moves toward the last
+ *                  setTicks() value by at most balance.maxAccel steps/s/s, so wheels no longer jump between speeds or
+ *                  reverse mid step. setvar BALANCE.MAXACCEL, 0 = off (as before). Not available with sg_mcpwm
+ * 2026-10-16     - add sg_eventISR step generator backend: timer alarm set for the next STEP edge, so interrupts scale
+ *                  with step rate and edges are timed to the microsecond
+ * 2026-10-16     - step pulses come from a stepGenerator backend, picked by stepGenBackend: the old timer ISR, moved to
+ *                  step_gen_soft.h, or MCPWM hardware (step_gen_mcpwm.h). Callers just set signed ticks per step. The
+ *                  reversal abort (9999) moved into the software backend, which is the only one that needs it
+ * 2026-10-16     - microsecond histograms of control cycle period, readIMU, balanceByAngle and IMU sample to tickSetting
+ *                  latency. min/p50/p90/p99/max added to health telemetry every second, restarted by TIMINGRESET command
+ * 2026-10-16     - add balance.tiltSource. ts_raw skips the DMP: controlTask reads raw accel & gyro at 1 kHz and a single
+ *                  axis complementary filter (tilt_estimator.h) supplies tilt and tilt rate. setvar BALANCE.TILTSOURCE/ESTTAU
+ * 2026-10-16     - with gyroRateDTerm true the D part of PID is the DMP's measured tilt rate rather than the difference of
+ *                  the last two errors, so it no longer lags a cycle or needs pidICount >= 2. Optional filter via BALANCE.DFILTER
+ * 2026-10-16     - balancing runs in controlTask, pinned to the Arduino core at the highest priority we use. Everything
+ *                  else that was in loop() now runs in housekeeping() from a low priority task on the other core, and
+ *                  loop() deletes itself. Worst control cycle jitter vs tmrIMU is added to health telemetry
+ * 2026-10-16     - optional interrupt driven IMU: with imuInterruptDriven true, gp_IMU_INT wakes a high priority imuTask
+ *                  that reads the one waiting DMP packet and balances, instead of loop() polling every tmrIMU.
+ *                  Moved the body of loop()'s goIMU branch into imuCycle() so both paths share it
+ * 2026-10-16     - replace per cycle ground speed math with balCore.ticksTable, rebuilt in loadBalanceCore() only when
+ *                  slowTicks, fastTicks or wheel geometry change. Removed unused motorPrecalc
+ * 2026-10-16     - move the PID math and error ring buffer into balanceCore<> (balance_core.h), templated on number type.
+ *                  controlFixedPoint = true runs it in Q16.16, with tilt taken straight from the DMP's Q30 quaternion
+ * 2026-10-16     - keep PID error history in a ring buffer with a running sum, so the I average and the D term's previous
+ *                  error cost the same no matter how big pidICount is. Full resum every errResumCycles to wash out drift
  * 2021-03-02 AM: - Changed Doug's default setting for P, I and D as well as MQTT IP Address.
  * 2021-02-14 AM: - Renamed updateMetaData() to getHealthTelemetry(). Got rid of duplicate time stamp of get command responses.
  * 2021-02-13 AM: - updated cfgByMAC() for Andrew's robot with new calibration numbers, new default balance numbers, and turn 
@@ -230,6 +318,34 @@
 // our own creation
 #include <known_networks.h>                         // Defines Access points and passwords that the robot can scan for and connect to
 // our own creation
+#include <balance_core.h>                           // PID math for balanceByAngle, in float or Q16.16 fixed point
+// our own creation
+#include <tilt_estimator.h>                         // complementary filter tilt from raw accel & gyro, for ts_raw
+// our own creation
+#include <timing_histogram.h>                       // microsecond histograms of control loop timing, for health telemetry
+// our own creation
+#include <step_gen_soft.h>                          // timer ISR step pulse generator
+// our own creation
+#include <step_gen_mcpwm.h>                         // MCPWM hardware step pulse generator
+// our own creation
+#include <step_gen_event.h>                         // timer alarm per STEP edge step pulse generator
+// our own creation
+#include <wheel_odometry.h>                         // wheel speeds from step counts, for telemetry and outer loops
+// our own creation
+#include <outer_loop.h>                             // position & velocity loop that adjusts targetAngle
+// our own creation
+#include <state_feedback.h>                         // full state feedback balancing, for bm_state
+// our own creation
+#include <gain_schedule.h>                          // PID gains interpolated by tilt and wheel speed
+// our own creation
+#include <oscillation_monitor.h>                    // spectrum of tilt, to catch chatter from too much gain
+// our own creation
+#include <relay_autotune.h>                         // relay feedback PID autotuner
+// our own creation
+#include <run_stats.h>                              // how well each balancing run went
+// our own creation
+#include <i2c_async.h>                              // I2C transactions queued to a bus task, on the ESP-IDF driver
+// our own creation
 #include <AsyncMqttClient.h> // for Message Queuing Telemetry Support
 // from https://github.com/marvinroger/async-mqtt-clientFupOLED()
 
@@ -242,6 +358,8 @@
 // Comes with Platform.io ?
 #include <freertos/queue.h>         // Required to use FreeRTOS the function uxQueueMessagesWaiting. Used for motor driver control
 // Comes with Platform.io ?
+#include "freertos/task.h"          // Required for xTaskCreatePinnedToCore and task notifications. Used for interrupt driven IMU reads
+// Comes with Platform.io ?
 
 // Precompiler directives for debug output 
 #define DEBUG true                  // Turn debug tracing on/off
@@ -269,14 +387,30 @@
 // Define which core the Arduino environment is running on
 #if CONFIG_FREERTOS_UNICORE    // If this is an SOC with only 1 core
 #define ARDUINO_RUNNING_CORE 0 // Arduino is running on that one core
+#define HOUSEKEEPING_CORE 0    // so is everything else
 #else                          // If this is an SOC with more than one core (2 is the ony other option at ths point)
-#define ARDUINO_RUNNING_CORE 1 // Arduino is running on the second core
+#define ARDUINO_RUNNING_CORE 1 // Arduino is running on the second core. controlTask gets it to itself
+#define HOUSEKEEPING_CORE 0    // OLED, LED, WiFi events and health telemetry share the first core with the WiFi stack
 #endif
 
 #define MQTTQos 1                     // use Quality of Service level 1 or 0? (0 has less overhead)
 bool OLED_enable = true;              // allow disabling OLED for performance troubleshooting
 // #define selectiveISum true            // only use the I in PID if it pushes us towrds vertical, not away from it
 #define wifiDelay 3000                // number of milliseconds to wait between WiFi connect attempts
+#define controlFixedPoint false       // run balanceByAngle math in Q16.16 fixed point (true) or float (false)
+#define gyroRateDTerm true            // D part of PID from the DMP's gyro rate (true) or from differences of angle errors (false)
+#define tiltPolyAtan2 false           // float path tilt from polyAtan2Deg(), good to 0.001 degrees (true), or atan2f() (false)
+#define sg_softISR 1                  // values for stepGenBackend: timer ISR bit bangs STEP pulses, see step_gen_soft.h
+#define sg_mcpwm 2                    // MCPWM peripheral makes STEP pulses, see step_gen_mcpwm.h
+#define sg_eventISR 3                 // timer alarm set for each STEP edge, see step_gen_event.h
+#define stepGenBackend sg_softISR     // which step pulse generator drives the motors
+#define imuInterruptDriven false      // run each IMU cycle when gp_IMU_INT fires (true), or every tmrIMU milliseconds (false)
+#define imuAsyncI2C false             // IMU's I2C traffic through the i2cAsync engine on the ESP-IDF driver (true), or Wire (false)
+#define dmpFifoFeatures (MPU6050_DMP_SEND_QUAT | MPU6050_DMP_SEND_GYRO) // what's in each DMP packet. readIMU() doesn't use accel
+#define controlTaskPriority (configMAX_PRIORITIES - 2) // highest we use, just under the system's IPC tasks
+#define i2cBusTaskPriority (controlTaskPriority + 1) // above controlTask, so a submit() starts the transfer straight away
+#define housekeepingTaskPriority 1    // same as Arduino's loop() task it replaces
+#define oscillationTaskPriority 1     // oscillationTask's analyses can wait behind anything else
 
 // struct robotAttributes attribute definition =========================================
 typedef struct
@@ -327,8 +461,9 @@ bool blinkState = false;
 // Note that we are using Yaw/Pitch/Roll which might suffer from gimble lock http://en.wikipedia.org/wiki/Gimbal_lock
 MPU6050 mpu;            // GY521 default I2C address
 uint8_t devStatus;      // return status after each device operation (0 = success, !0 = error)
-uint16_t packetSize;    // expected DMP packet size (default is 42 bytes)
+uint16_t packetSize;    // expected DMP packet size, from dmpFifoFeatures (22 bytes for quaternion & gyro)
 uint8_t fifoBuffer[64]; // FIFO storage buffer
+uint8_t fifoBatch[MPU6050_FIFO_BURST_MAX]; // every packet waiting, oldest first, when balance.dmpBatch is 1
 Quaternion q;           // [w, x, y, z]         quaternion container
 VectorInt16 aa;         // [x, y, z]            accel sensor measurements
 VectorInt16 gy;         // [x, y, z]            gyro sensor measurements
@@ -394,6 +529,8 @@ Commands for any activity are sent to the robot using the topic "commands"
 #define MQTTTop_hthCtl "/hthCtl"                      // outgoing reply to request to get health control params
 #define MQTTTop_cfgCtl "/cfgCtl"                      // outgoing reply to request to get configuration control params
 #define MQTTTop_shtCom "/shtCom"                      // outgoing spreadsheet comment topic
+#define MQTTTop_tunRes "/tunRes"                      // outgoing autotune results
+#define MQTTTop_balRun "/balRun"                      // outgoing summary of each balancing run
 
 #define MQTTTop_commands "/commands"                    // incoming commands from MQTT topic
 
@@ -421,21 +558,17 @@ String cntlParmHeadingMQTT = "NOTHING"; // Full path to outgoing control paramet
 String cntlParmMQTT = "NOTHING"; // Full path to outgoing control parameter topic to MQTT broker
 
 // Define global motor control variables and structures.
-#define motorISRus 20               // Number of microseconds between motor ISR calls
-hw_timer_t *motorTimer = NULL;      // Pointer to motor ISR
-float motorPrecalc = 0;             // holds precalculation to optimize balanceByAngle's calculation of motorInt
-
-// stepperMotor struct definition, one per wheel.  ==================================================
-typedef struct
-{
-  // interrupt level variables...
-  volatile int tickCounter;                    // working counter of 20uS timer ticks in motor controller ISR
-  volatile int tickLimit;                      // limit that determines step length in timer ticks
-  volatile int tickSetting;                    // value for current limit, as calculated in BalancceByAngle()
-
-} motorControl;                               // Structure for stepper motors that drive the robot
-static volatile motorControl left;            // Define a struct for left  wheel, example:  left.tickCounter
-static volatile motorControl right;           // Define a struct for right wheel, example: right.tickCounter
+// Step pulses are made by the backend picked with stepGenBackend. Left wheel is on DRV2, right wheel on DRV1
+#if stepGenBackend == sg_mcpwm
+   stepGenMcpwm mcpwmSteps(gp_DRV2_STEP, gp_DRV2_DIR, gp_DRV1_STEP, gp_DRV1_DIR);
+   stepGenerator *motors = &mcpwmSteps;
+#elif stepGenBackend == sg_eventISR
+   stepGenEventISR eventSteps(gp_DRV2_STEP, gp_DRV2_DIR, gp_DRV1_STEP, gp_DRV1_DIR);
+   stepGenerator *motors = &eventSteps;
+#else
+   stepGenSoftISR softSteps(gp_DRV2_STEP, gp_DRV2_DIR, gp_DRV1_STEP, gp_DRV1_DIR);
+   stepGenerator *motors = &softSteps;
+#endif
 
 // Define global control variables.
 #define NUMBER_OF_MILLI_DIGITS 10 // Millis() uses unsigned longs (32 bit). Max value is 10 digits (4294967296ms or 49 days, 17 hours)
@@ -444,20 +577,36 @@ static volatile motorControl right;           // Define a struct for right wheel
 #define tmrOLED 200               // Milliseconds to wait between sending data to OLED over I2C
 #define tmrMETADATA 1000          // Milliseconds to wait between sending data to serial port
 #define tmrLED 1000 / 2           // Milliseconds to wait between flashes of LED (turn on / off twice in this time)
-int goIMU = 0;                    // Target time for next read of IMU data
 int goOLED = 0;                   // Target time for next OLED update
 int goMETADATA = 0;               // Target time for next serial port
 int goLED = 0;                    // Target time for next toggle of LED
+#define imuTimeout 100            // Milliseconds controlTask waits for a gp_IMU_INT interrupt before counting data as missing
+#define controlTaskStack 12288    // Bytes of stack for controlTask. loop()'s 8192, plus room for coreParams.fetch()'s copy
+#define balTelQueueLength 32      // balance telemetry rows controlTask can get ahead of housekeepingTask by, ~0.4 s of cycles
+#define housekeepingTaskStack 8192 // Bytes of stack for housekeepingTask. Same as loop(), whose work it took over
+#define oscillationTaskStack 4096 // Bytes of stack for oscillationTask. analyse() keeps one window of floats on it
+#define i2cBusTaskStack 2048      // Bytes of stack for i2cBusTask. Just a command link and the callbacks
+TaskHandle_t controlTaskHandle = NULL; // controlTask, woken by dmpDataReady() when imuInterruptDriven is true
+TaskHandle_t housekeepingTaskHandle = NULL; // housekeepingTask, running what used to be in loop()
+unsigned long ctlLastStart = 0;   // micros() at start of previous control cycle, for jitter measurement
+volatile unsigned long imuSampleMicros = 0; // micros() when the IMU sample being balanced on was taken, for latency
+timingHistogram th_period;        // control cycle start to start
+timingHistogram th_readIMU;       // readIMU() duration
+timingHistogram th_balance;       // balanceByAngle() duration, including its telemetry
+timingHistogram th_latency;       // IMU sample to tickSetting update
+timingHistogram th_imuBus;        // startReadIMU() to the FIFO read being done in i2cBusTask. Empty unless imuAsyncI2C is true
+volatile bool th_resetPending = false; // set by the TIMINGRESET command, acted on by controlTask, which owns the histograms
 // multi-purpose timestamp holders for telemetry purposes
 unsigned long telMilli1;          // timestamp used for telemetry reporting
-unsigned long holdMilli1;         // need to keep last value to calculate delta time for goIMU calls
+unsigned long holdMilli1;         // need to keep last value to calculate delta time between control cycles
 unsigned long telMilli2;          // timestamp used for telemetry reporting
 unsigned long telMilli3;          // timestamp used for telemetry reporting
 unsigned long telMilli4;          // timestamp used for telemetry reporting
 unsigned long telMilli5;          // timestamp used for telemetry reporting
 
-unsigned long tm_IMUdelta;        // telemetry value: measured time between goIMU calls. should be tmrIMU
-unsigned long tm_readFIFO;        // telemetry value: how long the mpu.dmpGetCurrentFIFOPacket(fifoBuffer) execution took
+unsigned long tm_IMUdelta;        // telemetry value: measured time between control cycles. should be tmrIMU
+unsigned long tm_readFIFO;        // telemetry value: how long the mpu.dmpGetLatestFIFOPacket(fifoBuffer) execution took
+int tm_dmpSamples;                // telemetry value: IMU samples made since the last cycle, whether balancing used them all or not
 unsigned long tm_dmpGet;          // telemetry value: how long the dmpGet* calls after above call took
 unsigned long tm_allReadIMU;      // telemetry value: how long the readIMU execution took
 unsigned long tm_OldbalByAng;     // telemetry value: how long the PREVIOUS balanceByAngle took
@@ -476,7 +625,7 @@ int cu_loopStart = 0;             // timestamp for start of current loop() inter
 int cu_lastLoopEnd = 0;           // timestamp for end of loop() before OS does it's stuff
 
 // CPU usage measurements, in microseconds
-int cu_IMU = 0;                   // time spent in goIMU controlled part of main loop
+int cu_IMU = 0;                   // time spent in controlTask (on its own core, so not part of housekeeping's second)
 int cu_wifi = 0;                  // time spent in wifi processing in main loop
 int cu_OLED = 0;                  // time spent in goOLED controlled part of main loop
 int cu_LED = 0;                   // time spent in goLED controlled part of main loop
@@ -487,7 +636,7 @@ int cu_other = 0;                 // time spent in "none of the above", i.e. wha
 int cu_mqtt = 0;                  // time spent in asynchronous MQTT handling routines
 
 // CPU usage measurements, as integer percents, rounded down, for display purposes
-int cu$IMU = 0;                   // time spent in goIMU controlled part of main loop
+int cu$IMU = 0;                   // time spent in controlTask, as % of its core
 int cu$wifi = 0;                  // time spent in wifi processing in main loop
 int cu$OLED = 0;                  // time spent in goOLED controlled part of main loop
 int cu$LED = 0;                   // time spent in goLED controlled part of main loop
@@ -518,7 +667,7 @@ int cu$mqtt = 0;                  // time spent in asynchronous MQTT handling ro
 //              0     printBinary
 // runbit(12)   1     publishMQTT
 // runbit(13)   1     stepMotor
-// runbit(14)   1     IRAM_ATTR motorTimerISR
+// runbit(14)   1     IRAM_ATTR stepGenSoftISR::isr (was motorTimerISR)
 // runbit(15)___1     unused
 // runbit(16)   1     calcBalanceParmeters
 //              0     balanceByAngle
@@ -568,8 +717,14 @@ typedef struct
    // values for balance.method, the next variable in struct
      #define bm_catchup 1   // method based on catchup distance that would pull wheels under the center of mass
      #define bm_angle 2     // method based on applying correction based in PID applied to angle difference from vertical
+     #define bm_state 3     // method based on feedback of tilt, tilt rate, wheel position and wheel speed, see state_feedback.h
      #define bm_initialMethod bm_angle    // use this balancing method to start, initialized in setupIMU
    int method;                                // are we using catchup distance balancing method, or angle based PID (see defs above)
+     // values for balance.tiltSource, the next variable in struct
+     #define ts_dmp 1       // tilt from the DMP's quaternion, read from its FIFO
+     #define ts_raw 2       // tilt from tiltEstimator, fed raw accel & gyro every rawImuPeriod milliseconds
+   int tiltSource = ts_dmp;                   // where tilt comes from (see defs above). Changeable by setvar
+   float estTau = 0.5;                        // seconds it takes tiltEstimator's accelerometer side to pull in gyro drift
      // values for balance.state, the next variable in struct
      #define bs_sleep 0     // inactive. from lying on back until 30 degrees from vertical
      #define bs_awake 1     // within 30 degrees of initial vertical, but still not active
@@ -587,6 +742,31 @@ typedef struct
    int fastTicks;               // # of 20uS timer interrupts per step at fastest practical speed
    int directionMod = 1;        // controls if motor direction needs to be reversed base on motor hardware
    float smoother = 0 ;         // smooth changes in speed by using new = old + smoother * (new - old). smoother=0 > disable smoothing 
+   float maxAccel = 0;          // most a wheel's speed may change, in steps per second per second, step by step. 0 = no limit
+   float posGain = 0;           // outer loop: degrees of lean per inch from hold point. 0 = off
+   float velGain = 0;           // outer loop: degrees of lean per inch/second off velCommand. 0 = off
+   float outerMax = 3;          // outer loop: most it can move the target angle away from targetAngle, degrees
+   float velCommand = 0;        // outer loop: inches/second to travel at, positive is forward
+   float outerPosErr = 0;       // outer loop: inches from hold point, for telemetry
+   float outerVelErr = 0;       // outer loop: inches/second off velCommand, for telemetry
+   float outerTarget = 0;       // targetAngle plus outer loop adjustment, i.e. what balanceByAngle is aiming for
+   float lqrTilt = 0;           // bm_state gain on tilt error, inches/second/second per degree. From tools/lqr_gains
+   float lqrRate = 0;           // bm_state gain on tilt rate, per degree/second
+   float lqrPos = 0;            // bm_state gain on wheel position from hold point, per inch
+   float lqrVel = 0;            // bm_state gain on wheel speed, per inch/second
+   int gainSched = 0;           // 1 = P, I & D from the gain schedule loaded by GAINSCHED, 0 = from pidPGain etc.
+   int tiltBqType[bqSections];  // tilt filter bank: each section's type (bq_off etc, see biquad.h), Hz and Q
+   float tiltBqHz[bqSections];
+   float tiltBqQ[bqSections];
+   int dBqType[bqSections];     // D part filter bank, the same way
+   float dBqHz[bqSections];
+   float dBqQ[bqSections];
+   float oscLoHz = 3;           // oscillation monitor: band of tilt frequencies to watch for chatter
+   float oscHiHz = 40;
+   float oscWarn = 0;           // oscillation monitor: band RMS degrees that raises a warning event. 0 = no warnings
+   float tunePid = 100;         // autotune: relay amplitude, in pid units
+   float tuneHyst = 0.3;        // autotune: degrees of error either side of 0 before the relay flips
+   int dmpBatch = 0;            // 1 = every DMP packet waiting each cycle goes through the tilt & D filters, 0 = newest only
    float pid;                   // overall value for "Proportional Integral Derivative (PID)" feedback algorithm
    float pidRaw;                // copy of PID before range checking, for telemetry
    int dataCount = 0;           // number of balance data telemetry messages we've sent
@@ -595,18 +775,83 @@ typedef struct
    int  pidICount = 0;          // number of recent errors to include in I part of PID
    float pidISum = 0;           // the sum if last pidICount error values, used for I part of PID
    float pidDGain = 0;          // multiplier for the D part of PID
-   float pidDSlope = 0;         // slope between last 2 error values, used for D part of PID
+   float pidDSlope = 0;         // slope between last 2 error values, or gyro tilt rate, used for D part of PID
+   float dFilter = 0;           // filter gyro rate for D using new = dFilter * old + (1 - dFilter) * rate. 0 = disable filter
    int motorTicks;              // motor speed, i.e. interval between steps in timer ticks
    int lastSpeed = 0;           // memory for above method using smoother
    float angleErr = 0;          // difference between current angle and target angle
-   int tmrIMU = 12;             // number of milliseconds between calls to readIMU, and balance calculations
-   float errHistory[200] ;                    //  remembered angle errors for calculating I in PID
+   int tmrIMU = 12;             // number of milliseconds between calls to readIMU, and balance calculations. dmpPeriodMsec with imuInterruptDriven
    float centreOfMassError = attribute.heightCOM; // Distance in inches robot's Centre Of Mass (COM) is away from target
    float distancePercentage;                  // Percentage of COM height away from target
    int steps;                                 // Number of steps that it will take to get to target angle
 }  balanceControl;                            // Structure for handling robot balancing calculations
 volatile balanceControl balance;             // Object for calculating robot balance
 
+#if controlFixedPoint == true
+   typedef q16 ctl_t;                         // number type used by balanceByAngle's math
+#else
+   typedef float ctl_t;
+#endif
+balanceCore<ctl_t> balCore;                  // PID state and error history for balanceByAngle, see balance_core.h
+tiltEstimator estimator;                     // tilt from raw sensor readings, when balance.tiltSource is ts_raw
+wheelOdometry odometry;                      // wheel positions and speeds, updated by controlTask every cycle
+outerLoop outer;                             // position & velocity loop around balanceByAngle
+stateFeedback stateFb;                       // bm_state's controller
+#define stateCreepFraction 0.1f              // balanceByState() runs speeds down to this fraction of slowTicks' at slowTicks
+gainSchedule<ctl_t> gainSched;               // balanceByAngle's copy of the gain schedule, in its number type
+commandBlock<gainTable> gainTables;          // new gain schedules, from onMqttMessage() to controlTask
+uint32_t gainTablesSeen = 0;                 // which one controlTask has
+commandBlock<balanceParams<ctl_t>> coreParams;   // new balCore params, from loadBalanceCore() to controlTask
+uint32_t coreParamsSeen = 0;                 // which one controlTask has
+balanceParams<ctl_t> newCoreParams;          // controlTask's copy, a global to keep it off controlTask's stack
+wheelSnapshot outerWheels = {};              // outer loop's copy of the latest odometry snapshot
+uint32_t outerWheelsSeen = 0;                // and which one it is
+wheelSnapshot hthWheels = {};                // getHealthTelemetry()'s copy of the latest odometry snapshot
+uint32_t hthWheelsSeen = 0;                  // and which one it is
+oscillationMonitor oscMonitor;               // tilt spectrum, fed by controlTask, worked out by oscillationTask
+oscResult hthOsc = {};                       // getHealthTelemetry()'s copy of the latest oscillation results
+uint32_t hthOscSeen = 0;                     // and which one it is
+bool oscWarned = false;                      // warning event sent for the current bout of oscillation
+relayAutotune tuner;                         // relay autotuner, run by balanceByAngle() after an AUTOTUNE command
+volatile bool tuneStartPending = false;      // set by the AUTOTUNE command, acted on by balanceByAngle()
+volatile bool tuneStopPending = false;       // set by AUTOTUNE,STOP
+uint32_t tuneReported = 0;                   // tuner.ended as of the last results getHealthTelemetry() published
+balanceRun runStats;                         // statistics on the current balancing run
+commandBlock<balanceRun> runResults;         // each run's statistics when it ends, from controlTask to getHealthTelemetry()
+uint32_t runResultsSeen = 0;                 // which one getHealthTelemetry() has published
+balanceRun hthRun;                           // getHealthTelemetry()'s copy of it
+commandBlock<uint32_t> wakeUps;              // count of bs_sleep to bs_awake changes, from controlTask to housekeeping()
+uint32_t wakeCount = 0;                      // controlTask's count
+uint32_t wakeUpsSeen = 0;                    // which one housekeeping() has announced
+typedef struct                               // one cycle's balance telemetry, as controlTask saw it
+{
+   unsigned long imuDelta, readFIFO, dmpGet, allReadIMU, oldBalByAng;
+   float tilt, angleErr, pidRaw, pid, pidISum, pidDSlope;
+   int motorTicks;
+   unsigned long runFlags;
+   float outerPosErr, outerVelErr, outerTarget;
+   int dmpSamples;
+} balTelRow;
+QueueHandle_t balTelRows = NULL;             // balTelRow queue, from controlTask to publishBalanceTelemetry()
+volatile uint32_t balTelDropped = 0;         // rows controlTask couldn't queue, because housekeeping had fallen behind
+#if imuAsyncI2C == true
+i2cAsync imuBus;                             // IMU's I2C port, run by i2cBusTask
+i2cTxn fifoTxn;                              // FIFO count, then FIFO data, read by imuBus while controlTask gets on
+uint8_t fifoTxnCount[2];                     // FIFO_COUNTH/L, as fifoTxn read them
+uint8_t fifoTxnBurst[MPU6050_FIFO_BURST_MAX]; // every whole packet that was waiting, newest last
+volatile int8_t fifoTxnPlan = 0;             // what MPU6050::PlanLatestFIFORead() made of the count. 1 = fifoTxnBurst has packets
+volatile uint16_t fifoTxnSkipped = 0;        // packets that won't be used
+bool fifoTxnStarted = false;                 // startReadIMU() submitted fifoTxn, and readIMU() hasn't waited on it yet
+unsigned long fifoTxnStartUs = 0;            // micros() when startReadIMU() submitted it
+volatile unsigned long fifoTxnDoneUs = 0;    // micros() when its last transaction was over, set by the callbacks
+#endif
+int tiltSourceActive = ts_dmp;               // tilt source IMU is actually set up for. controlTask catches it up to balance.tiltSource
+#define rawImuPeriod 1                       // milliseconds between raw accel & gyro reads with ts_raw, i.e. 1 kHz
+#define dmpSampleRateDiv 4                   // SMPLRT_DIV that dmpInitialize() sets, 200 Hz sensor sample rate
+// DMP packets per second. The DMP image's FIFO rate divider halves the sample rate, so 100 Hz
+#define dmpSampleHz (1000.0f / (1 + dmpSampleRateDiv) / (1 + MPU6050_DMP_FIFO_RATE_DIVISOR))
+#define dmpPeriodMsec ((int)(1000 / dmpSampleHz + 0.5f))  // milliseconds between DMP packets, tmrIMU with imuInterruptDriven
+
 
 
 // Define global metadata variables. Used to understand the state of the robot, its peripherals and its environment.
@@ -616,12 +861,15 @@ typedef struct
    int mqttConAttemptsCnt = 0;    // Track the number of attempts made to connect to the MQTT broker
    int dmpFifoDataMissingCnt = 0; // Track how many times the FIFO pin goes high but the buffer is empty
    int dmpFifoDataPresentCnt = 0; // Track how many times the FIFO pin goes high and there is data in the buffer
+   int dmpFifoSkippedCnt = 0;     // Track how many older DMP packets were passed over to get to the newest, or lost to a reset
+   int dmpFifoResetCnt = 0;       // Track how many times the DMP FIFO was reset because it overflowed or fell too far behind
    int wifiDropCnt = 0;           // Track how many times connection to the WiFi network has occurred
    int mqttDropCnt = 0;           // Track how many times connection to the MQTT server is lost
    int unknownCmdCnt = 0;         // Track how many unknown command have been received
    int leftDRVfault = 0;          // Track how many times the left DVR8825 motor driver signals a fault
    int rightDRVfault = 0;         // Track how many times the right DVR8825 motor driver signals a fault
    int unknownSetvarCnt = 0;      // Track how many invalid variable names occur in setvar commands    
+   int ctlJitterMaxUs = 0;        // Worst control cycle start error vs tmrIMU, in microseconds, since last health telemetry
    //TODO Put datapoint below to use
    long riseTimeMax = 0;                     // Most microseconds it took for the signal rise event to happen
    long riseTimeMin = 0;                     // Least microseconds it took for the signal rise event to happen
@@ -1052,6 +1300,120 @@ void publishEvent(int evtId, int evtSev, String evtMsg)
 }
 
 
+/**
+ * @brief Build balCore's control params, converted to its number type, and hand them to controlTask
+ * @note  called from cfgByMAC() and setControlParameter(), whenever the params may have changed. The whole set goes to
+ *        controlTask through coreParams, and it load()s them between cycles, so step() never sees half of them
+=================================================================================================== */
+void loadBalanceCore()
+{
+   static balanceParams<ctl_t> params;                           // static, so the tables are only rebuilt when they change
+   params.pGain = ctl_t(balance.pidPGain);      // with balance.gainSched on, balanceByAngle() overwrites these every cycle
+   params.iGain = ctl_t(balance.pidIGain);
+   params.dGain = ctl_t(balance.pidDGain);
+   int iCount = balance.pidICount;
+   if (iCount > errHistorySize) iCount = errHistorySize;         // can't remember more than the buffer holds
+   if (iCount < 0) iCount = 0;
+   params.iCount = iCount;
+   #ifdef selectiveISum
+      params.selectiveI = true;
+   #endif
+   if (balance.tmrIMU > 0) params.perMsec = ctl_t(1.0f / balance.tmrIMU);
+   #if gyroRateDTerm == true
+      params.dFromGyro = true;
+   #endif
+   float dFilter = balance.dFilter;
+   if (dFilter < 0) dFilter = 0;
+   if (dFilter > 0.99) dFilter = 0.99;                          // 1 would freeze the D part
+   params.dWeight = ctl_t(1.0f - dFilter);
+   float perCycle = balance.tmrIMU * dmpSampleHz / 1000;        // DMP samples per balancing cycle
+   if (perCycle > 0) params.sampleWeight = ctl_t(1.0f - powf(dFilter, 1 / perCycle));  // same smoothing per cycle, spread over the samples
+   bool batched = balance.dmpBatch == 1 && balance.tiltSource != ts_raw;   // readIMU() sets balCore.batched to match
+   estimator.setTimeConstant(balance.estTau, rawImuPeriod / 1000.0f);
+   outer.posGain = balance.posGain;
+   outer.velGain = balance.velGain;
+   outer.maxAdjust = balance.outerMax;
+   outer.velCommand = balance.velCommand;
+   balance.outerTarget = balance.targetAngle + outer.adjust;
+   params.targetAngle = ctl_t(balance.outerTarget);
+   stateFb.k[sfTilt] = balance.lqrTilt;
+   stateFb.k[sfRate] = balance.lqrRate;
+   stateFb.k[sfPos] = balance.lqrPos;
+   stateFb.k[sfVel] = balance.lqrVel;
+   if (balance.fastTicks > 0) stateFb.maxSpeed = attribute.distancePerStep * 1000000.0f / (stepTickUs * balance.fastTicks);
+   float sampleHz = balance.tmrIMU > 0 ? 1000.0f / balance.tmrIMU : 0;   // balCore.step() runs once per tmrIMU
+   float tiltHz = batched ? dmpSampleHz : sampleHz;              // batched, tiltBank runs once per DMP sample instead
+   for (int n = 0; n < bqSections; n++)
+   {  params.tiltFilters.on[n] = biquadDesign(balance.tiltBqType[n], balance.tiltBqHz[n], balance.tiltBqQ[n], tiltHz, params.tiltFilters.c[n]);
+      params.dFilters.on[n] = biquadDesign(balance.dBqType[n], balance.dBqHz[n], balance.dBqQ[n], sampleHz, params.dFilters.c[n]);
+   }
+   oscMonitor.bandLoHz = balance.oscLoHz;
+   oscMonitor.bandHiHz = balance.oscHiHz;
+   oscMonitor.warnRms = balance.oscWarn;
+   tuner.relayPid = constrain(balance.tunePid, 5, pidLimit);    // outside the dead band, and inside ticksTable
+   tuner.hysteresis = balance.tuneHyst;
+   params.smoother = ctl_t(balance.smoother);
+   motors->setAccel(balance.maxAccel);                          // step generator ramps each wheel toward new speeds
+   float distancePerTick = 3.1415926 * attribute.wheelDiameter / attribute.stepsPerRev;
+   if (params.slowTicks != balance.slowTicks || params.fastTicks != balance.fastTicks
+      || params.distancePerTick != distancePerTick)            // only redo the pid to motor ticks table if it's changed
+   {  params.slowTicks = balance.slowTicks;
+      params.fastTicks = balance.fastTicks;
+      params.distancePerTick = distancePerTick;
+      params.buildTicksTable();
+   }
+   coreParams.publish(params);
+} // loadBalanceCore()
+
+/**
+ * @brief Set one section of a biquad filter bank's params from a setvar value
+ * @param value section,type,hz,q  e.g. 0,1,15,0.707 for a 15 Hz Butterworth low pass in the first section
+ * @note  section and type are checked here. hz and q are checked by biquadDesign(), which turns the section off if they're bad
+=================================================================================================== */
+void setBiquadParam(String value, volatile int *type, volatile float *hz, volatile float *q)
+{
+   int comma1 = value.indexOf(",");
+   int comma2 = value.indexOf(",", comma1 + 1);
+   int comma3 = value.indexOf(",", comma2 + 1);
+   int section = value.substring(0, comma1).toInt();
+   if (comma1 < 0 || comma2 < 0 || comma3 < 0 || section < 0 || section >= bqSections)
+   {  AMDP_PRINTLN("<setBiquadParam> Expected section,type,hz,q. Ignoring setvar command");
+      health.unknownSetvarCnt++;
+      return;
+   }
+   type[section] = value.substring(comma1 + 1, comma2).toInt();
+   hz[section] = value.substring(comma2 + 1, comma3).toFloat();
+   q[section] = value.substring(comma3 + 1).toFloat();
+} // setBiquadParam()
+
+/**
+ * @brief Filter bank params as one field for publishParams() and GETBALVAR: type:hz:q for each section, space separated
+=================================================================================================== */
+String biquadParams(volatile int *type, volatile float *hz, volatile float *q)
+{
+   String params = "";
+   for (int n = 0; n < bqSections; n++)
+   {  if (n > 0) params += " ";
+      params += String(type[n]) + ":" + String(hz[n]) + ":" + String(q[n]);
+   }
+   return params;
+} // biquadParams()
+
+/**
+ * @brief Handle setvar BALANCE.TILTSOURCE. Anything but ts_dmp or ts_raw leaves the tilt source as it was
+ * @param value ts_dmp or ts_raw, as a number
+=================================================================================================== */
+void setTiltSource(String value)
+{
+   int source = value.toInt();
+   if (source != ts_dmp && source != ts_raw)
+   {  AMDP_PRINTLN("<setTiltSource> Expected 1 (DMP) or 2 (raw sensors). Ignoring setvar command");
+      health.unknownSetvarCnt++;
+      return;
+   }
+   balance.tiltSource = source;
+} // setTiltSource()
+
 /**
  * @brief Set a control parameter variable to the new value specified in the remote setvar command 
  * @param rCMD Remote command sent from MQTT broker
@@ -1081,9 +1443,38 @@ void setControlParameter(String rCMD)
    else if(varName == "BALANCE.SLOWTICKS") balance.slowTicks = varValue.toFloat();
    else if(varName == "BALANCE.FASTTICKS") balance.fastTicks = varValue.toFloat();
    else if(varName == "BALANCE.SMOOTHER") balance.smoother = varValue.toFloat();
+   else if(varName == "BALANCE.MAXACCEL") balance.maxAccel = varValue.toFloat();   // steps/s/s, 0 = off
+   else if(varName == "BALANCE.DFILTER") balance.dFilter = varValue.toFloat();
+   else if(varName == "BALANCE.TILTSOURCE") setTiltSource(varValue);              // 1 = DMP, 2 = raw sensors
+   else if(varName == "BALANCE.ESTTAU") balance.estTau = varValue.toFloat();
    else if(varName == "BALANCE.TARGETANGLE") balance.targetAngle = varValue.toFloat();
+   else if(varName == "BALANCE.POSGAIN") balance.posGain = varValue.toFloat();     // degrees per inch
+   else if(varName == "BALANCE.VELGAIN") balance.velGain = varValue.toFloat();     // degrees per inch/second
+   else if(varName == "BALANCE.OUTERMAX") balance.outerMax = varValue.toFloat();   // degrees
+   else if(varName == "BALANCE.VELCMD") balance.velCommand = varValue.toFloat();   // inches/second
+   else if(varName == "BALANCE.METHOD") balance.method = varValue.toInt();         // 2 = PID, 3 = state feedback
+   else if(varName == "BALANCE.LQRTILT") balance.lqrTilt = varValue.toFloat();     // the next 4 come from tools/lqr_gains
+   else if(varName == "BALANCE.LQRRATE") balance.lqrRate = varValue.toFloat();
+   else if(varName == "BALANCE.LQRPOS") balance.lqrPos = varValue.toFloat();
+   else if(varName == "BALANCE.LQRVEL") balance.lqrVel = varValue.toFloat();
+   else if(varName == "BALANCE.GAINSCHED") balance.gainSched = varValue.toInt();   // 1 = use table from GAINSCHED command
+   else if(varName == "BALANCE.TILTBQ") setBiquadParam(varValue, balance.tiltBqType, balance.tiltBqHz, balance.tiltBqQ);
+   else if(varName == "BALANCE.DBQ") setBiquadParam(varValue, balance.dBqType, balance.dBqHz, balance.dBqQ);
+   else if(varName == "BALANCE.OSCLOHZ") balance.oscLoHz = varValue.toFloat();
+   else if(varName == "BALANCE.OSCHIHZ") balance.oscHiHz = varValue.toFloat();
+   else if(varName == "BALANCE.OSCWARN") balance.oscWarn = varValue.toFloat();     // degrees RMS, 0 = no warnings
+   else if(varName == "BALANCE.TUNEPID") balance.tunePid = varValue.toFloat();     // autotune relay amplitude, 5 to 400
+   else if(varName == "BALANCE.TUNEHYST") balance.tuneHyst = varValue.toFloat();   // degrees
+   else if(varName == "BALANCE.DMPBATCH") balance.dmpBatch = varValue.toInt();     // 1 = filter every DMP sample, 0 = newest only
    else if(varName == "BALANCE.ACTIVEANGLE") balance.activeAngle = varValue.toFloat();
-   else if(varName == "BALANCE.TMRIMU") balance.tmrIMU = varValue.toInt();   // be very careful if you change this
+   else if(varName == "BALANCE.TMRIMU")     // be very careful if you change this
+   {
+   #if imuInterruptDriven == true
+      AMDP_PRINTLN("<setControlParameter> tmrIMU follows the DMP's interrupts in this build. Ignoring setvar command");
+   #else
+      balance.tmrIMU = varValue.toInt();
+   #endif
+   }
   
 
    // use some special pseudo variables to handle variables with non-numeric values
@@ -1100,6 +1491,7 @@ void setControlParameter(String rCMD)
      AMDP_PRINTLN("<setControlParameter> Unknown variable. Ignoring setvar command");
      health.unknownSetvarCnt++; // Increment counter of invalid setvar variable names
    } //else
+   loadBalanceCore();          // pass any changed control params on to balanceByAngle's math
 
 } //setControlParameter()
 
@@ -1114,9 +1506,50 @@ void publishParams()                  // publish the control parameters to MQTT
    publishMQTT(MQTTTop_shtCom,String(balance.pidPGain) +","+ String(balance.pidIGain) 
    +","+ String(balance.pidICount) +","+ String(balance.pidDGain) 
    +","+ String(balance.slowTicks) +","+ String(balance.fastTicks) +","+String(balance.smoother) +","+String(balance.tmrIMU) 
-   +","+ String(balance.targetAngle) +","+ String(balance.activeAngle)+","+ String(MQTTQos));
+   +","+ String(balance.targetAngle) +","+ String(balance.activeAngle)+","+ String(MQTTQos) +","+ String(balance.dFilter)
+   +","+ String(balance.tiltSource) +","+ String(balance.estTau) +","+ String(balance.maxAccel) +","+ String(balance.posGain)
+   +","+ String(balance.velGain) +","+ String(balance.outerMax) +","+ String(balance.velCommand) +","+ String(balance.method)
+   +","+ String(balance.lqrTilt) +","+ String(balance.lqrRate) +","+ String(balance.lqrPos) +","+ String(balance.lqrVel)
+   +","+ String(balance.gainSched) +","+ biquadParams(balance.tiltBqType, balance.tiltBqHz, balance.tiltBqQ)
+   +","+ biquadParams(balance.dBqType, balance.dBqHz, balance.dBqQ) +","+ String(balance.oscLoHz) +","+ String(balance.oscHiHz)
+   +","+ String(balance.oscWarn) +","+ String(balance.tunePid) +","+ String(balance.tuneHyst) +","+ String(balance.dmpBatch));
 }
 
+/**
+ * @brief Publish how the last autotune run went, and if it finished, the gains it came up with
+ * @details /tunRes gets status,Ku,Tu,ZN P,ZN I,ZN D,TL P,TL I,TL D, with gains in the same units as setvar BALANCE.PIDPGAIN
+ *          etc. I gains use the current pidICount and tmrIMU, so set those first. A one line summary goes out as an event
+ * @note  called from getHealthTelemetry(), so the MQTT work stays out of controlTask
+=================================================================================================== */
+void publishTuneResults()
+{
+   if (tuner.status != at_done)
+   {  publishEvent(0, 1, tuner.status == at_aborted ? "autotune stopped" : "autotune gave up: not enough rocking. Try a bigger TUNEPID");
+      publishMQTT(MQTTTop_tunRes, String(tuner.status));
+      return;
+   }
+   tuner.workOutGains(balance.pidICount, balance.tmrIMU);
+   tunedGains zn = tuner.zieglerNichols;
+   tunedGains tl = tuner.tyreusLuyben;
+   publishMQTT(MQTTTop_tunRes, String(tuner.status) +","+ String(tuner.ku) +","+ String(tuner.tu, 3)
+   +","+ String(zn.p) +","+ String(zn.i) +","+ String(zn.d) +","+ String(tl.p) +","+ String(tl.i) +","+ String(tl.d));
+   publishEvent(0, 0, "autotune Ku " + String(tuner.ku) + " Tu " + String(tuner.tu, 3) + " s. TL gains P " + String(tl.p)
+   + " I " + String(tl.i) + " D " + String(tl.d));
+} // publishTuneResults()
+
+/**
+ * @brief Publish the statistics for a balancing run that has ended, on /balRun
+ * @details run #,seconds to fall,cycles,RMS tilt error,peak tilt error,% cycles in dead band,% cycles saturated
+ * @param run getHealthTelemetry()'s copy of the run, from runResults
+ * @note  called from getHealthTelemetry(), so the MQTT work stays out of controlTask
+=================================================================================================== */
+void publishRunSummary(balanceRun &run)
+{
+   publishMQTT(MQTTTop_balRun, String(run.runs) +","+ String(run.seconds(), 3) +","+ String(run.cycles)
+   +","+ String(run.rmsErr(), 3) +","+ String(run.peakErr, 3) +","+ String(run.deadbandPercent())
+   +","+ String(run.saturatedPercent()));
+} // publishRunSummary()
+
 /**`
  * @brief Send updated metadata about the running of the code.
  * # Metadata
@@ -1138,11 +1571,35 @@ void publishParams()                  // publish the control parameters to MQTT
  * | Unknown command          | Number of unrecognized commands have been received. |
  * | Left DRV8825 fault       | Number of fault signals sent by the left DVR8825 stepper motor driver |
  * | Right DRV8825 fault      | Number of fault signals sent by the right DVR8825 stepper motor driver |
+ * | Control jitter           | Worst microseconds a control cycle started early or late vs tmrIMU, since the last message |
+ * | Cycle period             | 5 items: min,p50,p90,p99,max microseconds between control cycle starts, since TIMINGRESET |
+ * | readIMU time             | 5 items: min,p50,p90,p99,max microseconds in readIMU(), since TIMINGRESET |
+ * | balanceByAngle time      | 5 items: min,p50,p90,p99,max microseconds in balanceByAngle(), since TIMINGRESET |
+ * | Sample to motor latency  | 5 items: min,p50,p90,p99,max microseconds from IMU sample to tickSetting update, since TIMINGRESET |
+ * | Wheel odometry           | 4 items: left & right signed step counts since startup, left & right speeds in steps/second |
+ * | Tilt oscillation         | 3 items: biggest frequency in Hz, its amplitude in degrees, RMS degrees in the watched band |
+ * | DMP packets skipped      | Older DMP packets passed over to get to the newest, or lost to a FIFO reset |
+ * | DMP FIFO resets          | Times the DMP FIFO overflowed or fell too far behind to read, and was reset |
+ * | IMU bus read time        | 5 items: min,p50,p90,p99,max microseconds from startReadIMU() to the FIFO read being over, with |
+ * |                          | imuAsyncI2C true. readIMU time is what was left of it to wait for. All 0 with imuAsyncI2C false |
+ * | Balance telemetry dropped| Rows of balance telemetry controlTask couldn't queue since startup, because housekeeping was behind |
+ * Percentiles are to within 12.5%. See timing_histogram.h
 =================================================================================================== */
 void getHealthTelemetry()
 {
    runbit(17) ;
    telMilli5 = millis();             // timestamp to get execution time for telemetry
+   oscMonitor.latest(hthOsc, hthOscSeen);
+   if (hthOsc.warn && !oscWarned)    // once per bout of oscillation, whether or not health telemetry is on
+   {  publishEvent(0, 1, "tilt oscillating at " + String(hthOsc.peakHz) + " Hz, " + String(hthOsc.bandRms) + " degrees RMS");
+      oscWarned = true;
+   }
+   if (!hthOsc.warn) oscWarned = false;
+   if (tuner.ended != tuneReported)  // an autotune run has ended since last time
+   {  tuneReported = tuner.ended;
+      publishTuneResults();
+   }
+   if (runResults.fetch(hthRun, runResultsSeen)) publishRunSummary(hthRun);  // a balancing run has ended since last time
    if (healthMsg.active) // If configured to write metadata
    {
       String tmp = String(health.wifiConAttemptsCnt)
@@ -1153,7 +1610,20 @@ void getHealthTelemetry()
       + "," + String(health.dmpFifoDataMissingCnt)
       + "," + String(health.unknownCmdCnt)
       + "," + String(health.leftDRVfault)
-      + "," + String(health.rightDRVfault);
+      + "," + String(health.rightDRVfault)
+      + "," + String(health.ctlJitterMaxUs)
+      + "," + th_period.summary()
+      + "," + th_readIMU.summary()
+      + "," + th_balance.summary()
+      + "," + th_latency.summary();
+      odometry.latest(hthWheels, hthWheelsSeen);
+      tmp += "," + String(hthWheels.leftSteps) + "," + String(hthWheels.rightSteps)
+      + "," + String(hthWheels.leftSpeed) + "," + String(hthWheels.rightSpeed);
+      tmp += "," + String(hthOsc.peakHz) + "," + String(hthOsc.peakAmp) + "," + String(hthOsc.bandRms);
+      tmp += "," + String(health.dmpFifoSkippedCnt) + "," + String(health.dmpFifoResetCnt);
+      tmp += "," + th_imuBus.summary();
+      tmp += "," + String(balTelDropped);
+      health.ctlJitterMaxUs = 0;          // worst case is per message, so start looking again
 
       if (healthMsg.destination == TARGET_CONSOLE) // If we are to send this data to the console
       {
@@ -1198,6 +1668,7 @@ void getHealthTelemetry()
  * | Command                | Description                                                                                            |
  * |:-----------------------|:-----------------------------------------------------------------------------------------------|
  * | setvar                 | followed by variable name, followed by new value |  
+ * | timingreset            | start the timing histograms in health telemetry over again |
 
  
 =================================================================================================== */
@@ -1222,6 +1693,19 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
    AMDP_PRINTLN(total);
    AMDP_PRINT("<onMqttMessage>  payload: ");
    AMDP_PRINTLN(payload);
+   if (len > 10 && strncasecmp(payload, "GAINSCHED,", 10) == 0)   // binary gain schedule follows the comma, see gain_schedule.h
+   {  AMDP_PRINTLN("<onMqttMessage> Received gain schedule");
+      gainTable table;
+      const char *problem = index != 0 || len != total ? "split across messages"
+                          : gainTableFromBlob((const uint8_t *)payload + 10, len - 10, table);
+      if (problem == NULL)
+      {  gainTables.publish(table);              // controlTask picks it up at the start of its next balanceByAngle()
+         publishEvent(0, 0, "gain schedule loaded");
+      }
+      else publishEvent(0, 1, String("gain schedule rejected: ") + problem);
+      cu_mqtt += micros() - cu_mqMsg;
+      return;
+   } // if... gainsched
    String tmp = String(payload).substring(0, len);
    AMDP_PRINT("<onMqttMessage> Message to process = ");
    AMDP_PRINTLN(tmp);
@@ -1240,7 +1724,13 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
      publishMQTT(MQTTTop_balCtl,String(balance.pidPGain) +","+ String(balance.pidIGain) 
      +","+ String(balance.pidICount) +","+ String(balance.pidDGain) 
      +","+ String(balance.slowTicks) +","+ String(balance.fastTicks) +","+String(balance.smoother)  
-     +","+ String(balance.targetAngle) +","+ String(balance.activeAngle)+","+ String(balance.tmrIMU)  );
+     +","+ String(balance.targetAngle) +","+ String(balance.activeAngle)+","+ String(balance.tmrIMU) +","+ String(balance.dFilter)
+     +","+ String(balance.tiltSource) +","+ String(balance.estTau) +","+ String(balance.maxAccel) +","+ String(balance.posGain)
+     +","+ String(balance.velGain) +","+ String(balance.outerMax) +","+ String(balance.velCommand) +","+ String(balance.method)
+     +","+ String(balance.lqrTilt) +","+ String(balance.lqrRate) +","+ String(balance.lqrPos) +","+ String(balance.lqrVel)
+     +","+ String(balance.gainSched) +","+ biquadParams(balance.tiltBqType, balance.tiltBqHz, balance.tiltBqQ)
+     +","+ biquadParams(balance.dBqType, balance.dBqHz, balance.dBqQ) +","+ String(balance.oscLoHz) +","+ String(balance.oscHiHz)
+     +","+ String(balance.oscWarn) +","+ String(balance.tunePid) +","+ String(balance.tuneHyst) +","+ String(balance.dmpBatch) );
    } // if... getbalvar
 
    else if(UC_command.substring(0,12) == "GETHTHVAR")
@@ -1260,6 +1750,17 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
       getHealthTelemetry();
    } // if... gethealthtel
 
+   else if(UC_command.substring(0,8) == "AUTOTUNE")
+   {  AMDP_PRINTLN("<onMqttMessage> Received autotune remote request");
+      if (UC_command.indexOf("STOP") > 0) tuneStopPending = true;
+      else tuneStartPending = true;         // balanceByAngle() starts the relay, once it's balancing
+   } // if... autotune
+
+   else if(UC_command.substring(0,11) == "TIMINGRESET")
+   {  AMDP_PRINTLN("<onMqttMessage> Received timingreset remote request to restart timing histograms");
+      th_resetPending = true;               // controlTask does the reset, so it never races a record()
+   } // if... timingreset
+
    else if(UC_command.substring(0,5) == "MOTOR")
    {
       int firstComma = tmp.indexOf(",") ;
@@ -1277,17 +1778,11 @@ void onMqttMessage(char *topic, char *payload, AsyncMqttClientMessageProperties
       if (balance.testLeft == 0 && balance.testRight == 0 )   // but check to see if they're zeros
       {   balance.motorTest = false;         // if so, exit from motor test mode...
          //                                   // but stop the motors before you go
-         noInterrupts();         // block any motor interrupts while we change control parameters
-         left.tickSetting = 0;
-         right.tickSetting = 0;
-         interrupts();            // Allow other code to update balance variables again                               
+         motors->setTicks(0, 0);
       }
       else
       {  balance.motorTest = true;
-         noInterrupts();         // block any motor interrupts while we change control parameters
-         left.tickSetting = balance.testLeft;
-         right.tickSetting = balance.testRight;
-         interrupts();            // Allow other code to update balance variables again          
+         motors->setTicks(balance.testLeft, balance.testRight);
       }
    }  // if ... ="motor"
    else
@@ -1496,43 +1991,6 @@ void stepMotor(int index, uint mod)
   */
 } //stepMotor()
 
-/** 
- * @brief ISR for stepper motors that drive & balance the robot
- * 
-=================================================================================================== */
-//TODO Put balance logic in here
-void IRAM_ATTR motorTimerISR()
-{
-   // runbit(14) ;                               //we know we're getting here - optimize ISR
-   //                                            // assume catchup method will use same ISR as angle method
-   right.tickCounter ++;                         // increment our once per interrupt tick counter
-   if(right.tickCounter > right.tickLimit)       // did that take us to the limit value?
-   {  right.tickCounter = 0;                     // yes, reset the counter, which goes upwards
-      right.tickLimit = right.tickSetting;       // reset upper limit to what the background calculated in balanceByAngle()
-      if(right.tickLimit< 0)                     // negative throttle means backwards
-      {  digitalWrite(gp_DRV1_DIR,LOW);          // write zero to direction bit on DRV8825 motor controller
-         right.tickLimit *= -1;                  // get back to a +ve number for counter comparisons
-      }
-      else digitalWrite(gp_DRV1_DIR,HIGH);       // if not negative limit value, set wheel direction = forward
-   }
-   else if(right.tickCounter == 1) digitalWrite(gp_DRV1_STEP,HIGH);  // start the step pulse at end of first counted tick
-   else if(right.tickCounter == 2) digitalWrite(gp_DRV1_STEP,LOW);   // end the step pulse at end of second counted tick
-
-   left.tickCounter ++;                          // increment our once per interrupt tick counter
-   if(left.tickCounter > left.tickLimit)         // did that take us to the limit value?
-   {  left.tickCounter = 0;                      // yes, reset the counter, which goes upwards
-      left.tickLimit = left.tickSetting;         // reset upper limit to what the background calculated in balanceByAngle()
-      if(left.tickLimit< 0)                      // negative throttle means backwards
-      {  digitalWrite(gp_DRV2_DIR,LOW);          // write zero to direction bit on DRV8825 motor controller
-         left.tickLimit *= -1;                   // get back to a +ve number for counter comparisons
-      }
-      else digitalWrite(gp_DRV2_DIR,HIGH);       // if not negative limit value, set wheel direction = forward
-   }
-   else if(left.tickCounter == 1) digitalWrite(gp_DRV2_STEP,HIGH);  // start the step pulse at end of first counted tick
-   else if(left.tickCounter == 2) digitalWrite(gp_DRV2_STEP,LOW);   // end the step pulse at end of second counted tick
-
-} // motorTimerISR()
-
 /**
  * @brief Calculate what needs to be done to get the robot's centre of mass (COM) over its drive wheels 
  * @param angleRadians Angle of robot lean in radians. 
@@ -1575,116 +2033,46 @@ void calcBalanceParmeters(float angleRadians)
 } // calcBalanceParmeters()
 
 /**
- * @brief Adjust motor controls to minimize how far we are from vertical, using PID tuning 
- * called from loop()
+ * @brief Queue this cycle's balance telemetry for publishBalanceTelemetry(), if it's turned on
+ * @note  called at the end of balanceByAngle() and balanceByState(), in controlTask. Never waits: a row that won't fit
+ *        is counted in balTelDropped, rather than holding up balancing
 =================================================================================================== */
-void balanceByAngle()
+void queueBalanceTelemetry()
 {
-   if(not balance.motorTest )                         // if we're doing PID balancing rather than a speed test, react to current angle
-   {
-      balance.angleErr = balance.tilt - balance.targetAngle;   // difference between current and desired angles
-
-      // first calculate the P part of PID
-      balance.pid = balance.pidPGain * balance.angleErr;       // apply the multiplier for the P in PID, and store in overall PID
-
-      // now  calculate, and add on, the I part = sum of recent error values
-      balance.pidISum = 0.;                                    // could be including 0 in I sum, so start with zero sum
-      balance.errHistory[0] = balance.angleErr;                // makes the loop a bit easier if it's all in the array
-      if(balance.pidICount > 0)                                // unless we're not summing any I values...
-      {
-         balance.dataCount ++ ;                                // count one more telemmetry message
-         int numToSum = balance.dataCount;                     // at startup, don't have b.pidICount values yet
-         if (numToSum > balance.pidICount)                     // but will eventually
-         {  numToSum = balance.pidICount;                      // max out once you've got enough data
-         }
-         for(int t=1; t<=numToSum; t++)                        // loop through history for last pidICount error values
-         {   balance.pidISum += balance.errHistory[t-1];       // element 0 is the current error, element 1 is previous error....
-         }
-         balance.pidISum /= numToSum;                          // turn it into the average I value over the history
-      }
-      #ifdef selectiveISum                                     // if we're selectively avoiding counterproductive ISum values
-         if(balance.angleErr * balance.pidISum > 0 )           // if and only if the ISum component is moving us towards vertical
-         {   //                                                // ie the current angle error and the ISum have different signs
-            balance.pid += balance.pidIGain * balance.pidISum; // add average of stored I values times gain
-         }                                                     // but don't make it worse and push bot AWAY from vertical
-      #else
-         balance.pid += balance.pidIGain * balance.pidISum; // unconditionally add average of stored I values times gain
-      #endif
-
-      // now calculate the derivative, which is slope between current and last errors (using errors includes target angle)
-      // slope is (delta y) / (delta x), in our case,  (previous error - current error) / (tmrIMU mSec)
-      balance.pidDSlope = 0;                  // guess that we won't have enough points to figure slope
-      if(balance.pidICount >= 2 )             // but if we do have at least 2 points...
-      {  balance.pidDSlope = ( balance.angleErr - balance.errHistory[1] ) / balance.tmrIMU;  // calculate the slope
-      }
-      // and add that slope, times its gain parameter, to the overall PID
-      balance.pid += balance.pidDGain * balance.pidDSlope;
-
-      for(int t = balance.pidICount; t >= 1; t-- )            //shuffle remembered values so we have most recent bunch
-      {   balance.errHistory[t] = balance.errHistory[t-1];   
-      }
-
-      balance.pidRaw = balance.pid;                           // save a copy of the pid before range checking for telemetry
-      if(balance.pid >  400) balance.pid = 400;               // range limit pid
-      if(balance.pid < -400) balance.pid = -400;
-      if(abs(balance.pid) < 5) balance.pid = 0;              // create a dead band to stop motors when robot is balanced
-  /*
-    if(balance.pid > 0)
-    {   balance.motorTicks = int(balance.slowTicks - (balance.pid/400)*(balance.slowTicks - balance.fastTicks) ) ;  
-    }                                      // motorTicks is speed interval in timer ticks
-    if(balance.pid < 0)
-    {   balance.motorTicks = int( -1*balance.slowTicks - (balance.pid/400)*(balance.slowTicks - balance.fastTicks) ) ;
-    }
-  */
-
-      float distancePerTick = 3.1415926 * attribute.wheelDiameter / attribute.stepsPerRev;
-      float minGroundSpeed = distancePerTick / ( 20 * .000001 * balance.slowTicks);
-      float maxGroundSpeed = distancePerTick / ( 20 * .000001 * balance.fastTicks);
-      float groundSpeed = 0;  // setting value avoids compiler nagging
-
-      if(balance.pid > 0) { groundSpeed = ((balance.pid-5)/395) * (maxGroundSpeed - minGroundSpeed) + minGroundSpeed; }
-      if(balance.pid < 0) { groundSpeed = ((balance.pid+5)/395) * (maxGroundSpeed - minGroundSpeed) - minGroundSpeed; }
-      if(balance.pid == 0 || groundSpeed == 0) { balance.motorTicks = 0; }
-      // else { balance.motorTicks = int( distancePerTick / groundSpeed ); }
-      else { balance.motorTicks = int( distancePerTick / groundSpeed / .000020 ); }
-
-      /*     // some temporary testing stuff
-      Serial.print(">");
-      Serial.print(balance.tilt); Serial.print(", ");
-      Serial.print(balance.pid); Serial.print(", ");
-      Serial.print(groundSpeed); Serial.print(", ");
-      */
-
-      //   TODO retrofit distancePerTick, groundSpeed, minGroundSpeed, maxGroundSpeed etc, into structures
-      // experimental  motor speed change smoothing
-      // smoother is a variable, and the control parameter - smoother == 0 means don't smooth
-      if(balance.smoother != 0)                       // if smoothing is enabled, do it
-      {  balance.motorTicks = balance.lastSpeed + balance.smoother * (balance.motorTicks-balance.lastSpeed);
-      }
-    
-      noInterrupts();         // block any motor interrupts while we change control parameters
-      //d2  reverse direction of wheel rotation, based on observation of Dougs bot
-      left.tickSetting = balance.directionMod * balance.motorTicks;
-      right.tickSetting = balance.directionMod * balance.motorTicks;
-      if(balance.lastSpeed * balance.motorTicks < 0 )     // if old and new signs are different, we've reversed desired directions
-      {                                 // and we should abort current step in the wrong direction 
-         left.tickSetting =  9999 ;    // force counter overflow, and thus reading of the new setting
-         right.tickSetting = 9999 ;
-      }
-      interrupts();
-      balance.lastSpeed = balance.motorTicks;                 // remember last speed for smoothing and quick direction change
-   }     //if(balance.slowTicks > 0 )
-
-   else   // do this if we are doing motor testing via MQTT motor command rather than IMU controlled balancing
-   {    // this is now handled in the main loop() 
-   }  // else
-  
-   // Assemble balance telemetry string
-
-   char flagsInHex[12];                // buffer space for hex string representing runFlagWord
-   itoa(runFlagWord,flagsInHex,16);    // convert flags to hex string
+   balTelRow row;
+   row.runFlags = runFlagWord;         // routines that ran since last cycle
    runFlagWord = 0 ;                   // clear flags ASAP, so new routines are seen
+   row.imuDelta = tm_IMUdelta;
+   row.readFIFO = tm_readFIFO;
+   row.dmpGet = tm_dmpGet;
+   row.allReadIMU = tm_allReadIMU;
+   row.oldBalByAng = tm_OldbalByAng;
+   row.tilt = balance.tilt;
+   row.angleErr = balance.angleErr;
+   row.pidRaw = balance.pidRaw;
+   row.pid = balance.pid;
+   row.pidISum = balance.pidISum;
+   row.pidDSlope = balance.pidDSlope;
+   row.motorTicks = balance.motorTicks;
+   row.outerPosErr = balance.outerPosErr;
+   row.outerVelErr = balance.outerVelErr;
+   row.outerTarget = balance.outerTarget;
+   row.dmpSamples = tm_dmpSamples;
+
+   tm_IMUdelta = 0;          // reset variables that are counters spanning execuitions of readIMU...
+   tm_readFIFO = 0;
+   tm_dmpGet = 0;
+   tm_allReadIMU = 0;
+
+   if (balTelMsg.active && balTelRows != NULL && xQueueSend(balTelRows, &row, 0) != pdPASS) balTelDropped++;
+} // queueBalanceTelemetry()
 
+/**
+ * @brief Publish the balance telemetry rows controlTask has queued, to the console or MQTT as set by balTelMsg
+ * @note  called from housekeeping(), so the Strings, the Serial port and mqttClient are only ever used on its core
+=================================================================================================== */
+void publishBalanceTelemetry()
+{
    /*
    Layout of balance telemetry. 
    Sample msg:  TwipeB4E62D9EA8F9/balTel 159633,12,1,0,1,2,-0.84,-1.34,-222.57,-222.57,-4.33,-0.01,-521,8001000,0,0,0
@@ -1692,15 +2080,15 @@ void balanceByAngle()
    1  Robot identifier, ending in MAC address then a slash separator
    2  MQTT topic "balTel" with space separator
    3  timestamp, in millis() for message publication, followed by a comma separator, like remaining fields
-   4  tm_IMUdelta     telemetry value: measured time (millis()) between goIMU calls. should equal tmrIMU
-   5  tm_readFIFO     telemetry value: how long the mpu.dmpGetCurrentFIFOPacket(fifoBuffer) execution took
+   4  tm_IMUdelta     telemetry value: measured time (millis()) between control cycles. should equal tmrIMU
+   5  tm_readFIFO     telemetry value: how long the mpu.dmpGetLatestFIFOPacket(fifoBuffer) execution took
    6  tm_dmpGet       telemetry value: how long the dmpGet* calls after above call took
    7  tm_allReadIMU   telemetry value: how long the readIMU execution took
    8  tm_oldbalByAng  telemetry value: how long the PREVIOUS balanceByAngle took
    9  balance.tilt    forward/backward angle of robot, in degrees, positive is leaning forward, 0 is vertical
    10 balance.angleErr difference between current angle (tilt) and desired angle (targetAngle)
-   11 balance.pidRaw  calculated balance angle PID value before range checking
-   12 balance.pid     calculated balance angle PID value after range checking (400<pid<400)
+   11 balance.pidRaw  calculated balance angle PID value before range checking. bm_state: wheel acceleration, inches/s/s
+   12 balance.pid     calculated balance angle PID value after range checking (400<pid<400). bm_state: wheel speed, inches/s
    13 balance.pidISum The I part if PID 
    14 balance.pidDSlope  The D part of PID
    15 balance.motorTicks The number of 20usec ticks before next step of the stepper motors by interrupt level
@@ -1708,35 +2096,99 @@ void balanceByAngle()
    17 tm_ROLEDtime    time spent in the routine that updates the right OLED since last readIMU cycle
    18 tm_MQpubCnt     the number of times the MQTTpublish reoutine was executed since last readIMU cycle
    19 tm_uMDtime      telemetry measure: time spent in getHealthTelemetry() since last readIMU cycle
+   20 balance.outerPosErr  outer loop: inches ahead of the hold point, as of its last run
+   21 balance.outerVelErr  outer loop: inches/second faster than balance.velCommand
+   22 balance.outerTarget  angle balanceByAngle is aiming for: targetAngle plus the outer loop's adjustment
+   23 tm_dmpSamples   IMU samples made since the last cycle. All of them were filtered if balance.dmpBatch is 1
 
    */
 
-  String tmp = String(tm_IMUdelta) +"," + String(tm_readFIFO) + "," + String(tm_dmpGet) + "," + String(tm_allReadIMU)
-   + "," + String(tm_OldbalByAng) + "," + String(balance.tilt) + "," + String(balance.angleErr) + "," + String(balance.pidRaw)
-   + "," + String(balance.pid) + "," + String(balance.pidISum) + "," + String(balance.pidDSlope) + "," + String(balance.motorTicks) 
-   + "," + flagsInHex  +","+ String(tm_ROLEDtime) +","+ String(tm_MQpubCnt) +","+ String(tm_uMDtime);
+   balTelRow row;
+   while (balTelRows != NULL && xQueueReceive(balTelRows, &row, 0) == pdPASS)
+   {
+      char flagsInHex[12];                // buffer space for hex string representing runFlagWord
+      itoa(row.runFlags,flagsInHex,16);   // convert flags to hex string
 
-   tm_ROLEDtime = 0;         // don't leave old time hanging around in case routine doesn't run soon.
-   tm_LOLEDtime = 0;         // reset variables that are counters spanning execuitions of readIMU...
-   tm_uMDtime = 0;
-   tm_IMUdelta = 0;
-   tm_readFIFO = 0;
-   tm_dmpGet = 0;
-   tm_allReadIMU = 0;
-   tm_MQpubCnt = 0;
+      String tmp = String(row.imuDelta) +"," + String(row.readFIFO) + "," + String(row.dmpGet) + "," + String(row.allReadIMU)
+      + "," + String(row.oldBalByAng) + "," + String(row.tilt) + "," + String(row.angleErr) + "," + String(row.pidRaw)
+      + "," + String(row.pid) + "," + String(row.pidISum) + "," + String(row.pidDSlope) + "," + String(row.motorTicks)
+      + "," + flagsInHex  +","+ String(tm_ROLEDtime) +","+ String(tm_MQpubCnt) +","+ String(tm_uMDtime)
+      + "," + String(row.outerPosErr) + "," + String(row.outerVelErr) + "," + String(row.outerTarget)
+      + "," + String(row.dmpSamples);
+
+      tm_ROLEDtime = 0;         // don't leave old time hanging around in case routine doesn't run soon.
+      tm_LOLEDtime = 0;
+      tm_uMDtime = 0;
+      tm_MQpubCnt = 0;
 
-   if (balTelMsg.active) // If configured to write balance telemetry data
-   {
       if (balTelMsg.destination == TARGET_CONSOLE) // If we are to send this data to the console
       {
-         Serial.print("<balanceByAngle> ");
+         Serial.print("<publishBalanceTelemetry> ");
          Serial.println(tmp);
       }    //if
       else // Otherwise assume we are to send the data to the MQTT broker
       {
-      publishMQTT(MQTTTop_balTel, tmp);              // publish data point string built above.
+         publishMQTT(MQTTTop_balTel, tmp);           // publish data point string built above.
       } //else
-   }   //if
+   } //while
+} // publishBalanceTelemetry()
+
+/**
+ * @brief Adjust motor controls to minimize how far we are from vertical, using PID tuning 
+ * called from loop()
+=================================================================================================== */
+void balanceByAngle()
+{
+   if(not balance.motorTest )                         // if we're doing PID balancing rather than a speed test, react to current angle
+   {
+      // P, I & D, range checking, mapping onto motor ticks and smoothing are all in balCore, in float or Q16.16
+      // errHistory there is a ring buffer with a running sum, so none of this depends on the size of pidICount
+      if(balance.pidICount > 0) balance.dataCount ++ ;         // count one more telemmetry message
+      if (tuneStopPending)                                    // AUTOTUNE,STOP command came in
+      {  tuneStopPending = false;
+         tuneStartPending = false;
+         tuner.abort();
+      }
+      if (tuneStartPending)                                   // AUTOTUNE command came in, and now we're balancing
+      {  tuneStartPending = false;
+         tuner.start(balance.tilt - balance.outerTarget, millis());
+      }
+      gainTable newTable;
+      if (gainTables.fetch(newTable, gainTablesSeen)) gainSched.load(newTable);   // new schedule from MQTT, whole or not at all
+      if (tuner.running())                                    // relay instead of PID, see relay_autotune.h
+      {  balance.angleErr = balance.tilt - balance.outerTarget;
+         balance.pid = balance.pidRaw = tuner.step(balance.angleErr, millis());
+         balance.motorTicks = balCore.ticksForPid(ctl_t(balance.pid));
+         if (!tuner.running()) balCore.resetErrHistory();    // that was the last relay cycle. PID starts afresh next cycle
+      }
+      else
+      {  if (balance.gainSched == 1 && gainSched.loaded)      // P, I & D for how far we're leaning and how fast we're going
+         {  ctl_t absTilt = balCore.tilt - balCore.targetAngle;
+            if (absTilt < ctl_t(0)) absTilt = -absTilt;
+            ctl_t absSpeed = balCore.speedForPid(balCore.pid);   // steps per second last cycle's pid asked for, before smoothing
+            gainSched.lookup(absTilt, absSpeed, balCore.pGain, balCore.iGain, balCore.dGain);
+         }
+         balance.motorTicks = balCore.step(balance.lastSpeed);
+
+         // keep float copies of the results for telemetry
+         balance.angleErr = ctlToFloat(balCore.angleErr);
+         balance.pidISum = ctlToFloat(balCore.pidISum);
+         balance.pidDSlope = ctlToFloat(balCore.pidDSlope);
+         balance.pidRaw = ctlToFloat(balCore.pidRaw);
+         balance.pid = ctlToFloat(balCore.pid);
+      }
+
+      //d2  reverse direction of wheel rotation, based on observation of Dougs bot
+      motors->setTicks(balance.directionMod * balance.motorTicks, balance.directionMod * balance.motorTicks);
+      th_latency.record(micros() - imuSampleMicros);          // IMU sample to motors told about it
+      balance.lastSpeed = balance.motorTicks;                 // remember last speed for smoothing and quick direction change
+   }     //if(balance.slowTicks > 0 )
+
+   else   // do this if we are doing motor testing via MQTT motor command rather than IMU controlled balancing
+   {    // this is now handled in the main loop() 
+   }  // else
+  
+   queueBalanceTelemetry();            // telemetry is the same whichever method did the balancing
 } // balanceByAngle
 
 /**
@@ -1869,7 +2321,7 @@ void setupOLED()
 } //setupOLED()
 
 /**
- * @brief Set up the MPU6050 using DMP firmware but NO interrupts
+ * @brief Set up the MPU6050 using DMP firmware, with interrupts only if imuInterruptDriven is true
 =================================================================================================== */
 void setupIMU()
 {
@@ -1897,6 +2349,11 @@ void setupIMU()
    // make sure it worked (returns 0 if so)
    if (devStatus == 0)
    {
+      // leave out of the DMP's packets what readIMU() doesn't use
+      if (mpu.dmpSetFIFOFeatures(dmpFifoFeatures) != 0)
+      {
+         AMDP_PRINTLN("<setupIMU> Couldn't trim DMP packets, so they stay full size");
+      } //if
       // Supply your own gyro offsets here, scaled for min sensitivity
       mpu.setXGyroOffset(attribute.XGyroOffset);
       mpu.setYGyroOffset(attribute.YGyroOffset);
@@ -1913,11 +2370,15 @@ void setupIMU()
       // turn on the DMP, now that it's ready
       AMDP_PRINTLN("<setupIMU> Enabling DMP...");
       mpu.setDMPEnabled(true);
-      AMDP_PRINTLN("<setupIMU> Intentionally NOT enabling DMP interrupts");    
       // get expected DMP packet size for later comparison
       packetSize = mpu.dmpGetFIFOPacketSize();
       AMDP_PRINT("<setupIMU> packetSize = ");
       AMDP_PRINTLN(packetSize);
+   #if imuInterruptDriven == true
+      AMDP_PRINTLN("<setupIMU> DMP interrupts get enabled in setupControlTask()");
+   #else
+      AMDP_PRINTLN("<setupIMU> Intentionally NOT enabling DMP interrupts");    
+   #endif
       balance.method = bm_initialMethod;      // are we balancing by catchup distance, or angle deviation?
       balance.dataCount = 0;                 // balance data telemetry message counter
    }    //if
@@ -2062,6 +2523,10 @@ void cfgByMAC()
    AMDP_PRINTLN(attribute.wheelCircumference);
    AMDP_PRINT("<cfgByMAC> Distance per step = ");
    AMDP_PRINTLN(attribute.distancePerStep);
+#if imuInterruptDriven == true
+   balance.tmrIMU = dmpPeriodMsec;         // INT sets the pace, one cycle per DMP packet, whatever the robot's tmrIMU was
+#endif
+   loadBalanceCore();                      // give balanceByAngle's math this robot's control params
   
 } //cfgByMAC()
 
@@ -2103,26 +2568,169 @@ void updateLED()
 
 } // updateLED()
 
+#if imuAsyncI2C == true
+/**
+ * @brief I2Cdev hooks, so the MPU6050 library's traffic goes through imuBus instead of Wire
+ * @note  imuBus waits as long as the driver's i2cTxnTimeoutMs takes, so I2Cdev's timeout isn't needed
+=================================================================================================== */
+int8_t imuBusRead(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data, uint16_t timeout)
+{
+   return imuBus.readRegs(devAddr, regAddr, length, data);
+} // imuBusRead()
+
+bool imuBusWrite(uint8_t devAddr, uint8_t regAddr, uint8_t length, uint8_t *data)
+{
+   return imuBus.writeRegs(devAddr, regAddr, length, data);
+} // imuBusWrite()
+
+/**
+ * @brief fifoTxn's callbacks, run in i2cBusTask. Count first, then if there's a packet, the data, chained straight on
+=================================================================================================== */
+bool fifoDataRead(i2cTxn &t)
+{
+   if (t.status != it_done) fifoTxnPlan = 0;   // try again next cycle
+   fifoTxnDoneUs = micros();
+   return false;
+} // fifoDataRead()
+
+bool fifoCountRead(i2cTxn &t)
+{
+   uint16_t skipped = 0;
+   fifoTxnPlan = 0;
+   if (t.status == it_done)
+   {
+      uint16_t count = ((uint16_t)fifoTxnCount[0] << 8) | fifoTxnCount[1];
+      fifoTxnPlan = MPU6050::PlanLatestFIFORead(count, packetSize, &skipped);
+      if (fifoTxnPlan == 1)                    // read every whole packet waiting in one burst
+      {
+         t.regAddr = MPU6050_RA_FIFO_R_W;
+         t.rdData = fifoTxnBurst;
+         t.rdLen = count / packetSize * packetSize;   // whole packets. One still being written stays in the FIFO
+         t.complete = fifoDataRead;
+      }
+   }
+   fifoTxnSkipped = skipped;
+   if (fifoTxnPlan != 1) fifoTxnDoneUs = micros();   // nothing to chain on, so that's it
+   return fifoTxnPlan == 1;
+} // fifoCountRead()
+
+/**
+ * @brief Start reading the DMP FIFO in the background, for readIMU() to pick up
+ * @note  called by controlTask as soon as it wakes for a cycle. i2cBusTask is higher priority, so it starts the transfer at
+ *        once, then blocks on the driver while the bus runs. controlTask gets on with updateOdometry() and the rest meanwhile
+=================================================================================================== */
+void startReadIMU()
+{
+   if (tiltSourceActive == ts_raw || fifoTxnStarted) return;
+   fifoTxn.regAddr = MPU6050_RA_FIFO_COUNTH;
+   fifoTxn.rdData = fifoTxnCount;
+   fifoTxn.rdLen = sizeof(fifoTxnCount);
+   fifoTxn.complete = fifoCountRead;
+   fifoTxnStartUs = micros();
+   fifoTxnStarted = imuBus.submit(fifoTxn);
+} // startReadIMU()
+
+/**
+ * @brief Wait for the read startReadIMU() started, and leave the newest packet in fifoBuffer
+ * @return same as mpu.dmpGetLatestFIFOPacket(): 1 = packet in fifoBuffer, 0 = none, 2 = FIFO was reset
+=================================================================================================== */
+int8_t finishReadIMU(uint16_t *skipped)
+{
+   *skipped = 0;
+   startReadIMU();                             // in case nothing started it
+   if (!fifoTxnStarted) return 0;              // imuBus queue full
+   imuBus.wait(fifoTxn, portMAX_DELAY);        // bounded by the driver's timeout
+   fifoTxnStarted = false;
+   th_imuBus.record(fifoTxnDoneUs - fifoTxnStartUs);   // vs th_readIMU, which only sees what was left to wait for
+   *skipped = fifoTxnSkipped;
+   if (fifoTxnPlan == 2) mpu.resetFIFO();      // overflowed, or too far behind to be worth reading
+   if (fifoTxnPlan == 1) memcpy(fifoBuffer, fifoTxnBurst + fifoTxn.rdLen - packetSize, packetSize);
+   return fifoTxnPlan;
+} // finishReadIMU()
+#endif
+
+/**
+ * @brief Tilt and tilt rate from one DMP packet, into balance.tilt, balCore.tilt and balCore.tiltRate
+=================================================================================================== */
+void tiltFromPacket(uint8_t *packet)
+{
+#if controlFixedPoint == true
+   int32_t qI[4];                             // quaternion in the DMP's native Q30 integers
+   mpu.dmpGetQuaternion(qI, packet);          // Get the Quaternion data, without float conversion
+   balCore.tilt = tiltFromQ30(qI);            // roll - 90, in Q16.16, same adjustments as float path below
+   balance.tilt = ctlToFloat(balCore.tilt);   // float copy for state checks and telemetry
+#else
+   int16_t qI[4];                             // quaternion as the DMP's Q14 integers
+   mpu.dmpGetQuaternion(qI, packet);          // Get the Quaternion data, without float conversion
+   balance.tilt = tiltFromQ14(qI, tiltPolyAtan2);  // roll - 90, folded past a face plant. Only roll is worked out
+   balCore.tilt = balance.tilt;
+#endif
+   int16_t gyro[3];                           // raw gyro rates from the same packet. X is the axis we tilt around
+   mpu.dmpGetGyro(gyro, packet);
+   rateFromGyro(balCore.tiltRate, gyro[0]);   // degrees per millisecond, for the D part of PID
+} // tiltFromPacket()
+
 /**
  * @brief Retrieve DMP FIFO data
+ * @details With balance.dmpBatch 1, every packet waiting goes through balCore.sample(), oldest first, so the tilt filter
+ *          bank and the D filter see the DMP's full sample rate. Otherwise only the newest packet is used
  * @return boolean rCode. True means there is new DMP data. false means that there is not
  */
-// TODO learn about the three different dmpGet commands used here. Do we need them all? What do they do? an we call only 1?
 boolean readIMU()
 {
    boolean rCode = false;
-   if (mpu.dmpGetCurrentFIFOPacket(fifoBuffer)) // Check to see if there is any data in the DMP FIFO buffer.
+   if (tiltSourceActive == ts_raw)              // controlTask has kept estimator up to date, so nothing to read
+   {
+      telMilli2 = millis();                      // keep telemetry timestamps meaningful
+      tm_readFIFO = telMilli2 - telMilli1;
+      balance.tilt = estimator.tilt;
+      balCore.tilt = ctl_t(estimator.tilt);
+      balCore.tiltRate = ctl_t(estimator.rate / 1000);   // degrees per millisecond, for the D part of PID
+      balCore.batched = false;                   // estimator already runs at the raw sample rate
+      telMilli3 = millis();
+      tm_dmpGet = telMilli3 - telMilli2;
+      tm_dmpSamples = rawImuPeriod > 0 ? balance.tmrIMU / rawImuPeriod : 0;
+      return true;
+   }
+#if imuInterruptDriven == false
+   imuSampleMicros = micros();                  // polling, so the best we know is the packet is no older than this
+#endif
+   bool batch = balance.dmpBatch == 1;
+   uint16_t fifoSkipped;                        // older packets passed over to get to the newest one
+   uint8_t *packets = fifoBuffer;               // packets to balance on, oldest first
+   uint8_t packetCount = 1;
+#if imuAsyncI2C == true
+   int8_t fifoRc = finishReadIMU(&fifoSkipped); // read was started at the top of the cycle by startReadIMU()
+   if (batch && fifoRc == 1)                    // all of them are in fifoTxnBurst
+   {
+      packets = fifoTxnBurst;
+      packetCount = fifoTxn.rdLen / packetSize;
+      fifoSkipped = 0;                          // all used, as with dmpGetAllFIFOPackets()
+   }
+#else
+   int8_t fifoRc;
+   if (batch)
+   {
+      fifoRc = mpu.dmpGetAllFIFOPackets(fifoBatch, &packetCount, &fifoSkipped);  // every whole packet. Never waits
+      packets = fifoBatch;
+   }
+   else fifoRc = mpu.dmpGetLatestFIFOPacket(fifoBuffer, &fifoSkipped);  // newest whole packet, if there is one. Never waits
+#endif
+   health.dmpFifoSkippedCnt += fifoSkipped;
+   if (fifoRc == 2) health.dmpFifoResetCnt++;   // overflowed, or too far behind, so the FIFO was reset
+   tm_dmpSamples = (fifoRc == 1 ? packetCount : 0) + fifoSkipped;   // samples the DMP made since last cycle, used or not
+   if (fifoRc == 1)                             // there's at least one packet
    { 
       telMilli2 = millis();                      // telemetry timestamp (gives get fifo info execution time))
       tm_readFIFO = telMilli2 - telMilli1;       // telemetry measurement - time to read packet from dmp FIFO
-      mpu.dmpGetQuaternion(&q, fifoBuffer);      // Get the latest packet of Quaternion data
-      mpu.dmpGetGravity(&gravity, &q);           // Get the latest packet of gravity data, using quaternion data
-      mpu.dmpGetYawPitchRoll(ypr, &q, &gravity); // Get the latest packet of YPR angles, using gravity data
-      telMilli3 = millis();                      // telemetry timestamp (gives Rowberg getDmp routines execution time))
-      tm_dmpGet = telMilli3 - telMilli2;         // telemetry measurement: time to execute the 3 mpu.dmpGet* routines
-
-      balance.tilt = ypr[2] * RAD_TO_DEG - 90. ; // get the Roll, relative to original IMU orientation & adjust
-      if (balance.tilt < -180.) balance.tilt = 90.;     // avoid abrupt change from +90 to -270, when he's past a face plant
+      balCore.batched = batch;
+      for (int n = 0; n < packetCount; n++)      // newest last, so tilt & tiltRate end up from it, as they would unbatched
+      {
+         tiltFromPacket(packets + n * packetSize);
+         if (batch) balCore.sample(balCore.tilt, balCore.tiltRate);
+      }
+      telMilli3 = millis();                      // telemetry timestamp (gives tilt calculation execution time)
+      tm_dmpGet = telMilli3 - telMilli2;         // telemetry measurement: time to get tilt from the packet(s)
       health.dmpFifoDataPresentCnt++;          // Track how many times the FIFO pin goes high and the buffer has data in it
       rCode = true;
   }  //if
@@ -2188,17 +2796,10 @@ void setupDriverMotors()
    digitalWrite(gp_DRV2_DIR, LOW); // Set right motor direction as forward
    digitalWrite(gp_DRV2_ENA, HIGH); // Disable Right motor
 
-   // Set up motor driver ISR
-   AMDP_PRINTLN("<setupDriverMotors> Configure timer0 to control the motor timing interrupts");
-   uint8_t timerNumber = 0;                                               // Timer0 will be used to control the motors
-   uint16_t prescaleDivider = 80;                                         // Timer0 uses presaler (divider) of 80 so interrupts occur at 1us
-   bool countUp = true;                                                   // Timer0 will count up not down
-   motorTimer = timerBegin(timerNumber, prescaleDivider, countUp);        // Set Timer0 configuration
-   bool intOnEdge = true;                                                 // Interrupt on rising edge of Timer0 signal
-   timerAttachInterrupt(motorTimer, &motorTimerISR, intOnEdge);           // Attach ISR to Timer0
-   bool autoReload = true;                                                // Should the ISR timer reload after it runs
-   timerAlarmWrite(motorTimer, motorISRus, autoReload);                   // Set up conditions to call ISR
-   timerAlarmEnable(motorTimer);                                     // Enable timer interrupt
+   // Start making step pulses
+   AMDP_PRINT("<setupDriverMotors> Starting step pulse generator: ");
+   AMDP_PRINTLN(motors->name());
+   motors->begin();
          
    // Attach interrupts to track DVR8825 faults
    AMDP_PRINTLN("<setupDriverMotors> Monitor left & right DRV8825 drivers for faults");
@@ -2207,6 +2808,105 @@ void setupDriverMotors()
 
 } //setupDriverMotors()
 
+/**
+ * @brief Average of the two wheels' positions, in inches, from the latest odometry snapshot, which is also left in outerWheels
+=================================================================================================== */
+float outerWheelsPosition()
+{
+   odometry.latest(outerWheels, outerWheelsSeen);
+   return (outerWheels.leftSteps + outerWheels.rightSteps) / 2.0f * attribute.distancePerStep;
+} // outerWheelsPosition()
+
+/**
+ * @brief Start the outer loop and bm_state afresh, holding position wherever the wheels are now. Called on going to bs_active
+=================================================================================================== */
+void resetOuterLoop()
+{
+   float position = outerWheelsPosition();
+   outer.reset(position);
+   stateFb.reset(position);
+   balance.outerPosErr = balance.outerVelErr = 0;
+   balance.outerTarget = balance.targetAngle;
+   balCore.targetAngle = ctl_t(balance.outerTarget);
+} // resetOuterLoop()
+
+/**
+ * @brief Run the outer position & velocity loop, and hand balanceByAngle the target angle it comes up with
+ * @details Called from imuCycle() once every outerEvery balance cycles, just before balanceByAngle()
+=================================================================================================== */
+void outerLoopCycle()
+{
+   float position = outerWheelsPosition();
+   float velocity = (outerWheels.leftSpeed + outerWheels.rightSpeed) / 2.0f * attribute.distancePerStep;
+   float adjust = outer.step(position, velocity, outerEvery * balance.tmrIMU / 1000.0f);
+   balance.outerPosErr = outer.posErr;
+   balance.outerVelErr = outer.velErr;
+   balance.outerTarget = balance.targetAngle + adjust;
+   balCore.targetAngle = ctl_t(balance.outerTarget);
+} // outerLoopCycle()
+
+/**
+ * @brief Balance with full state feedback (bm_state): wheel acceleration from tilt, tilt rate, wheel position and speed
+ * @details See state_feedback.h. The wheel speed it comes up with is mapped onto motor ticks, using slowTicks and
+ *          fastTicks as the range of speeds the motors can manage, the same as balanceByAngle's ticksTable does.
+ *          Slower than slowTicks, the wheels still turn at slowTicks, so small corrections aren't lost in a dead zone. Only
+ *          below stateCreepFraction of that speed do they stop
+=================================================================================================== */
+void balanceByState()
+{
+   float tiltErr = balance.tilt - balance.targetAngle;
+   float tiltRate = ctlToFloat(balCore.tiltRate) * 1000;   // degrees per second
+   float speed = stateFb.step(tiltErr, tiltRate, outerWheelsPosition(), balance.tmrIMU / 1000.0f);
+
+   int ticks = 0;
+   float absSpeed = speed < 0 ? -speed : speed;
+   if (absSpeed > 0)
+   {  float t = attribute.distancePerStep * 1000000.0f / (stepTickUs * absSpeed);
+      if (t <= balance.slowTicks) ticks = t < balance.fastTicks ? balance.fastTicks : (int)(t + 0.5f);
+      else if (t * stateCreepFraction <= balance.slowTicks) ticks = balance.slowTicks;   // slowest the motors do, not stopped
+   }
+   if (speed < 0) ticks = -ticks;
+   balance.motorTicks = ticks;
+
+   // keep copies of the results for telemetry, in the same slots as balanceByAngle's
+   balance.angleErr = tiltErr;
+   balance.pidRaw = stateFb.accel;
+   balance.pid = speed;
+   balance.pidISum = 0;
+   balance.pidDSlope = tiltRate;
+
+   motors->setTicks(balance.directionMod * balance.motorTicks, balance.directionMod * balance.motorTicks);
+   th_latency.record(micros() - imuSampleMicros);          // IMU sample to motors told about it
+   balance.lastSpeed = balance.motorTicks;
+   queueBalanceTelemetry();
+} // balanceByState()
+
+/**
+ * @brief Things to do when controlTask has woken the robot up (bs_sleep to bs_awake): network info on the left OLED, and
+ *        the headings and control params that go before the balance telemetry in the spreadsheet
+ * @note  called from housekeeping() when wakeUps has a new one, so OLED and MQTT work stays out of controlTask
+=================================================================================================== */
+void announceAwake()
+{
+   // update left eye with network info that is now available and static
+   updateLeftOLEDNetInfo();        // put IP, MAC, Accesspoint & MQTT hostname into left eye.
+
+   // do a test event publish before the stuff that goes into the spreadsheet to avoid messing it up
+   publishEvent(0,0,"test-event");
+
+   // publish preliminary info into the MQTT balance telemetry log to help with telemetry interpretation before we get busy
+   // first, publish the column titles for the control parameters
+   publishMQTT(MQTTTop_shtCom,"PGain,IGain,ICnt,DGain,slow Tks,fast Tks,smooth,tmrIMU,trgt ang,act ang,QOS,D filt,tlt src,est tau,max acc,pos gain,vel gain,outer max,vel cmd,method,k tilt,k rate,k pos,k vel,gain sched,tilt bq,D bq,osc lo Hz,osc hi Hz,osc warn,tune pid,tune hyst,dmp batch");
+
+   // then the values for the control parameters
+   publishParams();                  // use same routine as MQTT getvars command uses
+
+   // then the column titles for the repeated data points that are published every time we read the IMU and do balancing calculations
+   publishMQTT(MQTTTop_shtCom, "IMUdelta,readFIFO,dmpGet,AllReadIMU,OldbalByAng,tilt,angErr,raw pid,pid,Isum,Dslope,MotorInt,runflags,R.O.time,MQpubCnt,uMDtime,pos err,vel err,trgt");
+
+   // the actual data points are queued by balanceByAngle() and balanceByState(), and published by publishBalanceTelemetry()
+} // announceAwake()
+
 /**
  * @brief Enable or disable motor based on robot angle
 =================================================================================================== */
@@ -2229,24 +2929,7 @@ void checkBalanceState()
             balance.state = bs_awake;       // we're now waiting to hit almost vertical before going active
             AMDP_PRINTLN( "<checkBalanceState> entering state bs_awake");
 
-            // update left eye with network info that is now available and static
-            updateLeftOLEDNetInfo();        // put IP, MAC, Accesspoint & MQTT hostname into left eye.
-
-            // do a test event publish before the stuff that goes into the spreadsheet to avoid messing it up
-            publishEvent(0,0,"test-event");
-
-            // publish preliminary info into the MQTT balance telemetry log to help with telemetry interpretation before we get busy
-            // first, publish the column titles for the control parameters
-            publishMQTT(MQTTTop_shtCom,"PGain,IGain,ICnt,DGain,slow Tks,fast Tks,smooth,tmrIMU,trgt ang,act ang,QOS");
-
-            // then the values for the control parameters
-            publishParams();                  // use same routine as MQTT getvars command uses
-
-            // then the column titles for the repeated data points that are published every time we read the IMU and do balancing calculations
-            publishMQTT(MQTTTop_shtCom, "IMUdelta,readFIFO,dmpGet,AllReadIMU,OldbalByAng,tilt,angErr,raw pid,pid,Isum,Dslope,MotorInt,runflags,R.O.time,MQpubCnt,uMDtime");
-
-            // the actual data points are published in balanceByAngle()
-
+            wakeUps.publish(++wakeCount);   // announceAwake() does the OLED and MQTT work, on housekeeping's core
          }  // if (abs(balance.tilt)
 
          else // otherwise robot has such a big tilt that it should not be trying to balance
@@ -2266,7 +2949,9 @@ void checkBalanceState()
          {  if(abs(balance.tilt-balance.targetAngle) <= balance.activeAngle)      // are we almost vertical?
                {  balance.state = bs_active;              // yes, so start trying to balance
                   AMDP_PRINTLN( "<checkBalanceState> entering state bs_active");
-                  for (int t =1; t<= balance.pidICount; t++) {balance.errHistory[t] = 0;}  // initialize remembered errors to zero
+                  balCore.resetErrHistory();              // initialize remembered errors to zero
+                  resetOuterLoop();                       // and hold position right here
+                  runStats.start(millis());               // start a fresh set of run statistics
                }
                if(abs(-balance.targetAngle > balance.maxAngleMotorActive))    // if we're more than 30 degress from vertical...
                {  balance.state = bs_sleep;                                   // fall back to sleep
@@ -2278,11 +2963,11 @@ void checkBalanceState()
       case bs_active:
       {  if(abs(balance.tilt-balance.targetAngle) >= balance.maxAngleMotorActive)       // have we gone more than 30 degrees from vertical?
          {  balance.state = bs_sleep;    // abort balancing efforts, and go back to waiting for less than 30 degrees tilt
-            left.tickSetting = 0;       // stop the motors
-            right.tickSetting = 0;
-            left.tickLimit = 0;
-            right.tickLimit = 0;
+            tuner.abort();              // and any autotune run
+            motors->stop();             // stop the motors
             balance.motorTicks = 0;
+            runStats.end(millis());     // getHealthTelemetry() says how the run went
+            runResults.publish(runStats);
             AMDP_PRINTLN("<checkTiltToActivateMotors> Disable stepper motors");
             digitalWrite(gp_DRV1_ENA, HIGH);
             digitalWrite(gp_DRV2_ENA, HIGH);
@@ -2325,12 +3010,424 @@ void setRobotObjective(int objective)
   */
 } //setRobotObjective()
 
+/**
+ * @brief One IMU cycle: read a DMP sample, then do motor testing or balancing with it
+ * @details Called from controlTask() every tmrIMU milliseconds, or each time the IMU raises gp_IMU_INT when
+ *          imuInterruptDriven is true
+=================================================================================================== */
+void imuCycle()
+{
+   holdMilli1 = telMilli1;               // remember previous startime to calculate delta time between cycles
+   telMilli1 = millis();                 // get a timestamp for telemetry data (gives telemetry publish delay)
+   tm_IMUdelta = telMilli1 - holdMilli1; // telemetry measurement: elapsed time since last cycle.
+   unsigned long thStart = micros();
+   boolean rCode = readIMU();            // Read the IMU. Balancing and data printing is handled in here as well
+   th_readIMU.record(micros() - thStart);
+   telMilli4 = millis();                 // telemetry timestamp (gives readIMU execution time)
+   tm_allReadIMU = telMilli4 - telMilli1; // telemetry measurement: total time for readIMU routine
+   if (rCode)                            //de even if we don't read IMU, should still do balancing?
+   {
+      if(balance.motorTest == true)       // are we in motor testing mode?
+      {
+         //        AMDP_PRINTLN("<checkTiltToActivateMotors> Enable stepper motors");
+         if(digitalRead(gp_SWR_BUTTON) == true)
+         {
+            // turn motors on, but only if they aren't already on
+            if(digitalRead(gp_DRV2_ENA) == HIGH)
+            {
+               digitalWrite(gp_DRV1_ENA, LOW);   // turn on the motors
+               digitalWrite(gp_DRV2_ENA, LOW);
+            }
+            motors->setTicks(balance.directionMod * balance.testLeft,    // use motor speeds from MQTT motor command
+                             balance.directionMod * balance.testRight);
+         }
+         else        // i.e. sw readable switch says stop motor test...
+         {           // turn off the motors, 
+            // leave them enabled, so we don't lose sync with the motors,
+            // digitalWrite(gp_DRV1_ENA, HIGH);
+            // digitalWrite(gp_DRV2_ENA, HIGH);
+
+            // but stop issuing step commands (leaving the wheels clenched on purpose)
+            motors->setTicks(0, 0); //  leave motor speeds from MQTT motor command untouched
+            //                      // but prevent interrupt level from stepping 
+         }  // else gp_SWQR_BUTTON == true
+      }  // if(balance.motorTest == true)
+      else      // following is normal case where IMU readings control balancing efforts
+      {
+         checkBalanceState();                // handle balance state changes: sleep, awake, active
+ 
+         if(balance.state ==bs_active)       // if we're in a state where we can try to balance or do speed test
+         {                                   // then do so, depending on which method we're using
+            if(balance.method == bm_catchup)
+            {
+               //de suggest removing the arg in radians, and use stored balance.tilt value in degrees
+               calcBalanceParmeters((balance.tilt + 90) * DEG_TO_RAD);   // Do balancing calculations based on catch up distance
+            }  // if(balance.method)
+            if(balance.method == bm_angle)
+            {  if (!tuner.running() && outer.due()) outerLoopCycle(); // every outerEvery cycles, move the target angle to hold position
+               thStart = micros();
+               balanceByAngle();                 // Do balancing calc's based on angle displacement from vertical
+               th_balance.record(micros() - thStart);
+               //                                // and publish telemetry, resetting runFlagword
+               telMilli5 = millis();             // telemetry timestamp (gives balanceByAngle execution time)
+               tm_OldbalByAng = telMilli5 - telMilli4; // telemetry measurement: time in BalanceByAngle, reported in NEXT MQTT publish
+            }
+            if(balance.method == bm_state)
+            {  thStart = micros();
+               balanceByState();                 // Do balancing calc's based on tilt, tilt rate, wheel position & speed
+               th_balance.record(micros() - thStart);
+               telMilli5 = millis();
+               tm_OldbalByAng = telMilli5 - telMilli4; // reported in the same telemetry slot as balanceByAngle's time
+            }
+            if(balance.method == bm_state)       // run statistics. Saturated is wanting more than the wheels are allowed
+               runStats.add(balance.angleErr, balance.motorTicks == 0, abs(balance.pid) >= stateFb.maxSpeed);
+            else if(balance.method == bm_angle)
+               runStats.add(balance.angleErr, balance.motorTicks == 0, abs(balance.pidRaw) > pidLimit);
+            oscMonitor.push(micros(), balance.tilt);  // for oscillationTask, which only looks at tilt while balancing
+         }  // if(balance.state...) 
+      }   // else , motorTest 
+   } // if rCode
+} // imuCycle()
+
+/**
+ * @brief ISR for the IMU's data ready interrupt. Wakes controlTask() to read the new DMP packet
+=================================================================================================== */
+void IRAM_ATTR dmpDataReady()
+{
+   BaseType_t woken = pdFALSE;
+   imuSampleMicros = micros();                        // packet was just pushed into the FIFO
+   vTaskNotifyGiveFromISR(controlTaskHandle, &woken); // count the sample, controlTask will take it
+   if (woken == pdTRUE) portYIELD_FROM_ISR();         // switch straight to controlTask rather than at next tick
+} // dmpDataReady()
+
+/**
+ * @brief Track the worst control cycle timing error, and the cycle period histogram, for health telemetry
+ * @details Compares the time since the previous cycle started against tmrIMU. Called at the start of each cycle.
+=================================================================================================== */
+void trackControlJitter()
+{
+   unsigned long now = micros();
+   if (ctlLastStart != 0)                       // nothing to compare the first cycle against
+   {
+      th_period.record(now - ctlLastStart);
+      int jitter = (int)(now - ctlLastStart) - balance.tmrIMU * 1000;
+      if (jitter < 0) jitter = -jitter;
+      if (jitter > health.ctlJitterMaxUs) health.ctlJitterMaxUs = jitter;
+   }
+   ctlLastStart = now;
+} // trackControlJitter()
+
+/**
+ * @brief Give the wheel speed estimator the latest step counts, forward being positive whichever way the motors are wired
+ * @details Called at the end of each control cycle. Costs the step generator nothing, it keeps the counts anyway
+=================================================================================================== */
+void updateOdometry()
+{
+   int32_t leftSteps, rightSteps;
+   motors->getSteps(leftSteps, rightSteps);
+   odometry.update(micros(), balance.directionMod * leftSteps, balance.directionMod * rightSteps);
+} // updateOdometry()
+
+/**
+ * @brief Take one raw accel & gyro sample and feed it to the tilt estimator
+ * @note  getMotion6() reads all 14 bytes from ACCEL_XOUT_H in one I2C transaction
+=================================================================================================== */
+void readRawIMU()
+{
+   int16_t ax, ay, az, gx, gy, gz;
+   imuSampleMicros = micros();
+   mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
+   estimator.update(ay, az, gx, rawImuPeriod / 1000.0f);
+} // readRawIMU()
+
+/**
+ * @brief Set the IMU up for the tilt source asked for in balance.tiltSource
+ * @details Raw mode needs the sensor registers updated at 1 kHz, so it drops SMPLRT_DIV to 0 (the DLPF is on, so the gyro
+ *          output rate is 1 kHz). That speeds the DMP up too, so going back to the DMP restores the divider and throws away
+ *          whatever packets were made in the meantime. Only called from controlTask, which owns the IMU's I2C bus.
+=================================================================================================== */
+void switchTiltSource()
+{
+   if (balance.tiltSource == ts_raw)
+   {
+      mpu.setRate(0);
+      int16_t ax, ay, az, gx, gy, gz;
+      mpu.getMotion6(&ax, &ay, &az, &gx, &gy, &gz);
+      estimator.seed(ay, az);                    // start from where the accelerometer says we are
+   }
+   else
+   {
+      mpu.setRate(dmpSampleRateDiv);
+      mpu.resetFIFO();
+   }
+   tiltSourceActive = balance.tiltSource;
+   AMDP_PRINT("<switchTiltSource> tilt source now ");
+   AMDP_PRINTLN(tiltSourceActive);
+} // switchTiltSource()
+
+/**
+ * @brief Highest priority task, alone on its core, that runs one imuCycle() per tmrIMU or per DMP sample
+ * @details With ts_raw as the tilt source, we wake every rawImuPeriod milliseconds to update the tilt estimator, and
+ *          do an imuCycle() once tmrIMU milliseconds' worth of samples are in.
+ *          With imuInterruptDriven false we wake every tmrIMU milliseconds, on the tick, regardless of how long the
+ *          previous cycle took. With it true we wait for dmpDataReady(). The DMP pushes a packet into its FIFO and
+ *          pulses INT each time it has one, so by the time we're woken there's normally exactly one packet waiting, and
+ *          dmpGetLatestFIFOPacket() reads it, or the newest of several, without spinning. If a wake up doesn't come
+ *          within imuTimeout the interrupt has gone missing, and we count it as missing data.
+ *          With imuAsyncI2C true, the FIFO read is started as soon as we wake. i2cBusTask, one priority up on the same core,
+ *          puts it on the bus straight away and blocks on the driver until it's over, so wheel odometry and the rest of
+ *          the cycle's set up go on meanwhile. th_imuBus vs th_readIMU in health telemetry shows how much was overlapped.
+=================================================================================================== */
+void controlTask(void *parameter)
+{
+   TickType_t lastWake = xTaskGetTickCount();
+   int rawMsec = 0;                        // milliseconds of raw samples taken since the last imuCycle()
+   for (;;)
+   {
+      if (balance.tiltSource != tiltSourceActive)
+      {
+         switchTiltSource();
+         lastWake = xTaskGetTickCount();   // don't try to catch up on time spent waiting for interrupts
+      }
+      if (tiltSourceActive == ts_raw)
+      {
+         vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(rawImuPeriod));
+         unsigned long start = micros();
+         readRawIMU();
+         cu_IMU += micros() - start;
+         rawMsec += rawImuPeriod;
+         if (rawMsec < balance.tmrIMU) continue;
+         rawMsec = 0;
+      }
+      else
+      {
+   #if imuInterruptDriven == true
+         if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(imuTimeout)) == 0)
+         {
+            health.dmpFifoDataMissingCnt++;   // no interrupt from the IMU in a long time
+            continue;
+         }
+   #else
+         vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(balance.tmrIMU));
+   #endif
+      }
+   #if imuAsyncI2C == true
+      startReadIMU();                      // FIFO read goes on in i2cBusTask while we get on with the rest
+   #endif
+      if (th_resetPending)                 // TIMINGRESET command came in
+      {
+         th_period.reset();
+         th_readIMU.reset();
+         th_balance.reset();
+         th_latency.reset();
+         th_imuBus.reset();
+         th_resetPending = false;
+      }
+      if (coreParams.fetch(newCoreParams, coreParamsSeen))   // new params from loadBalanceCore(), whole or not at all
+         balCore.load(newCoreParams);
+      unsigned long start = micros();
+      trackControlJitter();
+      updateOdometry();                    // doesn't need the IMU, so it goes while the FIFO read is on the bus
+      imuCycle();
+      cu_IMU += micros() - start;          // add elapsed cpu time to IMU routine counter
+   } // for
+} // controlTask()
+
+/**
+ * @brief Everything but balancing, run over and over by housekeepingTask(). This used to be the body of loop()
+=================================================================================================== */
+void housekeeping()
+{
+   cu_loopStart = micros();                     // start point for time used in this loop
+   if(cu_lastLoopEnd != 0)                      // if we're doing first measured second, skip adding previous OS overhead
+   {
+      cu_OS += cu_loopStart - cu_lastLoopEnd;   // add on time after last loop ended & before this one started
+   }
+
+   uint32_t wakes;
+   if (wakeUps.fetch(wakes, wakeUpsSeen)) announceAwake();   // controlTask has woken the robot up since last time
+   publishBalanceTelemetry();                   // and any rows of balance telemetry it has queued
+
+   if (WifiLastEvent != -1) 
+   {
+      processWifiEvent();     // if there's a pending Wifi event, handle it
+      cu_wifi += micros() - cu_loopStart;   // add time to wifi routine counter
+   }               
+   else
+   {  if (millis() >= goOLED) 
+      {
+         updateRightOLED();                    // replace contents of both OLED displays
+         cu_OLED += micros() - cu_loopStart;   // add time to OLED routine counter
+      }
+      else 
+      {   
+         if (millis() >= goLED)
+         {  updateLED();                                          // Update the front amber LED
+            if(millis() < 10000) { updateLeftOLEDNetInfo(); } ;    // and the network info in left OLED
+            cu_LED += micros() - cu_loopStart;   // add time to LED routine counter
+         }            
+         else 
+         {  if (millis() >= goMETADATA)
+            {
+               getHealthTelemetry();           // Send data to serial terminal
+               cu_metaData += micros() - cu_loopStart;   // add time to mettadata routine counter
+            }     
+            else
+            {
+               // here if no routines were executed during loop() - took all the else cases.
+               // capture the loop spinning overhead here, in cu_loop, after end of second work
+
+               // check to see if we've got to the end of the measurment second
+               int cu_secTime = micros() - cu_secStart;   // how far are we into the current second?
+               if(cu_secTime >= 1000000)                  // are we more than a million microseconds since start of measurement second?
+               {                                          // yes - time to analyse cpu percengtage use & leave it ready for OLED display
+                  int cu_subTotal = cu_wifi +cu_OLED +cu_LED +cu_metaData +cu_OS +cu_loop;
+                  // cu_mqtt purposely excluded - it overlaps other usage times
+                  // cu_IMU too - controlTask runs on the other core
+
+                  cu_other = cu_secTime - cu_subTotal;    //
+
+                  // calculate percent usage and leave it for OLED routines to display
+                  // TODO track high water mark for each CPU usage counter
+                  cu$IMU = 100*cu_IMU / cu_secTime;                    // % of controlTask's core spent in controlTask
+                  cu$wifi = 100*cu_wifi / cu_secTime;                  // % time spent in wifi processing in main loop
+                  cu$OLED = 100*cu_OLED / cu_secTime;                  // % time spent in goOLED controlled part of main loop
+                  cu$LED = 100*cu_LED / cu_secTime;                    // % time spent in goLED controlled part of main loop
+                  cu$metaData = 100*cu_metaData / cu_secTime;          // % time spent in goMetadata controlled part of main loop
+                  cu$OS = 100*cu_OS / cu_secTime;                      // % time spent outside of loop()
+                  cu$loop = 100*cu_loop / cu_secTime;                  // % time spinning in loop() finding nothing to do
+                  cu$other = 100*cu_other / cu_secTime;                // % time spent in "none of the above", i.e. what's left to make up the second
+                  cu$mqtt = 100*cu_mqtt / cu_secTime;                  // similar %, but it's embedded in other usage times as an interrupting routine
+
+                  cu_IMU = 0;       // zero time counters for next second
+                  cu_wifi = 0;
+                  cu_OLED = 0; 
+                  cu_LED = 0; 
+                  cu_metaData = 0;
+                  cu_OS = 0; 
+                  cu_loop = 0; 
+                  cu_other = 0; 
+                  cu_mqtt = 0;
+
+                  cu_secStart = micros();          // start up a new measurement second
+               }   // if cu_secTime > 1,000,000 
+               cu_loop += micros() - cu_loopStart;   // add time to loop routine counter
+
+            }    // else for goMETADATA
+         }     // else for goLED
+      }      // else for goOLED
+   }       // else for Wifi event handler
+         // get here whether or not a routine was executed during loop
+   // set up to capture OS overhead outside of loop() when next loop starts
+   cu_lastLoopEnd = micros();           // OS stuff between loops starts at this point, ends at start of next loop() iteration
+} // housekeeping()
+
+/**
+ * @brief Low priority task, on the other core from controlTask, doing everything that used to share loop() with it
+=================================================================================================== */
+void housekeepingTask(void *parameter)
+{
+   for (;;)
+   {
+      housekeeping();
+      vTaskDelay(1);                       // let the idle task run, or the task watchdog on this core bites
+   } // for
+} // housekeepingTask()
+
+/**
+ * @brief Low priority task that works out the tilt spectrum from samples controlTask queues, see oscillation_monitor.h
+=================================================================================================== */
+void oscillationTask(void *parameter)
+{
+   for (;;)
+   {
+      oscMonitor.run();                    // waits on the queue, so no delay needed for the idle task
+   } // for
+} // oscillationTask()
+
+#if imuAsyncI2C == true
+/**
+ * @brief Task that runs imuBus's transactions, see i2c_async.h. Same core as controlTask, one priority up, so a submit()
+ *        switches to it at once. It hands the core back while i2c_master_cmd_begin() waits on the driver's interrupt
+=================================================================================================== */
+void i2cBusTask(void *parameter)
+{
+   for (;;)
+   {
+      imuBus.run();                        // waits on the queue, so no delay needed for the idle task
+   } // for
+} // i2cBusTask()
+#endif
+
+/**
+ * @brief Start the IMU's I2C bus: Wire, or with imuAsyncI2C true, imuBus and i2cBusTask, with I2Cdev hooked onto them
+ * @note  if imuBus won't start, every I2Cdev call fails, and setupIMU() halts on the failed connection test
+=================================================================================================== */
+void setupImuBus()
+{
+#if imuAsyncI2C == true
+   imuBus.begin(I2C_NUM_0, gp_I2C_IMU_SDA, gp_I2C_IMU_SCL, I2C_bus1_speed);
+   fifoTxn.devAddr = MPU6050_I2C_ADD;
+   fifoTxn.done = xSemaphoreCreateBinary();
+   xTaskCreatePinnedToCore(i2cBusTask,           // Function that runs imuBus's transactions
+                           "i2cBusTask",         // Human readable name
+                           i2cBusTaskStack,      // Stack size in bytes
+                           NULL,                 // No parameters
+                           i2cBusTaskPriority,   // Priority, above controlTask, so its reads start as soon as submitted
+                           NULL,                 // Handle, not needed
+                           ARDUINO_RUNNING_CORE);// Core controlTask runs on
+   I2Cdev::readHook = imuBusRead;
+   I2Cdev::writeHook = imuBusWrite;
+#else
+   Wire.begin(gp_I2C_IMU_SDA, gp_I2C_IMU_SCL, I2C_bus1_speed);
+#endif
+} // setupImuBus()
+
+/**
+ * @brief Start controlTask, housekeepingTask and oscillationTask, and hook the IMU's INT pin to controlTask if imuInterruptDriven is true
+ * @details dmpInitialize() already has the IMU pulsing INT low once per DMP packet (every dmpPeriodMsec), so in
+ *          interrupt mode balance.tmrIMU no longer sets the pace. It's still what the D slope, biquad designs, outer loop
+ *          and jitter measurement go by, so cfgByMAC() sets it to dmpPeriodMsec, and setvar BALANCE.TMRIMU leaves it be.
+=================================================================================================== */
+void setupControlTask()
+{
+   oscMonitor.begin();                           // queues have to be there before controlTask pushes into them
+   balTelRows = xQueueCreate(balTelQueueLength, sizeof(balTelRow));
+   xTaskCreatePinnedToCore(controlTask,          // Function that reads the IMU and balances
+                           "controlTask",        // Human readable name
+                           controlTaskStack,     // Stack size in bytes
+                           NULL,                 // No parameters
+                           controlTaskPriority,  // Priority, above everything else we run
+                           &controlTaskHandle,   // Handle the ISR notifies
+                           ARDUINO_RUNNING_CORE);// Core housekeepingTask stays off of
+   xTaskCreatePinnedToCore(housekeepingTask,     // Function that runs OLED, LED, WiFi events and health telemetry
+                           "housekeepingTask",   // Human readable name
+                           housekeepingTaskStack,// Stack size in bytes
+                           NULL,                 // No parameters
+                           housekeepingTaskPriority, // Priority, same as loop()
+                           &housekeepingTaskHandle,  // Handle, not used for now
+                           HOUSEKEEPING_CORE);   // Core controlTask stays off of
+   xTaskCreatePinnedToCore(oscillationTask,      // Function that looks for tilt oscillation
+                           "oscillationTask",    // Human readable name
+                           oscillationTaskStack, // Stack size in bytes
+                           NULL,                 // No parameters
+                           oscillationTaskPriority, // Priority, as low as housekeepingTask
+                           NULL,                 // Handle, not needed
+                           HOUSEKEEPING_CORE);   // Core controlTask stays off of
+#if imuInterruptDriven == true
+   pinMode(gp_IMU_INT, INPUT);                   // GPIO39 is input only, and the IMU drives INT push-pull
+   mpu.resetFIFO();                              // start clean, so first interrupt finds exactly one packet
+   attachInterrupt(gp_IMU_INT, dmpDataReady, FALLING); // INT is active low
+   AMDP_PRINTLN("<setupControlTask> DMP interrupts enabled on gp_IMU_INT");
+#endif
+} // setupControlTask()
+
 /** 
  * @brief Standard set up routine for Arduino programs 
 =================================================================================================== */
 void setup()
 {
-   Wire.begin(gp_I2C_IMU_SDA, gp_I2C_IMU_SCL, I2C_bus1_speed);
+   setupImuBus();                         // Wire, or the i2cAsync engine, for the IMU's I2C bus
    Serial.begin(115200); // Open a serial connection at 115200bps
    while (!Serial) ;     // Wait for Serial port to be ready
    Serial.println(F("<setup> Start of setup"));
@@ -2355,12 +3452,11 @@ void setup()
     updateLeftOLEDNetInfo();             // aftersetup's done, show IP, MAC, AccessPoint and Hostname in left OLED
    goOLED = millis() + tmrOLED;         // Reset OLED update counter
    goLED = millis() + tmrLED;           // Reset LED flashing counter
-   goIMU = millis() + balance.tmrIMU;   // Reset IMU update counterFtitles
 
    goMETADATA = millis() + tmrMETADATA; // Reset IMU update counter
    updateLeftOLEDNetInfo();             // output network info once since it's stable, not repeatedly
 
-   cu_IMU = 0;                   // time spent in goIMU controlled part of main loop
+   cu_IMU = 0;                   // time spent in controlTask
    cu_wifi = 0;                  // time spent in wifi processing in main loop
    cu_OLED = 0;                  // time spent in goOLED controlled part of main loop
    cu_LED = 0;                   // time spent in goLED controlled part of main loop
@@ -2372,155 +3468,17 @@ void setup()
 
    cu_secStart = micros();       // cpu utilization is measured over each second, and first second starts now
    cu_lastLoopEnd = 0;           // signal that we're starting, and don't have a previous loop to worry about
+   setupControlTask();           // Start balancing and housekeeping, now that everything they use is ready
 
    Serial.println(F("<setup> End of setup"));
 } //setup()
 
 /**
  * @brief Standard looping routine for Arduino programs
+ * @details Not needed. Balancing runs in controlTask and everything else in housekeepingTask, so Arduino's loop task
+ *          deletes itself the first time through
 =================================================================================================== */
 void loop()
 {
-  
-   cu_loopStart = micros();                     // start point for time used in this loop
-   if(cu_lastLoopEnd != 0)                      // if we're doing first measured second, skip adding previous OS overhead
-   {
-      cu_OS += cu_loopStart - cu_lastLoopEnd;   // add on time after last loop ended & before this one started
-   }
-
-   if (millis() >= goIMU)                  // use "else if" to only allow one routine to run per loop()...
-   {                                       // which increases frequency of checks for goIMU readiness
-      goIMU = millis() + balance.tmrIMU;    // Reset IMU update counter right away.
-      holdMilli1 = telMilli1;               // remember previous startime to calculate delta time for goIMU starts
-      telMilli1 = millis();                 // get a timestamp for telemetry data (gives telemetry publish delay)
-      tm_IMUdelta = telMilli1 - holdMilli1; // telemetry measurement: elapsed time since last goIMU call.
-      boolean rCode = readIMU();            // Read the IMU. Balancing and data printing is handled in here as well
-      telMilli4 = millis();                 // telemetry timestamp (gives readIMU execution time)
-      tm_allReadIMU = telMilli4 - telMilli1; // telemetry measurement: total time for readIMU routine
-      if (rCode)                            //de even if we don't read IMU, should still do balancing?
-      {
-         if(balance.motorTest == true)       // are we in motor testing mode?
-         {
-            //        AMDP_PRINTLN("<checkTiltToActivateMotors> Enable stepper motors");
-            if(digitalRead(gp_SWR_BUTTON) == true)
-            {
-               // turn motors on, but only if they aren't already on
-               if(digitalRead(gp_DRV2_ENA) == HIGH)
-               {
-                  digitalWrite(gp_DRV1_ENA, LOW);   // turn on the motors
-                  digitalWrite(gp_DRV2_ENA, LOW);
-               }
-               noInterrupts();         // block any motor interrupts while we change control parameters
-               left.tickSetting = balance.directionMod * balance.testLeft;   // use motor speeds from MQTT motor command
-               right.tickSetting = balance.directionMod * balance.testRight; 
-               interrupts();
-            }
-            else        // i.e. sw readable switch says stop motor test...
-            {           // turn off the motors, 
-               // leave them enabled, so we don't lose sync with the motors,
-               // digitalWrite(gp_DRV1_ENA, HIGH);
-               // digitalWrite(gp_DRV2_ENA, HIGH);
-
-               // but stop issuing step commands (leaving the wheels clenched on purpose)
-               noInterrupts();         // block any motor interrupts while we change control parameters
-               left.tickSetting = 0;   //  leave motor speeds from MQTT motor command untouched
-               right.tickSetting = 0;  // but prevent interrupt level from stepping 
-               interrupts();
-            }  // else gp_SWQR_BUTTON == true
-         }  // if(balance.motorTest == true)
-         else      // following is normal case where IMU readings control balancing efforts
-         {
-            checkBalanceState();                // handle balance state changes: sleep, awake, active
- 
-            if(balance.state ==bs_active)       // if we're in a state where we can try to balance or do speed test
-            {                                   // then do so, depending on which method we're using
-               if(balance.method == bm_catchup)
-               {
-                  //de suggest removing the arg in radians, and use stored balance.tilt value in degrees
-                  calcBalanceParmeters(ypr[2]);   // Do balancing calculations based on catch up distance
-               }  // if(balance.method)
-               if(balance.method == bm_angle)
-               {  balanceByAngle();                 // Do balancing calc's based on angle displacement from vertical
-                  //                                // and publish telemetry, resetting runFlagword
-                  telMilli5 = millis();             // telemetry timestamp (gives balanceByAngle execution time)
-                  tm_OldbalByAng = telMilli5 - telMilli4; // telemetry measurement: time in BalanceByAngle, reported in NEXT MQTT publish
-               }
-            }  // if(balance.state...) 
-         }   // else , motorTest 
-      } // if rCode
-      cu_IMU += micros() - cu_loopStart;   // add elapsed cpu time to IMU routine counter
-   }  // if millis() > goIMU
-   else 
-   {  if (WifiLastEvent != -1) 
-      {
-         processWifiEvent();     // if there's a pending Wifi event, handle it
-         cu_wifi += micros() - cu_loopStart;   // add time to wifi routine counter
-      }               
-      else
-      {  if (millis() >= goOLED) 
-         {
-            updateRightOLED();                    // replace contents of both OLED displays
-            cu_OLED += micros() - cu_loopStart;   // add time to OLED routine counter
-         }
-         else 
-         {   
-            if (millis() >= goLED)
-            {  updateLED();                                          // Update the front amber LED
-               if(millis() < 10000) { updateLeftOLEDNetInfo(); } ;    // and the network info in left OLED
-               cu_LED += micros() - cu_loopStart;   // add time to LED routine counter
-            }            
-            else 
-            {  if (millis() >= goMETADATA)
-               {
-                  getHealthTelemetry();           // Send data to serial terminal
-                  cu_metaData += micros() - cu_loopStart;   // add time to mettadata routine counter
-               }     
-               else
-               {
-                  // here if no routines were executed during loop() - took all the else cases.
-                  // capture the loop spinning overhead here, in cu_loop, after end of second work
-
-                  // check to see if we've got to the end of the measurment second
-                  int cu_secTime = micros() - cu_secStart;   // how far are we into the current second?
-                  if(cu_secTime >= 1000000)                  // are we more than a million microseconds since start of measurement second?
-                  {                                          // yes - time to analyse cpu percengtage use & leave it ready for OLED display
-                     int cu_subTotal = cu_IMU +cu_wifi +cu_OLED +cu_LED +cu_metaData +cu_OS +cu_loop;
-                     // cu_mqtt purposely excluded - it overlaps other usage times
-
-                     cu_other = cu_secTime - cu_subTotal;    //
-
-                     // calculate percent usage and leave it for OLED routines to display
-                     // TODO track high water mark for each CPU usage counter
-                     cu$IMU = 100*cu_IMU / cu_secTime;                    // % time spent in goIMU controlled part of main loop
-                     cu$wifi = 100*cu_wifi / cu_secTime;                  // % time spent in wifi processing in main loop
-                     cu$OLED = 100*cu_OLED / cu_secTime;                  // % time spent in goOLED controlled part of main loop
-                     cu$LED = 100*cu_LED / cu_secTime;                    // % time spent in goLED controlled part of main loop
-                     cu$metaData = 100*cu_metaData / cu_secTime;          // % time spent in goMetadata controlled part of main loop
-                     cu$OS = 100*cu_OS / cu_secTime;                      // % time spent outside of loop()
-                     cu$loop = 100*cu_loop / cu_secTime;                  // % time spinning in loop() finding nothing to do
-                     cu$other = 100*cu_other / cu_secTime;                // % time spent in "none of the above", i.e. what's left to make up the second
-                     cu$mqtt = 100*cu_mqtt / cu_secTime;                  // similar %, but it's embedded in other usage times as an interrupting routine
-
-                     cu_IMU = 0;       // zero time counters for next second
-                     cu_wifi = 0;
-                     cu_OLED = 0; 
-                     cu_LED = 0; 
-                     cu_metaData = 0;
-                     cu_OS = 0; 
-                     cu_loop = 0; 
-                     cu_other = 0; 
-                     cu_mqtt = 0;
-
-                     cu_secStart = micros();          // start up a new measurement second
-                  }   // if cu_secTime > 1,000,000 
-                  cu_loop += micros() - cu_loopStart;   // add time to loop routine counter
-
-               }    // else for goMETADATA
-            }     // else for goLED
-         }      // else for goOLED
-      }       // else for Wifi event handler
-            // get here whether or not a routine was executed during loop
-   }
-   // set up to capture OS overhead outside of loop() when next loop starts
-   cu_lastLoopEnd = micros();           // OS stuff between loops starts at this point, ends at start of next loop() iteration
+   vTaskDelete(NULL);
 } //loop()
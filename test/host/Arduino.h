@@ -0,0 +1,96 @@
+/*************************************************************************************************************************************
+ * @file Arduino.h
+ * @author va3wam
+ * @brief Host stand in for the Arduino core, just enough for the pure headers in include/ to build under g++ on Linux
+ * @details Only the host tests in this folder use it. Time comes from the host's steady clock, IRAM_ATTR and friends are
+ *          empty, and the math constants are the core's.
+ *          GPIO and the hardware timers are pretend: digitalWrite() keeps each pin's level in hostPins and counts its rising
+ *          edges, and a timer just remembers its ISR and alarm, so a test can call the ISR itself as often as the alarm
+ *          would have gone off.
+ * @version 0.0.2
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ * 0.0.2   2026-10-16 Pretend GPIO and hw_timer, for the step generators
+ *************************************************************************************************************************************/
+
+#ifndef hostArduino_h
+#define hostArduino_h
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#define PI 3.1415926535897932384626433832795
+#define HALF_PI 1.5707963267948966192313216916398
+#define TWO_PI 6.283185307179586476925286766559
+#define DEG_TO_RAD 0.017453292519943295769236907684886
+#define RAD_TO_DEG 57.295779513082320876798154814105
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+inline unsigned long micros()
+{  static const auto start = std::chrono::steady_clock::now();
+   return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+inline unsigned long millis() { return micros() / 1000; }
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define hostPinCount 40          // ESP32 GPIO 0 .. 39
+
+struct hostPin
+{
+   uint8_t mode;
+   uint8_t level;
+   uint32_t rises;               // LOW to HIGH writes
+};
+static hostPin hostPins[hostPinCount];
+
+inline void pinMode(uint8_t pin, uint8_t mode) { hostPins[pin].mode = mode; }
+
+inline void digitalWrite(uint8_t pin, uint8_t level)
+{  if (level && !hostPins[pin].level) hostPins[pin].rises++;
+   hostPins[pin].level = level;
+}
+
+inline int digitalRead(uint8_t pin) { return hostPins[pin].level; }
+
+struct hw_timer_t
+{
+   uint16_t divider;
+   bool countUp;
+   void (*isr)();
+   uint64_t alarm;
+   bool autoReload;
+   bool enabled;
+};
+static hw_timer_t hostTimers[4];
+
+inline hw_timer_t *timerBegin(uint8_t num, uint16_t divider, bool countUp)
+{  hostTimers[num] = hw_timer_t{divider, countUp, NULL, 0, false, false};
+   return &hostTimers[num];
+}
+
+inline void timerAttachInterrupt(hw_timer_t *timer, void (*fn)(), bool edge) { timer->isr = fn; }
+inline void timerAlarmWrite(hw_timer_t *timer, uint64_t alarm, bool autoReload) { timer->alarm = alarm; timer->autoReload = autoReload; }
+inline void timerAlarmEnable(hw_timer_t *timer) { timer->enabled = true; }
+inline void timerAlarmDisable(hw_timer_t *timer) { timer->enabled = false; }
+
+#endif
@@ -0,0 +1,174 @@
+/*************************************************************************************************************************************
+ * @file i2c.h
+ * @author va3wam
+ * @brief Host mock of the ESP-IDF I2C master driver, for testing i2cAsync (i2c_async.h) without a bus
+ * @details A command link is a list of what i2cAsync asked for: starts, bytes written, reads, stop. i2c_master_cmd_begin()
+ *          turns that back into one register transfer, the device address, the register, any bytes written after it, and
+ *          where to put any bytes read after the repeated start. It logs the transfer in mockI2c.log and hands it to
+ *          mockI2c.device, a function the test supplies to act as the chip on the other end. Whatever that returns is what
+ *          the driver call returns, so a test can NACK (ESP_FAIL) or time out (ESP_ERR_TIMEOUT) any transfer it likes.
+ *          With no device set, every transfer is NACKed, as it would be with nothing on the bus.
+ *          Only the calls i2c_async.h makes are here, with the IDF 3.x argument lists.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * @ref https://docs.espressif.com/projects/esp-idf/en/v3.3/api-reference/peripherals/i2c.html
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#ifndef hostI2c_h
+#define hostI2c_h
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "freertos/FreeRTOS.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_TIMEOUT 0x107
+
+typedef int i2c_port_t;
+#define I2C_NUM_0 0
+#define I2C_NUM_1 1
+
+typedef enum { I2C_MODE_SLAVE = 0, I2C_MODE_MASTER } i2c_mode_t;
+typedef enum { I2C_MASTER_WRITE = 0, I2C_MASTER_READ } i2c_rw_t;
+typedef enum { I2C_MASTER_ACK = 0, I2C_MASTER_NACK, I2C_MASTER_LAST_NACK } i2c_ack_type_t;
+typedef enum { GPIO_PULLUP_DISABLE = 0, GPIO_PULLUP_ENABLE } gpio_pullup_t;
+
+typedef struct
+{
+   i2c_mode_t mode;
+   int sda_io_num;
+   gpio_pullup_t sda_pullup_en;
+   int scl_io_num;
+   gpio_pullup_t scl_pullup_en;
+   struct { uint32_t clk_speed; } master;
+} i2c_config_t;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief One register transfer, as the device sees it
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct mockI2cTransfer
+{
+   uint8_t devAddr;
+   uint8_t regAddr;
+   std::vector<uint8_t> written;  // bytes after the register address
+   uint8_t *rdData;               // where bytes read after the repeated start go. NULL if there's no read
+   size_t rdLen;
+};
+
+typedef esp_err_t (*mockI2cDevice)(mockI2cTransfer &t);
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Mock driver state. Tests set device and look at log
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct mockI2cState
+{
+   std::mutex lock;                  // log is written by the bus thread and read by the test
+   mockI2cDevice device = NULL;
+   std::vector<mockI2cTransfer> log;
+   bool installed = false;
+   uint32_t clkSpeed = 0;
+
+   void clear()
+   {  std::lock_guard<std::mutex> hold(lock);
+      log.clear();
+   }
+
+   std::vector<mockI2cTransfer> transfers()
+   {  std::lock_guard<std::mutex> hold(lock);
+      return log;
+   }
+};
+static mockI2cState mockI2c;
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Command link: what was asked for, in order
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+enum mockI2cOp { mo_start, mo_writeByte, mo_write, mo_read, mo_stop };
+struct mockI2cCmd
+{
+   mockI2cOp op;
+   uint8_t byte;
+   uint8_t *data;
+   size_t len;
+};
+typedef std::vector<mockI2cCmd> *i2c_cmd_handle_t;
+
+inline esp_err_t i2c_param_config(i2c_port_t port, const i2c_config_t *conf)
+{  mockI2c.clkSpeed = conf->master.clk_speed;
+   return ESP_OK;
+}
+
+inline esp_err_t i2c_driver_install(i2c_port_t port, i2c_mode_t mode, size_t slvRxBuf, size_t slvTxBuf, int intrAllocFlags)
+{  if (mockI2c.installed) return ESP_FAIL;  // like the real one, only once per port
+   mockI2c.installed = true;
+   return ESP_OK;
+}
+
+inline i2c_cmd_handle_t i2c_cmd_link_create() { return new std::vector<mockI2cCmd>; }
+inline void i2c_cmd_link_delete(i2c_cmd_handle_t cmd) { delete cmd; }
+
+inline esp_err_t i2c_master_start(i2c_cmd_handle_t cmd)
+{  cmd->push_back({mo_start, 0, NULL, 0});
+   return ESP_OK;
+}
+
+inline esp_err_t i2c_master_write_byte(i2c_cmd_handle_t cmd, uint8_t data, bool ackEn)
+{  cmd->push_back({mo_writeByte, data, NULL, 0});
+   return ESP_OK;
+}
+
+inline esp_err_t i2c_master_write(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, bool ackEn)
+{  cmd->push_back({mo_write, 0, data, len});
+   return ESP_OK;
+}
+
+inline esp_err_t i2c_master_read(i2c_cmd_handle_t cmd, uint8_t *data, size_t len, i2c_ack_type_t ack)
+{  cmd->push_back({mo_read, 0, data, len});
+   return ESP_OK;
+}
+
+inline esp_err_t i2c_master_stop(i2c_cmd_handle_t cmd)
+{  cmd->push_back({mo_stop, 0, NULL, 0});
+   return ESP_OK;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Run a command link: START addr+W reg [data] [START addr+R read] STOP is all it understands
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+inline esp_err_t i2c_master_cmd_begin(i2c_port_t port, i2c_cmd_handle_t cmd, TickType_t ticks)
+{  if (!mockI2c.installed) return ESP_FAIL;
+   mockI2cTransfer t = {0, 0, {}, NULL, 0};
+   int starts = 0, bytes = 0;
+   for (const mockI2cCmd &c : *cmd)
+   {  switch (c.op)
+      {  case mo_start: starts++; bytes = 0; break;
+         case mo_writeByte:
+            if (bytes == 0) t.devAddr = c.byte >> 1;         // address, then on the first start, the register
+            else if (bytes == 1 && starts == 1) t.regAddr = c.byte;
+            else t.written.push_back(c.byte);
+            bytes++;
+            break;
+         case mo_write: t.written.insert(t.written.end(), c.data, c.data + c.len); bytes += c.len; break;
+         case mo_read: t.rdData = c.data; t.rdLen = c.len; break;
+         case mo_stop: break;
+      }
+   }
+   if (cmd->empty() || cmd->front().op != mo_start || cmd->back().op != mo_stop) return ESP_ERR_INVALID_ARG;
+   {  std::lock_guard<std::mutex> hold(mockI2c.lock);
+      mockI2c.log.push_back(t);
+   }
+   return mockI2c.device != NULL ? mockI2c.device(t) : ESP_FAIL;
+}
+
+#endif
@@ -0,0 +1,133 @@
+/*************************************************************************************************************************************
+ * @file FreeRTOS.h
+ * @author va3wam
+ * @brief Host stand in for the FreeRTOS queues and semaphores the headers in include/ use, on std::thread primitives
+ * @details Only what the host tests need: fixed length queues of fixed size items, binary semaphores and mutexes, with
+ *          timeouts in ticks of 1 mS. Nothing is ever deleted, which is fine for a test program that runs once and exits.
+ *          queue.h and semphr.h just include this file, as they'd include FreeRTOS.h on the robot.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#ifndef hostFreeRTOS_h
+#define hostFreeRTOS_h
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffff)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Waits on cv until ready() or ticks run out. portMAX_DELAY waits for ever
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+template <typename pred> bool hostWait(std::condition_variable &cv, std::unique_lock<std::mutex> &lock, TickType_t ticks, pred ready)
+{  if (ticks == portMAX_DELAY)
+   {  cv.wait(lock, ready);
+      return true;
+   }
+   return cv.wait_for(lock, std::chrono::milliseconds(ticks), ready);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Queue of fixed size items
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct hostQueue
+{
+   std::mutex lock;
+   std::condition_variable changed;
+   std::deque<std::vector<uint8_t>> items;
+   UBaseType_t length;
+   UBaseType_t itemSize;
+};
+typedef hostQueue *QueueHandle_t;
+
+inline QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{  QueueHandle_t q = new hostQueue;
+   q->length = length;
+   q->itemSize = itemSize;
+   return q;
+}
+
+inline BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{  std::unique_lock<std::mutex> lock(q->lock);
+   if (!hostWait(q->changed, lock, ticks, [q] { return q->items.size() < q->length; })) return pdFAIL;
+   const uint8_t *p = (const uint8_t *)item;
+   q->items.push_back(std::vector<uint8_t>(p, p + q->itemSize));
+   q->changed.notify_all();
+   return pdPASS;
+}
+
+inline BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{  std::unique_lock<std::mutex> lock(q->lock);
+   if (!hostWait(q->changed, lock, ticks, [q] { return !q->items.empty(); })) return pdFAIL;
+   memcpy(item, q->items.front().data(), q->itemSize);
+   q->items.pop_front();
+   q->changed.notify_all();
+   return pdPASS;
+}
+
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{  std::unique_lock<std::mutex> lock(q->lock);
+   return q->items.size();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Binary semaphore or mutex. A mutex starts out given, a binary semaphore taken
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct hostSemaphore
+{
+   std::mutex lock;
+   std::condition_variable changed;
+   bool given;
+};
+typedef hostSemaphore *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary()
+{  SemaphoreHandle_t s = new hostSemaphore;
+   s->given = false;
+   return s;
+}
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex()
+{  SemaphoreHandle_t s = new hostSemaphore;
+   s->given = true;
+   return s;
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{  std::unique_lock<std::mutex> lock(s->lock);
+   if (!hostWait(s->changed, lock, ticks, [s] { return s->given; })) return pdFALSE;
+   s->given = false;
+   return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{  std::unique_lock<std::mutex> lock(s->lock);
+   if (s->given) return pdFALSE;           // binary, so giving twice is the same as once
+   s->given = true;
+   s->changed.notify_all();
+   return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,2 @@
+// Host stand in for FreeRTOS's semphr.h. Everything's in FreeRTOS.h, see there
+#include "FreeRTOS.h"
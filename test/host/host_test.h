@@ -0,0 +1,76 @@
+/*************************************************************************************************************************************
+ * @file host_test.h
+ * @author va3wam
+ * @brief Checks and timing shared by the host tests in this folder
+ * @details Each test is its own small program. CHECK() and CHECK_NEAR() count failures and print where they happened,
+ *          and testsDone() prints a one line summary and gives main() its exit code, 0 if everything passed.
+ *          Benchmarks time with the host's cycle counter where there is one (x86 rdtsc), otherwise nanoseconds. Either
+ *          way the numbers are for comparing one way of doing something with another on the same machine. They aren't
+ *          ESP32 cycles.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#ifndef hostTest_h
+#define hostTest_h
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define CHECK(cond) \
+   do \
+   {  testChecks++; \
+      if (!(cond)) { testFailures++; printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); } \
+   } while (0)
+
+#define CHECK_NEAR(a, b, tol) \
+   do \
+   {  testChecks++; \
+      double checkA = (a), checkB = (b); \
+      if (!(fabs(checkA - checkB) <= (tol))) \
+      {  testFailures++; \
+         printf("FAIL %s:%d: %s = %g, %s = %g, more than %g apart\n", __FILE__, __LINE__, #a, checkA, #b, checkB, (double)(tol)); \
+      } \
+   } while (0)
+
+inline int testsDone(const char *name)
+{  printf("%s: %d checks, %d failed\n", name, testChecks, testFailures);
+   return testFailures == 0 ? 0 : 1;
+}
+
+// keeps the optimizer from throwing away work whose result a benchmark doesn't otherwise use
+static volatile double benchSink;
+
+inline uint64_t benchNow()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline const char *benchUnits()
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return "cycles";
+#else
+   return "nS";
+#endif
+}
+
+#endif
@@ -0,0 +1,24 @@
+#! /bin/sh
+# script run_tests.sh
+# builds and runs every host test in test/host, and says which ones failed
+# to run:
+#   open bash shell in TWIPe Projects directory
+#   type test/host/run_tests.sh
+# optional: CXX=clang++ test/host/run_tests.sh
+CXX=${CXX:-g++}
+out=${TMPDIR:-/tmp}/twipe-host-tests
+mkdir -p "$out"
+failed=""
+for src in test/host/test_*.cpp
+do
+	name=$(basename "$src" .cpp)
+	echo ">> $name"
+	if $CXX -std=gnu++11 -O2 -Wall -pthread -Iinclude -Itest/host -o "$out/$name" "$src" && "$out/$name"
+	then :
+	else failed="$failed $name"
+	fi
+done
+if [ -n "$failed" ]
+then echo ">> FAILED:$failed" ; exit 1
+else echo ">> all host tests passed"
+fi
@@ -0,0 +1,98 @@
+/*************************************************************************************************************************************
+ * @file step_gen_mock.h
+ * @author va3wam
+ * @brief Host mock stepGenerator backend (step_generator.h): no pins or timers, just the steps the wheels would have made
+ * @details advance() moves pretend time on, and each wheel makes steps at the rate its last setTicks() asked for, one every
+ *          |ticks| * stepTickUs microseconds, with the part of a step left over carried into the next advance(). With
+ *          setAccel() on, speed changes by at most that many steps per second per second, as the ISR backends' stepRamp does,
+          jumping straight to its startSpeed, sqrt(2 * accel), from a standstill. Time goes by in slices of rampSliceUs
+          while it's ramping, so one long advance() comes out the same as lots of short ones.
+ *          It also counts what it was asked to do, so a test can check what a caller told the motors.
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#ifndef stepGenMock_h
+#define stepGenMock_h
+
+#include <step_generator.h> // stepGenerator interface
+
+#define rampSliceUs 1000        // longest bit of pretend time worked out in one go while ramping
+
+class stepGenMock : public stepGenerator
+{
+public:
+   int ticks[2] = {0, 0};       // left, right, as last set
+   float accel = 0;             // as last set by setAccel()
+   double speed[2] = {0, 0};    // signed steps per second each wheel is making now
+   uint32_t setTicksCalls = 0;
+   uint32_t stopCalls = 0;
+   bool begun = false;
+
+   void begin() { begun = true; }
+
+   void setTicks(int leftTicks, int rightTicks)
+   {  ticks[0] = leftTicks;
+      ticks[1] = rightTicks;
+      setTicksCalls++;
+   }
+
+   void stop()
+   {  ticks[0] = ticks[1] = 0;
+      speed[0] = speed[1] = 0;  // now, no ramp down
+      stopCalls++;
+   }
+
+   const char *name() const { return "host mock"; }
+
+   void getSteps(int32_t &leftSteps, int32_t &rightSteps)
+   {  leftSteps = (int32_t)steps[0];
+      rightSteps = (int32_t)steps[1];
+   }
+
+   void setAccel(float stepsPerSec2) { accel = stepsPerSec2 > 0 ? stepsPerSec2 : 0; }
+
+   static double targetSpeed(int t) { return t == 0 ? 0 : 1000000.0 / ((double)t * stepTickUs); }
+
+   void advance(uint32_t us)    // pretend us microseconds go by
+   {  while (accel > 0 && us > rampSliceUs)
+      {  slice(rampSliceUs);
+         us -= rampSliceUs;
+      }
+      slice(us);
+   }
+
+private:
+   int64_t steps[2] = {0, 0};
+   double part[2] = {0, 0};     // part of a step made, carried over
+
+   void slice(uint32_t us)
+   {  for (int w = 0; w < 2; w++)
+      {  double target = targetSpeed(ticks[w]);
+         if (accel == 0) speed[w] = target;                    // no ramp, straight there
+         else
+         {  double start = sqrt(2.0 * accel);
+            if (fabs(speed[w]) < start)                        // slow enough to start, stop or turn round, as stepRamp::next()
+               speed[w] = fabs(target) < start ? target : (target > 0 ? start : -start);
+         }
+         double dv = target - speed[w];
+         double most = accel * us / 1000000.0;
+         if (dv > most) dv = most;
+         if (dv < -most) dv = -most;
+         double from = speed[w];
+         speed[w] += dv;
+         part[w] += (from + speed[w]) / 2 * us / 1000000.0;   // steps made, at the average speed over the time
+         double whole = part[w] < 0 ? ceil(part[w]) : floor(part[w]);
+         steps[w] += (int64_t)whole;
+         part[w] -= whole;
+      }
+   }
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*************************************************************************************************************************************
+ * @file test_balance_core.cpp
+ * @author va3wam
+ * @brief Host test that the Q16.16 balance core (balance_core.h) does what the float one does, and a benchmark of the two
+ * @details Both cores get the robot's settings as loadBalanceCore() sets them up, then the same recorded looking run: tilt
+ *          wandering round vertical, with a wobble and some noise, as DMP packets. The float core takes its tilt from the
+ *          Q14 quaternion with tiltFromQ14(), as readIMU()'s float path does, and the q16 core from the Q30 one with
+ *          tiltFromQ30(). Gyro rates go through rateFromGyro(). Every cycle:
+ *             tilt         has to agree to tiltTol degrees. The float path's Q14 quaternion only resolves about 0.007
+ *                          degrees, so that's most of it
+ *             pid          has to agree to pidTol. Bigger than the tilt difference times P, since I & D add a little each
+ *             motorTicks   has to be the float core's ticks for a whole |pid| within pidTol of its own, with the same sign
+ *          ticksTable is checked on its own too: the q16 ticksFromPid() is integer math, so it can round the other way.
+ *          Runs with and without a biquad low pass on the tilt, and with the D part from the gyro and from error slope.
+ *          The benchmark prints host cycles per cycle for each number type, for the tilt from the quaternion and for step().
+ *          A PC's FPU is much quicker than the ESP32's, whose float divides are done in software, so these only show where
+ *          the time goes on the host. They aren't ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_balance_core test/host/test_balance_core.cpp
+ *             ./test_balance_core
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <algorithm>
+#include <Arduino.h>
+#include <balance_core.h> // what's being tested
+#include "host_test.h"
+
+#define tiltTol 0.01             // degrees
+#define pidTol 0.5
+#define runCycles 5000           // one minute of 12 mS cycles
+#define benchRounds 20           // times round runCycles in the benchmark
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Settings, as the robot's defaults in main.cpp, plus the options being tried
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct coreSettings
+{
+   float pGain = 5, iGain = 5, dGain = 0;
+   int iCount = 17;
+   int tmrIMU = 12;
+   bool dFromGyro = true;
+   float dFilter = 0.5;
+   int slowTicks = 800, fastTicks = 300;
+   float distancePerTick = 3.1415926 * 3.937008 / 200;
+   bool tiltLowPass = false;
+};
+
+template <typename num> void loadCore(balanceCore<num> &c, const coreSettings &s)   // what loadBalanceCore() does
+{
+   balanceParams<num> p = {};
+   p.pGain = num(s.pGain);
+   p.iGain = num(s.iGain);
+   p.dGain = num(s.dGain);
+   p.iCount = s.iCount;
+   p.perMsec = num(1.0f / s.tmrIMU);
+   p.dFromGyro = s.dFromGyro;
+   p.dWeight = num(1.0f - s.dFilter);
+   p.sampleWeight = num(1.0f - s.dFilter);
+   p.targetAngle = num(0);
+   p.smoother = num(0);
+   p.slowTicks = s.slowTicks;
+   p.fastTicks = s.fastTicks;
+   p.distancePerTick = s.distancePerTick;
+   p.buildTicksTable();
+   if (s.tiltLowPass) p.tiltFilters.on[0] = biquadDesign(bq_lowPass, 15, 0.707f, 1000.0f / s.tmrIMU, p.tiltFilters.c[0]);
+   c.load(p);
+   c.resetErrHistory();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief One DMP packet's worth: quaternion both ways, and the gyro reading
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+struct packet
+{
+   int16_t q14[4];
+   int32_t q30[4];
+   int16_t gyroX;
+};
+
+packet run[runCycles];
+
+void makeRun(int tmrIMU)         // tilt wanders within +/-12 degrees, with a 3 Hz wobble and noise
+{
+   uint32_t noise = 12345;
+   double lastTilt = 0;
+   for (int n = 0; n < runCycles; n++)
+   {  double t = n * tmrIMU / 1000.0;
+      noise = noise * 1664525u + 1013904223u;                 // same noise every run
+      double tilt = 10 * sin(0.7 * t) * cos(0.13 * t) + 1.5 * sin(2 * PI * 3 * t) + ((noise >> 8) / 16777216.0 - 0.5) * 0.2;
+      double half = (tilt + 90) * DEG_TO_RAD / 2;             // roll about X, tilt = roll - 90
+      double q[4] = { cos(half), sin(half), 0, 0 };
+      for (int i = 0; i < 4; i++)
+      {  run[n].q14[i] = (int16_t)lround(q[i] * 16384);
+         run[n].q30[i] = (int32_t)llround(q[i] * 1073741823.0);
+      }
+      double rate = n > 0 ? (tilt - lastTilt) * 1000 / tmrIMU : 0;   // degrees per second
+      run[n].gyroX = (int16_t)lround(rate * gyroLsbPerDegSec);
+      lastTilt = tilt;
+   }
+}
+
+inline void feed(balanceCore<float> &c, const packet &p)   // readIMU()'s float path
+{  c.tilt = tiltFromQ14(p.q14, false);
+   rateFromGyro(c.tiltRate, p.gyroX);
+}
+
+inline void feed(balanceCore<q16> &c, const packet &p)     // and its fixed point one
+{  c.tilt = tiltFromQ30(p.q30);
+   rateFromGyro(c.tiltRate, p.gyroX);
+}
+
+balanceCore<float> coreF;
+balanceCore<q16> coreQ;
+
+/**
+ * @brief ticksTable built each way
+=================================================================================================== */
+void ticksTableTest()
+{
+   coreSettings s;
+   loadCore(coreF, s);
+   loadCore(coreQ, s);
+   int worst = 0;
+   for (int p = 0; p <= pidLimit; p++) worst = std::max(worst, abs(coreF.ticksTable[p] - coreQ.ticksTable[p]));
+   printf("ticksTable: worst difference %d ticks\n", worst);
+   CHECK(worst <= 1);
+   CHECK(coreQ.ticksTable[4] == 0 && coreQ.ticksTable[5] == s.slowTicks);
+   CHECK(coreQ.ticksTable[pidLimit] == s.fastTicks);
+} // ticksTableTest()
+
+/**
+ * @brief Both cores through the same run
+=================================================================================================== */
+void equivalenceTest(const char *name, const coreSettings &s)
+{
+   makeRun(s.tmrIMU);
+   loadCore(coreF, s);
+   loadCore(coreQ, s);
+   feed(coreF, run[0]);
+   feed(coreQ, run[0]);
+   coreF.resetErrHistory();                                   // filters start from the first tilt, as entering bs_active
+   coreQ.resetErrHistory();
+   double worstTilt = 0, worstPid = 0;
+   long badTicks = 0, moving = 0;
+   int lastF = 0, lastQ = 0;
+   for (int n = 0; n < runCycles; n++)
+   {  feed(coreF, run[n]);
+      feed(coreQ, run[n]);
+      lastF = coreF.step(lastF);
+      lastQ = coreQ.step(lastQ);
+      worstTilt = fmax(worstTilt, fabs(coreF.tilt - ctlToFloat(coreQ.tilt)));
+      float pidF = coreF.pid, pidQ = ctlToFloat(coreQ.pid);
+      worstPid = fmax(worstPid, fabs(pidF - pidQ));
+      if (lastF != 0) moving++;
+      bool ok = false;                                        // q16's ticks are the float table's, near enough in pid
+      float absPid = fabsf(pidF);
+      int lo = std::max(0, (int)floorf(absPid - pidTol)), hi = std::min(pidLimit, (int)ceilf(absPid + pidTol));
+      for (int p = lo; p <= hi && !ok; p++)
+         ok = abs(lastQ) == coreF.ticksTable[p] || abs(lastQ) == coreQ.ticksTable[p];
+      if (pidF < -pidTol) ok = ok && lastQ <= 0;
+      if (pidF > pidTol) ok = ok && lastQ >= 0;
+      if (!ok) badTicks++;
+   }
+   printf("%s: worst tilt difference %.5f degrees, worst pid difference %.4f, %ld of %d cycles moving, %ld ticks off\n",
+          name, worstTilt, worstPid, moving, runCycles, badTicks);
+   CHECK(worstTilt < tiltTol);
+   CHECK(worstPid < pidTol);
+   CHECK(moving > runCycles / 2);                             // the run really did drive the motors
+   CHECK(badTicks == 0);
+} // equivalenceTest()
+
+/**
+ * @brief Host cycles per step(), each number type
+=================================================================================================== */
+template <typename num> double benchCore(balanceCore<num> &c, const coreSettings &s)
+{
+   loadCore(c, s);
+   long sum = 0;
+   int last = 0;
+   uint64_t took = 0;
+   for (int r = 0; r < benchRounds; r++)
+      for (int n = 0; n < runCycles; n++)
+      {  feed(c, run[n]);                                     // tilt from the quaternion is timed too, as in readIMU()
+         uint64_t start = benchNow();
+         last = c.step(last);
+         took += benchNow() - start;
+         sum += last;
+      }
+   benchSink = sum;
+   return (double)took / ((double)benchRounds * runCycles);
+}
+
+template <typename num> double benchTilt()
+{
+   double sum = 0;
+   uint64_t start = benchNow();
+   balanceCore<num> c;
+   for (int r = 0; r < benchRounds; r++)
+      for (int n = 0; n < runCycles; n++)
+      {  feed(c, run[n]);
+         sum += ctlToFloat(c.tilt);
+      }
+   uint64_t took = benchNow() - start;
+   benchSink = sum;
+   return (double)took / ((double)benchRounds * runCycles);
+}
+
+void benchmark()
+{
+   coreSettings s;
+   s.tiltLowPass = true;
+   makeRun(s.tmrIMU);
+   printf("%s per cycle, float / q16: tilt from quaternion %.1f / %.1f, step() %.1f / %.1f\n", benchUnits(),
+          benchTilt<float>(), benchTilt<q16>(), benchCore(coreF, s), benchCore(coreQ, s));
+} // benchmark()
+
+int main()
+{
+   ticksTableTest();
+   coreSettings s;
+   equivalenceTest("defaults", s);
+   s.dGain = 2;
+   equivalenceTest("D from gyro", s);
+   s.dFromGyro = false;
+   equivalenceTest("D from error slope", s);
+   s.tiltLowPass = true;
+   s.iCount = 200;
+   equivalenceTest("tilt low pass, 200 errors", s);
+   benchmark();
+   return testsDone("test_balance_core");
+} // main()
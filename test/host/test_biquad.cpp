@@ -0,0 +1,219 @@
+/*************************************************************************************************************************************
+ * @file test_biquad.cpp
+ * @author va3wam
+ * @brief Host test and benchmark of biquad.h's filter bank, in float and q16
+ * @details The bank runs at sampleHz, balCore.step()'s rate with the default tmrIMU of 12 mS, with a lowPassHz Butterworth
+ *          low pass and a notchHz notch, the sort of thing loadBalanceCore() designs from the BALANCE.TILTBQ setvars. Tests:
+ *             rbjTest()     biquadDesign()'s coefficients against the Audio EQ Cookbook's formulas done in double, within
+ *                           coeffTol, and the designs it has to turn down: bq_off, unknown types, hz at or past Nyquist, hz
+ *                           or q not above 0
+ *             dcTest()      a steady input comes out the same once settled, within dcTol (float) or dcTolQ16 (q16)
+ *             notchTest()   a sine at notchHz comes out at least notchDb (float) or notchDbQ16 (q16) down once settled,
+ *                           and one at passHz comes out within passTol of what went in
+ *             primeTest()   after prime(x), x going in comes straight out at what a bank fed x from 0 for settleSteps
+ *                           settles to, within dcTol or dcTolQ16, with no kick on the way
+ *             switchTest()  turning the notch on mid-run, at the top of a passHz sine, doesn't kick the output: no step in
+ *                           the switchSteps after it is more than kickRatio times the biggest in the switchSteps before
+ *          The benchmark prints host cycles per step() with 0 to bqSections sections on, for each number type. They're for
+ *          comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_biquad test/host/test_biquad.cpp
+ *             ./test_biquad
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * @ref https://www.w3.org/TR/audio-eq-cookbook/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <balance_core.h> // q16, and biquad.h, which is what's being tested
+#include "host_test.h"
+
+#define sampleHz (1000.0f / 12)  // balCore.step() with the default tmrIMU
+#define lowPassHz 15.0f
+#define notchHz 6.0f
+#define notchQ 2.0f
+#define passHz 0.5f              // well clear of both
+#define coeffTol 0.00001
+#define dcTol 0.0001             // degrees, out of dcInput
+#define dcTolQ16 0.01
+#define dcInput 10.0f            // degrees
+#define notchDb 60.0             // at least this far down
+#define notchDbQ16 50.0
+#define passTol 0.05             // fraction of the amplitude
+#define settleSteps 5000         // 60 seconds at sampleHz, plenty for the notch to ring down
+#define switchSteps 50
+#define switchAt (settleSteps + 42)  // passHz's sine at its peak, where starting the notch from 0 would kick hardest
+#define kickRatio 2.0
+#define benchSteps 1000000       // step()s per sections on count
+#define benchRounds 5            // best of this many
+
+inline double toDouble(float v) { return v; }
+inline double toDouble(q16 v) { return ctlToFloat(v); }
+
+template <typename num> void design(biquadBank<num> &bank, bool lowPass, bool notch)   // one of each, sections 0 & 1
+{  biquadBankDesign d = {};
+   d.on[0] = lowPass && biquadDesign(bq_lowPass, lowPassHz, 0.707f, sampleHz, d.c[0]);
+   d.on[1] = notch && biquadDesign(bq_notch, notchHz, notchQ, sampleHz, d.c[1]);
+   bank.load(d);
+}
+
+/**
+ * @brief biquadDesign() against the cookbook, and the designs it should turn down
+=================================================================================================== */
+void rbjTest()
+{
+   static const float cases[][4] = { {bq_lowPass, 15, 0.707f, sampleHz}, {bq_lowPass, 2, 0.5f, 100}, {bq_lowPass, 40, 0.707f, 100},
+                                     {bq_notch, 6, 2, sampleHz}, {bq_notch, 20, 0.7f, 100}, {bq_notch, 1, 10, 100} };
+   double worst = 0;
+   for (const float *t : cases)
+   {  biquadCoeffs c = {};
+      CHECK(biquadDesign((int)t[0], t[1], t[2], t[3], c));
+      double w0 = 2 * M_PI * t[1] / t[3], alpha = sin(w0) / (2 * t[2]), a0 = 1 + alpha;
+      double b0 = (int)t[0] == bq_lowPass ? (1 - cos(w0)) / 2 : 1;
+      double b1 = (int)t[0] == bq_lowPass ? 1 - cos(w0) : -2 * cos(w0);
+      double expect[5] = { b0 / a0, b1 / a0, b0 / a0, -2 * cos(w0) / a0, (1 - alpha) / a0 };
+      double got[5] = { c.b0, c.b1, c.b2, c.a1, c.a2 };
+      for (int n = 0; n < 5; n++) worst = fmax(worst, fabs(got[n] - expect[n]));
+   }
+   printf("RBJ: worst coefficient difference %.8f over %d designs\n", worst, (int)(sizeof(cases) / sizeof(cases[0])));
+   CHECK(worst <= coeffTol);
+   biquadCoeffs c;
+   CHECK(!biquadDesign(bq_off, 15, 0.707f, 100, c));
+   CHECK(!biquadDesign(3, 15, 0.707f, 100, c));
+   CHECK(!biquadDesign(bq_lowPass, 50, 0.707f, 100, c));      // Nyquist
+   CHECK(!biquadDesign(bq_lowPass, 0, 0.707f, 100, c));
+   CHECK(!biquadDesign(bq_notch, 6, 0, 100, c));
+} // rbjTest()
+
+/**
+ * @brief A steady input comes out the same
+=================================================================================================== */
+template <typename num> void dcTest(const char *name, double tol)
+{
+   biquadBank<num> bank;
+   design(bank, true, true);
+   bank.prime(num(0));
+   num y;
+   for (int n = 0; n < settleSteps; n++) y = bank.step(num(dcInput));
+   printf("%s DC: %.1f in, %.6f out\n", name, dcInput, toDouble(y));
+   CHECK_NEAR(toDouble(y), dcInput, tol);
+} // dcTest()
+
+template <typename num> double sineOut(biquadBank<num> &bank, float hz, float amplitude)   // settled peak out
+{  bank.prime(num(0));
+   double peak = 0;
+   for (int n = 0; n < 2 * settleSteps; n++)
+   {  num y = bank.step(num(amplitude * sinf(2 * PI * hz * n / sampleHz)));
+      if (n >= settleSteps) peak = fmax(peak, fabs(toDouble(y)));
+   }
+   return peak;
+}
+
+/**
+ * @brief A sine at the notch goes, one well below it stays
+=================================================================================================== */
+template <typename num> void notchTest(const char *name, double db)
+{
+   biquadBank<num> bank;
+   design(bank, false, true);
+   double down = -20 * log10(sineOut(bank, notchHz, dcInput) / dcInput);
+   double pass = sineOut(bank, passHz, dcInput) / dcInput;
+   printf("%s notch: %.1f Hz %.1f dB down, %.1f Hz out %.4f of in\n", name, notchHz, down, passHz, pass);
+   CHECK(down >= db);
+   CHECK_NEAR(pass, 1, passTol);
+} // notchTest()
+
+/**
+ * @brief prime(x) starts the bank where feeding it x for ever would have got it
+=================================================================================================== */
+template <typename num> void primeTest(const char *name, double tol)
+{
+   biquadBank<num> settled, primed;
+   design(settled, true, true);
+   design(primed, true, true);
+   settled.prime(num(0));
+   num longRun;
+   for (int n = 0; n < settleSteps; n++) longRun = settled.step(num(dcInput));
+   primed.prime(num(dcInput));
+   double worst = 0;
+   for (int n = 0; n < switchSteps; n++) worst = fmax(worst, fabs(toDouble(primed.step(num(dcInput))) - toDouble(longRun)));
+   printf("%s prime: worst difference from settled %.6f over %d steps\n", name, worst, switchSteps);
+   CHECK(worst <= tol);
+} // primeTest()
+
+/**
+ * @brief Turning a section on mid-run doesn't kick the output
+=================================================================================================== */
+template <typename num> void switchTest(const char *name)
+{
+   biquadBank<num> bank;
+   design(bank, true, false);
+   bank.prime(num(0));
+   double before = 0, after = 0, last = 0;
+   for (int n = 0; n < switchAt + switchSteps; n++)
+   {  if (n == switchAt)
+      {  biquadCoeffs c;
+         biquadDesign(bq_notch, notchHz, notchQ, sampleHz, c);
+         bank.set(1, true, c);                                // notch on, from whatever's going into it now
+      }
+      double y = toDouble(bank.step(num(dcInput * sinf(2 * PI * passHz * n / sampleHz))));
+      if (n > switchAt - switchSteps && n < switchAt) before = fmax(before, fabs(y - last));
+      if (n >= switchAt) after = fmax(after, fabs(y - last));
+      last = y;
+   }
+   printf("%s switch on: biggest step %.4f before, %.4f after\n", name, before, after);
+   CHECK(after <= before * kickRatio);
+} // switchTest()
+
+/**
+ * @brief Host cycles per step() with 0 to bqSections sections on
+=================================================================================================== */
+float benchIn[4096];
+
+template <typename num> void benchmark(const char *name)
+{
+   printf("%s per step(), %s, by sections on:", benchUnits(), name);
+   for (int on = 0; on <= bqSections; on++)
+   {  biquadBankDesign d = {};
+      for (int n = 0; n < on; n++) d.on[n] = biquadDesign(n % 2 ? bq_notch : bq_lowPass, n % 2 ? notchHz : lowPassHz, 0.707f, sampleHz, d.c[n]);
+      biquadBank<num> bank;
+      bank.load(d);
+      bank.prime(num(0));
+      num in[4096];
+      for (int n = 0; n < 4096; n++) in[n] = num(benchIn[n]);
+      double best = 1e30;
+      for (int r = 0; r < benchRounds; r++)
+      {  num sum = num(0);
+         uint64_t start = benchNow();
+         for (int n = 0; n < benchSteps; n++) sum += bank.step(in[n % 4096]);
+         best = fmin(best, (double)(benchNow() - start) / benchSteps);
+         benchSink = toDouble(sum);
+      }
+      printf(" %d %.1f", on, best);
+   }
+   printf("\n");
+} // benchmark()
+
+int main()
+{
+   for (int n = 0; n < 4096; n++) benchIn[n] = 5 * sinf(n * 0.37f) + sinf(n * 2.1f);   // degrees, not round numbers
+   rbjTest();
+   dcTest<float>("float", dcTol);
+   dcTest<q16>("q16", dcTolQ16);
+   notchTest<float>("float", notchDb);
+   notchTest<q16>("q16", notchDbQ16);
+   primeTest<float>("float", dcTol);
+   primeTest<q16>("q16", dcTolQ16);
+   switchTest<float>("float");
+   switchTest<q16>("q16");
+   benchmark<float>("float");
+   benchmark<q16>("q16");
+   return testsDone("test_biquad");
+} // main()
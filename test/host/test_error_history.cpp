@@ -0,0 +1,176 @@
+/*************************************************************************************************************************************
+ * @file test_error_history.cpp
+ * @author va3wam
+ * @brief Host test and benchmark of balance_core.h's errHistory ring buffer, whose running sum gives the I part of PID
+ * @details Errors go into pushErrHistory() the way step() puts them there, and after every push errSum and errCount have to
+ *          be what adding up the last iCount errors by hand gives. Tests:
+ *             sumTest()    float and q16, iCount filling up from nothing, then lowered (the sum is rebuilt straight away)
+ *                          and raised again (the window fills up one error at a time). q16's sum has to be exact, float's
+ *                          within sumTol
+ *             driftTest()  float, for driftCycles pushes of errors that don't add up exactly. errResumCycles' rebuild of
+ *                          the sum has to keep it within driftTol of the real one the whole time. That's the sum of up to
+ *                          200 errors, so the I part, their average, is out by 200 times less
+ *          The benchmark prints host cycles per push for iCount 1 to errHistorySize, next to what the old way cost (re-add
+ *          iCount errors, then shuffle the array down by one, as balanceByAngle() used to), and checks that the ring
+ *          buffer's cost is flat: its dearest iCount can't be more than flatRatio times its cheapest. The old way's grows
+ *          with iCount. They're for comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_error_history test/host/test_error_history.cpp
+ *             ./test_error_history
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <balance_core.h> // what's being tested
+#include "host_test.h"
+
+#define sumTol 0.001             // degrees, float errSum against the real sum
+#define driftTol 0.01
+#define driftCycles 1000000      // about 3 1/2 hours of 12 mS cycles
+#define errPool 4096             // made up errors, used round and round
+#define benchPushes 1000000      // pushes per iCount in the benchmark
+#define benchRounds 5            // best of this many
+#define flatRatio 2.0            // dearest iCount's cost over the cheapest's, at most
+
+float errs[errPool];
+
+void makeErrs()                  // within +/-30 degrees, as bs_active allows, and not round numbers
+{  uint32_t noise = 12345;
+   for (int n = 0; n < errPool; n++)
+   {  noise = noise * 1664525u + 1013904223u;                 // same errors every run
+      errs[n] = ((noise >> 8) / 16777216.0f - 0.5f) * 60.0f;
+   }
+}
+
+inline double exact(float v) { return v; }
+inline double exact(q16 v) { return v.raw / 65536.0; }     // ctlToFloat() would round a big sum
+
+template <typename num> double realSum(balanceCore<num> &c, int count)   // the last count errors, added up by hand
+{  double sum = 0;
+   for (int t = 0; t < count; t++) sum += exact(c.errHistory[(c.errNewest - t + errHistorySize) % errHistorySize]);
+   return sum;
+}
+
+/**
+ * @brief errSum & errCount after every push, with iCount filling, lowered and raised
+=================================================================================================== */
+template <typename num> void sumTest(const char *name, double tol)
+{
+   static const int counts[][2] = { {17, 300}, {200, 500}, {5, 50}, {200, 300}, {1, 10}, {120, 400} };   // iCount, pushes
+   balanceCore<num> c;
+   c.tilt = c.tiltRate = num(0);
+   c.iCount = counts[0][0];
+   c.resetErrHistory();
+   int expectCount = 0, n = 0, badCount = 0;
+   double worst = 0;
+   for (const int *step : counts)
+   {  c.iCount = step[0];
+      for (int p = 0; p < step[1]; p++, n++)
+      {  c.pushErrHistory(num(errs[n % errPool]));
+         expectCount = expectCount + 1 > c.iCount ? c.iCount : expectCount + 1;   // one more, up to iCount
+         if (c.errCount != expectCount) badCount++;
+         worst = fmax(worst, fabs(exact(c.errSum) - realSum(c, expectCount)));
+      }
+   }
+   printf("%s: %d pushes, worst errSum difference %.6f, errCount wrong %d times\n", name, n, worst, badCount);
+   CHECK(badCount == 0);
+   CHECK(worst <= tol);
+} // sumTest()
+
+/**
+ * @brief Float rounding in errSum over a long run
+=================================================================================================== */
+void driftTest()
+{
+   balanceCore<float> c;
+   c.tilt = c.tiltRate = 0;
+   c.iCount = errHistorySize;
+   c.resetErrHistory();
+   double worst = 0;
+   for (int n = 0; n < driftCycles; n++)
+   {  c.pushErrHistory(errs[n % errPool] + 0.001f * (n % 7));   // so the window's never the same twice
+      if (n % 97 == 0 || n == driftCycles - 1) worst = fmax(worst, fabs(c.errSum - realSum(c, c.errCount)));
+   }
+   printf("drift: worst errSum difference %.6f over %d pushes\n", worst, driftCycles);
+   CHECK(worst <= driftTol);
+} // driftTest()
+
+/**
+ * @brief Host cycles per push at each iCount, ring buffer and the old way
+=================================================================================================== */
+float oldHistory[errHistorySize + 1];
+
+float oldPush(float err, int iCount, int &dataCount)   // balanceByAngle()'s I part, before the ring buffer
+{  oldHistory[0] = err;
+   if (dataCount < iCount) dataCount++;
+   float sum = 0;
+   for (int t = 1; t <= dataCount; t++) sum += oldHistory[t - 1];
+   for (int t = iCount; t >= 1; t--) oldHistory[t] = oldHistory[t - 1];
+   return sum / dataCount;
+}
+
+double benchRing(int iCount)
+{
+   static balanceCore<float> c;
+   c.iCount = iCount;
+   c.resetErrHistory();
+   double best = 1e30;
+   for (int r = 0; r < benchRounds; r++)
+   {  float sum = 0;
+      uint64_t start = benchNow();
+      for (int n = 0; n < benchPushes; n++)
+      {  c.pushErrHistory(errs[n % errPool]);
+         sum += c.errSum / c.errCount;
+      }
+      best = fmin(best, (double)(benchNow() - start) / benchPushes);
+      benchSink = sum;
+   }
+   return best;
+}
+
+double benchOld(int iCount)
+{
+   double best = 1e30;
+   for (int r = 0; r < benchRounds; r++)
+   {  float sum = 0;
+      int dataCount = 0;
+      uint64_t start = benchNow();
+      for (int n = 0; n < benchPushes; n++) sum += oldPush(errs[n % errPool], iCount, dataCount);
+      best = fmin(best, (double)(benchNow() - start) / benchPushes);
+      benchSink = sum;
+   }
+   return best;
+}
+
+void benchmark()
+{
+   static const int counts[] = { 1, 2, 5, 17, 50, 100, 200 };
+   double cheapest = 1e30, dearest = 0;
+   printf("%s per push, ring buffer / old way:", benchUnits());
+   for (int iCount : counts)
+   {  double ring = benchRing(iCount);
+      printf(" iCount %d %.1f / %.1f,", iCount, ring, benchOld(iCount));
+      cheapest = fmin(cheapest, ring);
+      dearest = fmax(dearest, ring);
+   }
+   printf(" ring buffer dearest / cheapest %.2f\n", dearest / cheapest);
+   CHECK(dearest <= cheapest * flatRatio);
+} // benchmark()
+
+int main()
+{
+   makeErrs();
+   sumTest<float>("float", sumTol);
+   sumTest<q16>("q16", 0);
+   driftTest();
+   benchmark();
+   return testsDone("test_error_history");
+} // main()
@@ -0,0 +1,196 @@
+/*************************************************************************************************************************************
+ * @file test_gain_schedule.cpp
+ * @author va3wam
+ * @brief Host test and benchmark of gain_schedule.h: checking a gain table blob from MQTT, and looking up gains in it
+ * @details Tests:
+ *             blobTest()    a good blob unpacks to the table it was made from. Then one thing at a time is wrong with it, and
+ *                           gainTableFromBlob() has to say so: length one short or one long, magic, version, the header's
+ *                           padding byte, NaN or infinity in an axis or a gain, and each axis flat or going backwards
+ *             lookupTest()  float and q16. The table's gains are a plane in tilt and speed, which bilinear interpolation
+ *                           gets exactly, so lookup() anywhere inside the grid has to match the plane within lookupTol
+ *                           (float) or lookupTolQ16 (q16). Outside it, on either side of either axis, it has to match the
+ *                           plane at the nearest edge. q16 is looser because load()'s 1 / spacing only has 16 fraction
+ *                           bits, which a wide speed cell notices
+ *          The benchmark prints host cycles per lookup() for each number type, over tilts and speeds all across and past the
+ *          grid. They're for comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_gain_schedule test/host/test_gain_schedule.cpp
+ *             ./test_gain_schedule
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <gain_schedule.h> // what's being tested
+#include <string.h>
+#include "host_test.h"
+
+#define lookupTol 0.0001         // gain units
+#define lookupTolQ16 0.15        // q16's 1 / 1200 steps/second is 54 / 65536, 1.2% low, across a cell where D changes by 12
+#define benchCount 4096          // tilt & speed pairs in the benchmark
+#define benchRounds 200          // times round them
+
+static const float tilts[gsTilts] = { 1, 3, 8, 15 };            // degrees
+static const float speeds[gsSpeeds] = { 0, 200, 800, 2000 };    // steps/second
+static const float plane[gsGains][3] = { {20, 1.5f, 0.004f}, {0.5f, 0.05f, 0.0001f}, {60, -2, 0.01f} };   // gain = a + b tilt + c speed
+
+float planeGain(int g, float tilt, float speed) { return plane[g][0] + plane[g][1] * tilt + plane[g][2] * speed; }
+
+void makeTable(gainTable &t)
+{  for (int a = 0; a < gsTilts; a++) t.tilt[a] = tilts[a];
+   for (int b = 0; b < gsSpeeds; b++) t.speed[b] = speeds[b];
+   for (int g = 0; g < gsGains; g++)
+      for (int a = 0; a < gsTilts; a++)
+         for (int b = 0; b < gsSpeeds; b++) t.gain[g][a][b] = planeGain(g, tilts[a], speeds[b]);
+}
+
+uint8_t blob[4 + sizeof(gainTable) + 1];     // one spare, for the too long test
+
+void makeBlob(const gainTable &t)             // as the tuning tools send it
+{  blob[0] = gsMagic0;
+   blob[1] = gsMagic1;
+   blob[2] = gsVersion;
+   blob[3] = 0;
+   memcpy(blob + 4, &t, sizeof(gainTable));
+}
+
+bool says(const char *problem, const char *expect)   // gainTableFromBlob() gave this problem
+{  if (problem != NULL && strcmp(problem, expect) == 0) return true;
+   printf("expected \"%s\", got \"%s\"\n", expect, problem == NULL ? "NULL" : problem);
+   return false;
+}
+
+/**
+ * @brief A good blob unpacks, and each kind of bad one is turned down for the right reason
+=================================================================================================== */
+void blobTest()
+{
+   gainTable good, out;
+   makeTable(good);
+   makeBlob(good);
+   CHECK(gainTableFromBlob(blob, 4 + sizeof(gainTable), out) == NULL);
+   CHECK(memcmp(&good, &out, sizeof(gainTable)) == 0);
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable) - 1, out), "wrong length"));
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable) + 1, out), "wrong length"));
+   CHECK(says(gainTableFromBlob(blob, 0, out), "wrong length"));
+   blob[1] = 'X';
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "not a gain table"));
+   makeBlob(good);
+   blob[2] = gsVersion + 1;
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "wrong version"));
+   blob[2] = 0;
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "wrong version"));
+   makeBlob(good);
+   blob[3] = 1;
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "bad header padding"));
+
+   gainTable bad;
+   float *badNumbers[] = { &bad.tilt[0], &bad.speed[gsSpeeds - 1], &bad.gain[gsP][0][0], &bad.gain[gsD][gsTilts - 1][gsSpeeds - 1] };
+   for (float *f : badNumbers)
+   {  bad = good;
+      *f = NAN;
+      makeBlob(bad);
+      CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "bad number"));
+      *f = -INFINITY;
+      makeBlob(bad);
+      CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "bad number"));
+   }
+   bad = good;
+   bad.tilt[2] = bad.tilt[1];                                  // flat
+   makeBlob(bad);
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "tilt axis not increasing"));
+   bad.tilt[2] = bad.tilt[1] - 1;                              // backwards
+   makeBlob(bad);
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "tilt axis not increasing"));
+   bad = good;
+   bad.speed[gsSpeeds - 1] = bad.speed[gsSpeeds - 2];
+   makeBlob(bad);
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "speed axis not increasing"));
+   bad.speed[1] = -1;                                          // backwards from speed[0]
+   makeBlob(bad);
+   CHECK(says(gainTableFromBlob(blob, 4 + sizeof(gainTable), out), "speed axis not increasing"));
+   printf("blob: good one unpacked, bad ones turned down\n");
+} // blobTest()
+
+inline double toDouble(float v) { return v; }
+inline double toDouble(q16 v) { return ctlToFloat(v); }
+
+/**
+ * @brief Gains inside the grid are the plane, gains outside it are the plane at the nearest edge
+=================================================================================================== */
+template <typename num> void lookupTest(const char *name, double tol)
+{
+   gainTable t;
+   makeTable(t);
+   gainSchedule<num> sched;
+   sched.load(t);
+   CHECK(sched.loaded);
+   double worstIn = 0, worstOut = 0;
+   for (float tilt = -2; tilt <= 20; tilt += 0.25f)            // past both ends of both axes
+      for (float speed = -100; speed <= 2500; speed += 12.5f)
+      {  num p, i, d;
+         sched.lookup(num(tilt), num(speed), p, i, d);
+         float ct = constrain(tilt, tilts[0], tilts[gsTilts - 1]);
+         float cs = constrain(speed, speeds[0], speeds[gsSpeeds - 1]);
+         double got[gsGains] = { toDouble(p), toDouble(i), toDouble(d) };
+         bool inside = ct == tilt && cs == speed;
+         for (int g = 0; g < gsGains; g++)
+         {  double err = fabs(got[g] - planeGain(g, ct, cs));
+            if (inside) worstIn = fmax(worstIn, err);
+            else worstOut = fmax(worstOut, err);
+         }
+      }
+   printf("%s lookup: worst difference from the plane %.6f inside the grid, %.6f outside\n", name, worstIn, worstOut);
+   CHECK(worstIn <= tol);
+   CHECK(worstOut <= tol);
+} // lookupTest()
+
+/**
+ * @brief Host cycles per lookup()
+=================================================================================================== */
+template <typename num> double benchLookup()
+{
+   static num benchTilt[benchCount], benchSpeed[benchCount];
+   gainTable t;
+   makeTable(t);
+   gainSchedule<num> sched;
+   sched.load(t);
+   for (int n = 0; n < benchCount; n++)
+   {  benchTilt[n] = num(20.0f * n / benchCount);
+      benchSpeed[n] = num(2500.0f * ((n * 37) % benchCount) / benchCount);
+   }
+   num sum = num(0);
+   uint64_t start = benchNow();
+   for (int r = 0; r < benchRounds; r++)
+      for (int n = 0; n < benchCount; n++)
+      {  num p, i, d;
+         sched.lookup(benchTilt[n], benchSpeed[n], p, i, d);
+         sum += p + i + d;
+      }
+   uint64_t took = benchNow() - start;
+   benchSink = toDouble(sum);
+   return (double)took / ((double)benchRounds * benchCount);
+}
+
+void benchmark()
+{
+   double f = benchLookup<float>();
+   double q = benchLookup<q16>();
+   printf("%s per lookup: float %.1f, q16 %.1f\n", benchUnits(), f, q);
+} // benchmark()
+
+int main()
+{
+   blobTest();
+   lookupTest<float>("float", lookupTol);
+   lookupTest<q16>("q16", lookupTolQ16);
+   benchmark();
+   return testsDone("test_gain_schedule");
+} // main()
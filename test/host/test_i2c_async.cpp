@@ -0,0 +1,297 @@
+/*************************************************************************************************************************************
+ * @file test_i2c_async.cpp
+ * @author va3wam
+ * @brief Host test of the asynchronous I2C engine (i2c_async.h) on a mock bus, with a pretend MPU6050 FIFO on the other end
+ * @details The ESP-IDF driver is test/host/driver/i2c.h, which hands each transfer to fakeImu() below, and the FreeRTOS
+ *          queue and semaphores are test/host/freertos. Tests:
+ *             chainTest()     FIFO count, then FIFO data chained on from the count's callback, the way main.cpp's
+ *                             fifoCountRead() does it. The data read has to go on the bus straight after the count, ahead of
+ *                             a transaction queued behind it, and done is only given once, after both
+ *             noPacketTest()  count says there's no whole packet, so nothing is chained on
+ *             countFailTest() count is NACKed, so there's no data read, and the failure's counted
+ *             dataFailTest()  data read times out after a good count
+ *             queueFullTest() submit() when the queue's full fails straight away, and the transaction says so
+ *             syncTest()      readRegs() and writeRegs() from one thread, with a bus task thread calling run()
+ *             waitTest()      wait() times out on a transaction that never went on the bus
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -pthread -Iinclude -Itest/host -o test_i2c_async test/host/test_i2c_async.cpp
+ *             ./test_i2c_async
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <atomic>
+#include <thread>
+#include <i2c_async.h> // what's being tested
+#include "host_test.h"
+
+#define imuAddr 0x68
+#define raCountH 0x72            // MPU6050_RA_FIFO_COUNTH
+#define raFifo 0x74              // MPU6050_RA_FIFO_R_W
+#define raOther 0x3b             // anything else
+#define testPacketSize 28
+#define testBurstMax 112         // MPU6050_FIFO_BURST_MAX
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Pretend IMU. FIFO bytes are numbered, so a read shows exactly which ones it got
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint16_t imuFifoCount = 0;       // bytes waiting
+uint8_t imuFifoNext = 0;         // number of the oldest one
+uint8_t imuRegs[256];            // every other register
+int imuFailReg = -1;             // transfers to this register fail with imuFailErr
+esp_err_t imuFailErr = ESP_FAIL;
+
+esp_err_t fakeImu(mockI2cTransfer &t)
+{
+   if (t.devAddr != imuAddr) return ESP_FAIL;                 // nobody there
+   if (t.regAddr == imuFailReg) return imuFailErr;
+   for (size_t i = 0; i < t.written.size(); i++) imuRegs[(uint8_t)(t.regAddr + i)] = t.written[i];
+   for (size_t i = 0; i < t.rdLen; i++)
+   {  if (t.regAddr == raCountH) t.rdData[i] = i == 0 ? imuFifoCount >> 8 : i == 1 ? imuFifoCount & 0xff : 0;
+      else if (t.regAddr == raFifo)
+      {  t.rdData[i] = imuFifoNext++;
+         if (imuFifoCount > 0) imuFifoCount--;
+      }
+      else t.rdData[i] = imuRegs[(uint8_t)(t.regAddr + i)];
+   }
+   return ESP_OK;
+}
+
+void resetImu(uint16_t count)
+{  imuFifoCount = count;
+   imuFifoNext = 0;
+   imuFailReg = -1;
+   mockI2c.clear();
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// @brief Count then data callbacks, as main.cpp's fifoCountRead() and fifoDataRead()
+/////////////////////////////////////////////////////////////////////////////////////////////////////////////
+uint8_t txnCount[2];
+uint8_t txnBurst[testBurstMax];
+int txnPlan = 0;                 // 1 = txnBurst has whole packets
+int dataCalls = 0;
+
+bool dataRead(i2cTxn &t)
+{  dataCalls++;
+   if (t.status != it_done) txnPlan = 0;
+   return false;
+}
+
+bool countRead(i2cTxn &t)
+{  txnPlan = 0;
+   if (t.status == it_done)
+   {  uint16_t count = ((uint16_t)txnCount[0] << 8) | txnCount[1];
+      uint16_t whole = count / testPacketSize * testPacketSize;
+      if (whole > 0 && whole <= testBurstMax)
+      {  txnPlan = 1;
+         t.regAddr = raFifo;
+         t.rdData = txnBurst;
+         t.rdLen = whole;
+         t.complete = dataRead;
+      }
+   }
+   return txnPlan == 1;
+}
+
+void setupCountTxn(i2cTxn &t)
+{  t.devAddr = imuAddr;
+   t.regAddr = raCountH;
+   t.rdData = txnCount;
+   t.rdLen = sizeof(txnCount);
+   t.complete = countRead;
+   dataCalls = 0;
+}
+
+i2cAsync bus;
+i2cTxn fifoTxn;
+
+/**
+ * @brief Count, then the data chained on, ahead of the next transaction in the queue
+=================================================================================================== */
+void chainTest()
+{
+   resetImu(2 * testPacketSize + 5);                 // two whole packets and the start of a third
+   setupCountTxn(fifoTxn);
+   uint8_t other[3];
+   i2cTxn otherTxn;
+   otherTxn.devAddr = imuAddr;
+   otherTxn.regAddr = raOther;
+   otherTxn.rdData = other;
+   otherTxn.rdLen = sizeof(other);
+   otherTxn.done = xSemaphoreCreateBinary();
+   uint32_t transactions = bus.transactions, failures = bus.failures;
+   CHECK(bus.submit(fifoTxn));
+   CHECK(bus.submit(otherTxn));
+   CHECK(fifoTxn.status == it_queued);
+   CHECK(!bus.wait(fifoTxn, 0));                     // nothing's run yet
+   bus.run();                                        // count, then data, in one go
+   CHECK(fifoTxn.status == it_done);
+   CHECK(otherTxn.status == it_queued);              // still waiting its turn
+   CHECK(bus.wait(fifoTxn, 0));
+   CHECK(!bus.wait(fifoTxn, 0));                     // given once, not once per transfer
+   bus.run();
+   CHECK(bus.wait(otherTxn, 0));
+   CHECK(otherTxn.status == it_done);
+   std::vector<mockI2cTransfer> log = mockI2c.transfers();
+   CHECK(log.size() == 3);
+   if (log.size() == 3)
+   {  CHECK(log[0].regAddr == raCountH && log[0].rdLen == 2);
+      CHECK(log[1].regAddr == raFifo && log[1].rdLen == 2 * testPacketSize);   // whole packets only
+      CHECK(log[2].regAddr == raOther && log[2].rdLen == 3);
+   }
+   CHECK(txnPlan == 1 && dataCalls == 1);
+   CHECK(txnBurst[0] == 0 && txnBurst[2 * testPacketSize - 1] == 2 * testPacketSize - 1);
+   CHECK(imuFifoCount == 5);                         // partial packet left for next time
+   CHECK(bus.transactions - transactions == 3);
+   CHECK(bus.failures == failures);
+} // chainTest()
+
+/**
+ * @brief Not a whole packet waiting, so no data read
+=================================================================================================== */
+void noPacketTest()
+{
+   resetImu(testPacketSize - 1);
+   setupCountTxn(fifoTxn);
+   uint32_t transactions = bus.transactions;
+   CHECK(bus.submit(fifoTxn));
+   bus.run();
+   CHECK(bus.wait(fifoTxn, 0));
+   CHECK(fifoTxn.status == it_done);
+   CHECK(txnPlan == 0 && dataCalls == 0);
+   CHECK(mockI2c.transfers().size() == 1);
+   CHECK(bus.transactions - transactions == 1);
+} // noPacketTest()
+
+/**
+ * @brief Count NACKed
+=================================================================================================== */
+void countFailTest()
+{
+   resetImu(testPacketSize);
+   imuFailReg = raCountH;
+   imuFailErr = ESP_FAIL;
+   setupCountTxn(fifoTxn);
+   uint32_t failures = bus.failures;
+   CHECK(bus.submit(fifoTxn));
+   bus.run();
+   CHECK(bus.wait(fifoTxn, 0));                      // caller still hears it's over
+   CHECK(fifoTxn.status == it_failed);
+   CHECK(fifoTxn.err == ESP_FAIL);
+   CHECK(txnPlan == 0 && dataCalls == 0);
+   CHECK(mockI2c.transfers().size() == 1);           // no data read after a bad count
+   CHECK(bus.failures - failures == 1);
+   CHECK(imuFifoCount == testPacketSize);
+} // countFailTest()
+
+/**
+ * @brief Good count, data read times out
+=================================================================================================== */
+void dataFailTest()
+{
+   resetImu(testPacketSize);
+   imuFailReg = raFifo;
+   imuFailErr = ESP_ERR_TIMEOUT;
+   setupCountTxn(fifoTxn);
+   uint32_t transactions = bus.transactions, failures = bus.failures;
+   CHECK(bus.submit(fifoTxn));
+   bus.run();
+   CHECK(bus.wait(fifoTxn, 0));
+   CHECK(fifoTxn.status == it_failed);
+   CHECK(fifoTxn.err == ESP_ERR_TIMEOUT);
+   CHECK(txnPlan == 0 && dataCalls == 1);            // data callback saw it and dropped the plan
+   CHECK(mockI2c.transfers().size() == 2);
+   CHECK(bus.transactions - transactions == 2);
+   CHECK(bus.failures - failures == 1);
+} // dataFailTest()
+
+/**
+ * @brief More submitted than the queue holds
+=================================================================================================== */
+void queueFullTest()
+{
+   resetImu(0);
+   i2cTxn txn[i2cQueueLength + 1];
+   uint8_t data[i2cQueueLength + 1];
+   uint32_t failures = bus.failures;
+   for (int i = 0; i < i2cQueueLength; i++)
+   {  txn[i].devAddr = imuAddr;
+      txn[i].regAddr = raOther;
+      txn[i].rdData = &data[i];
+      txn[i].rdLen = 1;
+      CHECK(bus.submit(txn[i]));
+   }
+   txn[i2cQueueLength].devAddr = imuAddr;
+   CHECK(!bus.submit(txn[i2cQueueLength]));          // doesn't wait for room
+   CHECK(txn[i2cQueueLength].status == it_failed);
+   CHECK(bus.failures - failures == 1);
+   for (int i = 0; i < i2cQueueLength; i++) bus.run();   // empty it for the next test
+   for (int i = 0; i < i2cQueueLength; i++) CHECK(txn[i].status == it_done);
+   CHECK(mockI2c.transfers().size() == i2cQueueLength);
+} // queueFullTest()
+
+/**
+ * @brief readRegs() and writeRegs() with run() in its own thread, as i2cBusTask
+=================================================================================================== */
+std::atomic<bool> busStop(false);
+bool stopBus(i2cTxn &t) { busStop = true; return false; }
+
+void syncTest()
+{
+   resetImu(0);
+   busStop = false;
+   std::thread busTask([] { while (!busStop) bus.run(); });
+   uint8_t wr[4] = {1, 2, 3, 4}, rd[4] = {0, 0, 0, 0};
+   CHECK(bus.writeRegs(imuAddr, 0x10, sizeof(wr), wr));
+   CHECK(bus.readRegs(imuAddr, 0x10, sizeof(rd), rd) == (int8_t)sizeof(rd));
+   CHECK(memcmp(wr, rd, sizeof(wr)) == 0);
+   CHECK(bus.readRegs(imuAddr + 1, 0x10, sizeof(rd), rd) == -1);   // nobody at that address
+   CHECK(!bus.writeRegs(imuAddr + 1, 0x10, sizeof(wr), wr));
+   imuFailReg = 0x20;
+   imuFailErr = ESP_ERR_TIMEOUT;
+   CHECK(bus.readRegs(imuAddr, 0x20, 1, rd) == -1);
+   CHECK(bus.readRegs(imuAddr, 0x10, 1, rd) == 1);                 // and it's fine again after
+   i2cTxn stop;
+   stop.devAddr = imuAddr;
+   stop.complete = stopBus;
+   CHECK(bus.submit(stop));
+   busTask.join();
+   CHECK(mockI2c.transfers().size() == 7);
+} // syncTest()
+
+/**
+ * @brief wait() on something that never ran
+=================================================================================================== */
+void waitTest()
+{
+   i2cTxn t;
+   CHECK(!bus.wait(t, 0));                           // no done semaphore
+   t.done = xSemaphoreCreateBinary();
+   unsigned long start = millis();
+   CHECK(!bus.wait(t, pdMS_TO_TICKS(20)));
+   CHECK(millis() - start >= 19);
+} // waitTest()
+
+int main()
+{
+   mockI2c.device = fakeImu;
+   CHECK(bus.begin(I2C_NUM_0, 21, 22, 400000));
+   CHECK(mockI2c.clkSpeed == 400000);
+   fifoTxn.done = xSemaphoreCreateBinary();
+   chainTest();
+   noPacketTest();
+   countFailTest();
+   dataFailTest();
+   queueFullTest();
+   syncTest();
+   waitTest();
+   return testsDone("test_i2c_async");
+} // main()
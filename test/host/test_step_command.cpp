@@ -0,0 +1,163 @@
+/*************************************************************************************************************************************
+ * @file test_step_command.cpp
+ * @author va3wam
+ * @brief Host test that commandBlock (step_command.h) never hands a reader a torn command
+ * @details Every word of a test command is worked out from one number, so a command stitched together from two publishes
+ *          can't pass for a real one. Two tests:
+ *             tearTest() makes the worst case happen on purpose. The command's copy assignment publishes twice more half way
+ *                        through the reader's copy, so the slot being read is overwritten under it. fetch() has to say
+ *                        false, and leave the caller's command alone
+ *             raceTest() has a writer thread publish as fast as it can for raceMs while the reader fetches in a loop, as the
+ *                        ISR does. Every command fetch() returns true for has to be whole, and newer than the last one, and
+ *                        a false has to leave the caller's command alone. Fetches thrown away as possibly torn are counted,
+ *                        to show the race was really run. On a single core host there'll be few of them
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -pthread -Iinclude -Itest/host -o test_step_command test/host/test_step_command.cpp
+ *             ./test_step_command
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <atomic>
+#include <thread>
+#include <step_command.h> // what's being tested
+#include "host_test.h"
+
+#define raceMs 500               // how long the writer and reader race
+#define cmdWords 16              // wider than the real commands, so the reader's copy takes long enough to get torn
+
+struct testCmd;
+void (*midCopy)() = NULL;        // if set, called once half way through copying a testCmd, then cleared
+
+struct testCmd
+{
+   uint32_t word[cmdWords];
+   testCmd() {}
+   testCmd(const testCmd &o) { copyFrom(o); }
+   testCmd &operator=(const testCmd &o) { copyFrom(o); return *this; }
+   void copyFrom(const testCmd &o)        // a word at a time, like an ISR copying a struct
+   {  for (int i = 0; i < cmdWords; i++)
+      {  if (i == cmdWords / 2 && midCopy != NULL)
+         {  void (*f)() = midCopy;
+            midCopy = NULL;             // publish() copies too, so don't go round again
+            f();
+         }
+         word[i] = ((volatile const uint32_t *)o.word)[i];
+      }
+   }
+};
+
+testCmd makeCmd(uint32_t n)
+{  testCmd c;
+   for (int i = 0; i < cmdWords; i++) c.word[i] = n * 2654435761u + i;   // each word different, all from n
+   return c;
+}
+
+bool isWhole(const testCmd &c, uint32_t &n)   // true if c is exactly makeCmd(n) for some n, which is returned
+{  n = (c.word[0]) * 244002641u;                // 244002641 is 2654435761's inverse, mod 2^32
+   testCmd expect = makeCmd(n);
+   return memcmp(&c, &expect, sizeof(c)) == 0;
+}
+
+commandBlock<testCmd> tearBlock;
+
+void publishTwice()
+{  tearBlock.publish(makeCmd(2));            // goes in the other slot
+   tearBlock.publish(makeCmd(3));            // goes in the slot the reader is half way through
+}
+
+/**
+ * @brief Writer publishes twice in the middle of the reader's copy
+=================================================================================================== */
+void tearTest()
+{
+   uint32_t seen = 0, n;
+   testCmd c = makeCmd(99);
+   tearBlock.publish(makeCmd(1));
+   midCopy = publishTwice;
+   CHECK(!tearBlock.fetch(c, seen));         // copy was torn, so it's thrown away
+   CHECK(midCopy == NULL);                   // and it really was interrupted
+   CHECK(isWhole(c, n) && n == 99);          // caller's command untouched
+   CHECK(seen == 0);
+   CHECK(tearBlock.fetch(c, seen));          // next time round it gets the newest, whole
+   CHECK(isWhole(c, n) && n == 3);
+} // tearTest()
+
+/**
+ * @brief Writer and reader racing on one commandBlock
+=================================================================================================== */
+void raceTest()
+{
+   commandBlock<testCmd> block;
+   std::atomic<bool> writing(true);
+   std::atomic<uint32_t> published(0);
+   std::thread writer([&]
+   {  uint32_t n = 0;
+      unsigned long start = millis();
+      while (millis() - start < raceMs) block.publish(makeCmd(++n));
+      published = n;
+      writing = false;
+   });
+   testCmd c = makeCmd(0);
+   uint32_t seen = 0, last = 0, n;
+   long fetched = 0, rejected = 0, torn = 0, backwards = 0, touched = 0;
+   bool more = true;
+   while (more)
+   {  more = writing;                        // one last fetch after the writer's done, to pick up its last command
+      testCmd before = c;
+      uint32_t seq = block.seq;
+      if (block.fetch(c, seen))
+      {  fetched++;
+         if (!isWhole(c, n)) torn++;
+         else if (n <= last && last != 0) backwards++;
+         else last = n;
+      }
+      else
+      {  if (seq != seen) rejected++;        // there was something new, but it was thrown away
+         if (memcmp(&before, &c, sizeof(c)) != 0) touched++;
+      }
+   }
+   writer.join();
+   printf("race: %ld fetched, %ld thrown away as possibly torn, last command %u of %u\n",
+          fetched, rejected, last, (uint32_t)published);
+   CHECK(torn == 0);
+   CHECK(backwards == 0);
+   CHECK(touched == 0);
+   CHECK(fetched > 0);
+   CHECK(last == published);                 // the final command always gets through
+} // raceTest()
+
+/**
+ * @brief Single threaded behaviour: nothing new, one new command, and skipping ahead
+=================================================================================================== */
+void basicTest()
+{
+   commandBlock<testCmd> block;
+   testCmd c = makeCmd(99);
+   uint32_t seen = 0, n;
+   CHECK(!block.fetch(c, seen));             // nothing published yet
+   CHECK(isWhole(c, n) && n == 99);
+   block.publish(makeCmd(1));
+   CHECK(block.fetch(c, seen));
+   CHECK(isWhole(c, n) && n == 1);
+   CHECK(!block.fetch(c, seen));             // already seen
+   block.publish(makeCmd(2));
+   block.publish(makeCmd(3));
+   CHECK(block.fetch(c, seen));              // only the newest matters
+   CHECK(isWhole(c, n) && n == 3);
+} // basicTest()
+
+int main()
+{
+   basicTest();
+   tearTest();
+   raceTest();
+   return testsDone("test_step_command");
+} // main()
@@ -0,0 +1,238 @@
+/*************************************************************************************************************************************
+ * @file test_step_generator.cpp
+ * @author va3wam
+ * @brief Host test of the stepGenerator backends: the mock (step_gen_mock.h), and the software ISR (step_gen_soft.h) against it
+ * @details The software ISR backend runs on test/host/Arduino.h's pretend timer and GPIO. The test calls its ISR once for
+ *          every stepTickUs microseconds of pretend time, and counts STEP rising edges and DIR levels on the pins. The same
+ *          commands go to the mock, which works out what the wheels should have done from the speeds alone. Tests:
+ *             mockTest()   the mock on its own: steps at the rate asked for, signs, stop, and ramping with setAccel()
+ *             speedTest()  stopped, mid and top speed (slowTicks 800, 550, fastTicks 300), forwards and back. The software
+ *                          ISR takes one tick more per step than it's asked for, the same as it always has, so it has to
+ *                          be within 1 / ticks of the mock. Every step counted is a STEP pulse, with DIR the right way
+ *             stopTest()   stop() stops both wheels straight away, part way through a step
+ *             reverseTest() a change of direction, and the wheel goes back, at a slow and a fast speed
+ *             accelTest()  with setAccel(), the ISR's stepRamp gets up to speed in about the time the mock does
+ *          A change of direction without setAccel() sets tickSetting to 9999, which is meant to cut the step going the wrong
+ *          way short. It's only picked up at the end of that step though. If the next control cycle's setTicks() comes
+ *          first, it's replaced and does nothing, and if not, the wheel waits 9999 ticks (0.2 s) before its first step the
+ *          new way. That's how it's always been, and it's left alone here: reverseTest() checks for both, and speedTest()
+ *          waits it out before it counts.
+ *          The benchmark prints host cycles per ISR call at each speed. The ISR costs the same at any speed, which is the
+ *          point of the hardware backends. They're for comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -pthread -Iinclude -Itest/host -o test_step_generator test/host/test_step_generator.cpp
+ *             ./test_step_generator
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <step_gen_soft.h> // what's being tested
+#include "step_gen_mock.h"
+#include "host_test.h"
+
+#define leftStep 12
+#define leftDir 13
+#define rightStep 14
+#define rightDir 15
+#define ticksPerSec (1000000 / stepTickUs)
+#define benchTicks 500000        // ISR calls per speed in the benchmark
+
+stepGenSoftISR soft(leftStep, leftDir, rightStep, rightDir);
+stepGenMock mock;
+hw_timer_t *softTimer = NULL;
+
+void runFor(uint32_t us)         // pretend time for both: soft's ISR every stepTickUs, and the mock all at once
+{  for (uint32_t t = 0; t < us / stepTickUs; t++) softTimer->isr();
+   mock.advance(us);
+}
+
+void setBoth(int left, int right)
+{  soft.setTicks(left, right);
+   mock.setTicks(left, right);
+}
+
+/**
+ * @brief Mock on its own
+=================================================================================================== */
+void mockTest()
+{
+   stepGenMock m;
+   int32_t l, r;
+   m.begin();
+   CHECK(m.begun);
+   m.setTicks(100, -200);                                    // 500 steps/s forward, 250 back
+   m.advance(1000000);
+   m.getSteps(l, r);
+   CHECK(l == 500 && r == -250);
+   m.advance(1000);                                          // half a step on the left, a quarter on the right, carried over
+   m.advance(1000);
+   m.getSteps(l, r);
+   CHECK(l == 501 && r == -250);
+   m.stop();
+   m.advance(1000000);
+   m.getSteps(l, r);
+   CHECK(l == 501 && r == -250);
+   CHECK(m.setTicksCalls == 1 && m.stopCalls == 1);
+   m.setAccel(1000);                                         // jump to 44.7 steps/s, 0.46 s on to 500, 124 steps, then 22
+   m.setTicks(100, 100);
+   m.advance(500000);
+   m.getSteps(l, r);
+   CHECK(abs(l - 501 - 146) <= 1);
+   CHECK_NEAR(m.speed[0], 500, 0.001);
+   m.stop();
+   m.setAccel(0);
+} // mockTest()
+
+/**
+ * @brief One second at each speed, soft against mock
+=================================================================================================== */
+void speedTest()
+{
+   static const int speeds[] = { 0, 800, 550, 300, -300, -550 };
+   for (int ticks : speeds)
+   {  setBoth(ticks, -ticks);
+      runFor(20000);                                         // next control cycle, which replaces a reversal's 9999
+      setBoth(ticks, -ticks);
+      runFor(250000);                                        // and wait out the 9999 tick step
+      int32_t sl0, sr0, ml0, mr0, sl, sr, ml, mr;
+      soft.getSteps(sl0, sr0);
+      mock.getSteps(ml0, mr0);
+      uint32_t leftRises = hostPins[leftStep].rises, rightRises = hostPins[rightStep].rises;
+      runFor(1000000);
+      soft.getSteps(sl, sr);
+      mock.getSteps(ml, mr);
+      int softL = sl - sl0, softR = sr - sr0, mockL = ml - ml0, mockR = mr - mr0;
+      int expect = ticks == 0 ? 0 : ticksPerSec / (abs(ticks) + 1) * (ticks < 0 ? -1 : 1);   // a step every ticks + 1
+      printf("ticks %4d: software ISR %d & %d steps, mock %d & %d\n", ticks, softL, softR, mockL, mockR);
+      CHECK(abs(softL - expect) <= 1 && abs(softR + expect) <= 1);
+      double tol = ticks == 0 ? 0 : abs(mockL) / (double)abs(ticks) + 2;
+      CHECK(abs(softL - mockL) <= tol && abs(softR - mockR) <= tol);
+      CHECK(hostPins[leftStep].rises - leftRises == (uint32_t)abs(softL));   // a STEP pulse for every step counted
+      CHECK(hostPins[rightStep].rises - rightRises == (uint32_t)abs(softR));
+      if (ticks != 0)
+      {  CHECK(hostPins[leftDir].level == (ticks > 0 ? HIGH : LOW));
+         CHECK(hostPins[rightDir].level == (ticks > 0 ? LOW : HIGH));
+      }
+   }
+} // speedTest()
+
+/**
+ * @brief stop() part way through a step
+=================================================================================================== */
+void stopTest()
+{
+   setBoth(800, 800);
+   runFor(1000000 + 7 * stepTickUs);
+   soft.stop();
+   mock.stop();
+   softTimer->isr();                                         // picked up on the next tick
+   int32_t l0, r0, l, r;
+   soft.getSteps(l0, r0);
+   uint32_t rises = hostPins[leftStep].rises;
+   runFor(1000000);
+   soft.getSteps(l, r);
+   CHECK(l == l0 && r == r0);
+   CHECK(hostPins[leftStep].rises == rises);
+   CHECK(hostPins[leftStep].level == LOW);                   // not left with STEP high
+} // stopTest()
+
+/**
+ * @brief Change of direction, with the next control cycle before and after the end of the step going forward
+=================================================================================================== */
+void reverseTest(int ticks)
+{
+   bool paused = (ticks + 1) * stepTickUs < 12000;           // step ends before the next cycle, so the 9999 is picked up
+   setBoth(ticks, ticks);
+   runFor(100000);
+   int32_t l0, r0, l, r;
+   soft.getSteps(l0, r0);
+   setBoth(-ticks, -ticks);                                  // 9999, till the end of the step going forward
+   runFor(12000);                                            // one control cycle later, the next setTicks()
+   setBoth(-ticks, -ticks);
+   runFor(180000);
+   soft.getSteps(l, r);
+   if (paused) CHECK(l >= l0 && l <= l0 + 1 && r >= r0 && r <= r0 + 1);   // still in the 9999 tick step
+   else CHECK(l < l0 - 5 && r < r0 - 5);                     // going back already
+   runFor(1000000 - 192000);
+   soft.getSteps(l, r);
+   int expect = (1000000 / stepTickUs - (paused ? 9999 : 0)) / (ticks + 1);   // steps back one second on, near enough
+   printf("reverse at ticks %d: %d steps back one second after the change, %d expected\n", ticks, l0 - l, expect);
+   CHECK(abs(l0 - l - expect) <= 3 && abs(r0 - r - expect) <= 3);
+   CHECK(hostPins[leftDir].level == LOW);
+   soft.stop();
+   mock.stop();
+   softTimer->isr();
+} // reverseTest()
+
+/**
+ * @brief Acceleration limited, from standing to top speed
+=================================================================================================== */
+void accelTest()
+{
+   soft.setAccel(1000);
+   mock.setAccel(1000);
+   softTimer->isr();                                         // picked up before the speed, as on the robot
+   int32_t sl0, sr0, ml0, mr0, sl, sr, ml, mr;
+   soft.getSteps(sl0, sr0);
+   mock.getSteps(ml0, mr0);
+   setBoth(300, 300);                                        // 166 steps/s, 0.12 s and 13 steps to get there
+   runFor(100000);
+   soft.getSteps(sl, sr);
+   mock.getSteps(ml, mr);
+   printf("accel: after 0.1 s, software ISR %d steps, mock %d\n", sl - sl0, ml - ml0);
+   CHECK(abs((sl - sl0) - (ml - ml0)) <= 2);
+   runFor(900000);
+   soft.getSteps(sl, sr);
+   mock.getSteps(ml, mr);
+   printf("accel: after 1 s, software ISR %d steps, mock %d\n", sl - sl0, ml - ml0);
+   CHECK(abs((sl - sl0) - (ml - ml0)) <= 4);
+   CHECK(sl - sl0 < ticksPerSec / 301);                      // less than a second at full speed
+   soft.setAccel(0);
+   mock.setAccel(0);
+   soft.stop();
+   mock.stop();
+   softTimer->isr();
+} // accelTest()
+
+/**
+ * @brief Host cycles per ISR call at each speed
+=================================================================================================== */
+void benchmark()
+{
+   static const int speeds[] = { 0, 550, 300 };
+   printf("%s per software ISR call:", benchUnits());
+   for (int ticks : speeds)
+   {  soft.setTicks(ticks, ticks);
+      uint64_t start = benchNow();
+      for (int n = 0; n < benchTicks; n++) softTimer->isr();
+      printf(" ticks %d %.1f", ticks, (double)(benchNow() - start) / benchTicks);
+   }
+   printf("\n");
+   soft.stop();
+} // benchmark()
+
+int main()
+{
+   mockTest();
+   soft.begin();
+   mock.begin();
+   softTimer = &hostTimers[0];
+   CHECK(softTimer->isr != NULL && softTimer->enabled);
+   CHECK(softTimer->alarm == stepTickUs && softTimer->autoReload && softTimer->divider == 80);
+   CHECK(strcmp(soft.name(), "software ISR") == 0);
+   speedTest();
+   stopTest();
+   reverseTest(800);
+   reverseTest(300);
+   accelTest();
+   benchmark();
+   return testsDone("test_step_generator");
+} // main()
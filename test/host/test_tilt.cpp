@@ -0,0 +1,181 @@
+/*************************************************************************************************************************************
+ * @file test_tilt.cpp
+ * @author va3wam
+ * @brief Host test and benchmark of the tilt from a DMP quaternion (balance_core.h) against the three call sequence it replaced
+ * @details readIMU()'s float path used to get the tilt with mpu.dmpGetQuaternion(&q), dmpGetGravity() and
+ *          dmpGetYawPitchRoll(), then roll - 90, folded past a face plant. threeCallTilt() below is those three, with the
+ *          library's formulas copied in, since they're MPU6050 members. Quaternions for a roll all the way round the circle,
+ *          with some yaw and pitch mixed in, go through that and through tiltFromQ14() (atan2f() and polyAtan2Deg()) and
+ *          tiltFromQ30(), and they have to agree to within:
+ *             q14Tol       tiltFromQ14() with atan2f(). The integer gravity math is exact, so only float rounding differs
+ *             polyTol      tiltFromQ14() with polyAtan2Deg()
+ *             cordicTol    tiltFromQ30(), the fixed point path's CORDIC. It gets the Q30 quaternion, which is 16 bits better
+ *                          than the Q14 one the three calls get, so it's compared with exactTilt() of the Q30 one instead
+ *          Within foldGap of the fold at roll -90 degrees (tilt -180 one side, +90 the other), rounding can put the two on
+ *          different sides, so those are left out. polyAtan2Deg() is also checked against atan2() on its own.
+ *          The benchmark prints host cycles per tilt for each. They're for comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_tilt test/host/test_tilt.cpp
+ *             ./test_tilt
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <balance_core.h> // what's being tested
+#include "../../lib/MPU6050/helper_3dmath.h" // Quaternion & VectorFloat, as readIMU() used them
+#include "host_test.h"
+
+#define q14Tol 0.001             // degrees
+#define polyTol 0.002
+#define cordicTol 0.003
+#define foldGap 0.01             // degrees either side of roll -90 not compared
+#define rollStep 0.01            // degrees between test rolls
+#define benchCount 4096          // quaternions in the benchmark
+#define benchRounds 200          // times round them
+
+/**
+ * @brief Tilt as readIMU() used to work it out, from the Q14 quaternion
+=================================================================================================== */
+float threeCallTilt(const int16_t *qI)
+{
+   Quaternion q;                                              // dmpGetQuaternion(Quaternion *, packet)
+   q.w = (float)qI[0] / 16384.0f;
+   q.x = (float)qI[1] / 16384.0f;
+   q.y = (float)qI[2] / 16384.0f;
+   q.z = (float)qI[3] / 16384.0f;
+   VectorFloat gravity;                                       // dmpGetGravity()
+   gravity.x = 2 * (q.x * q.z - q.w * q.y);
+   gravity.y = 2 * (q.w * q.x + q.y * q.z);
+   gravity.z = q.w * q.w - q.x * q.x - q.y * q.y + q.z * q.z;
+   float ypr[3];                                              // dmpGetYawPitchRoll()
+   ypr[0] = atan2(2 * q.x * q.y - 2 * q.w * q.z, 2 * q.w * q.w + 2 * q.x * q.x - 1);
+   ypr[1] = atan2(gravity.x, sqrt(gravity.y * gravity.y + gravity.z * gravity.z));
+   ypr[2] = atan2(gravity.y, gravity.z);
+   if (gravity.z < 0)
+   {  if (ypr[1] > 0) ypr[1] = PI - ypr[1];
+      else ypr[1] = -PI - ypr[1];
+   }
+   float tilt = ypr[2] * RAD_TO_DEG - 90.;                    // readIMU()'s adjustment
+   if (tilt < -180.) tilt = 90.;
+   return tilt;
+} // threeCallTilt()
+
+/**
+ * @brief Same tilt in double, from the Q30 quaternion, as the reference for tiltFromQ30()
+=================================================================================================== */
+double exactTilt(const int32_t *qI)
+{
+   double w = qI[0], x = qI[1], y = qI[2], z = qI[3];
+   double tilt = atan2(2 * (w * x + y * z), w * w - x * x - y * y + z * z) * RAD_TO_DEG - 90;
+   if (tilt < -180) tilt = 90;
+   return tilt;
+} // exactTilt()
+
+/**
+ * @brief Quaternion for roll about X, then some pitch and yaw, as Q14 and Q30 integers
+=================================================================================================== */
+void makeQuaternion(double rollDeg, double pitchDeg, double yawDeg, int16_t *q14, int32_t *q30)
+{
+   double r = rollDeg * DEG_TO_RAD / 2, p = pitchDeg * DEG_TO_RAD / 2, y = yawDeg * DEG_TO_RAD / 2;
+   double q[4] =
+   {  cos(r) * cos(p) * cos(y) + sin(r) * sin(p) * sin(y),
+      sin(r) * cos(p) * cos(y) - cos(r) * sin(p) * sin(y),
+      cos(r) * sin(p) * cos(y) + sin(r) * cos(p) * sin(y),
+      cos(r) * cos(p) * sin(y) - sin(r) * sin(p) * cos(y)
+   };
+   for (int i = 0; i < 4; i++)
+   {  q14[i] = (int16_t)lround(q[i] * 16384);
+      q30[i] = (int32_t)llround(q[i] * 1073741824.0);
+   }
+} // makeQuaternion()
+
+/**
+ * @brief polyAtan2Deg() against atan2() all the way round
+=================================================================================================== */
+void polyTest()
+{
+   double worst = 0;
+   for (double a = -180; a <= 180; a += rollStep / 10)
+   {  double y = sin(a * DEG_TO_RAD), x = cos(a * DEG_TO_RAD);
+      double err = fabs(polyAtan2Deg((float)y, (float)x) - atan2(y, x) * RAD_TO_DEG);
+      if (err > 180) err = 360 - err;                         // +180 and -180 are the same angle
+      if (err > worst) worst = err;
+   }
+   printf("polyAtan2Deg: worst error %.5f degrees\n", worst);
+   CHECK(worst < 0.001);
+   CHECK(polyAtan2Deg(0, 0) == 0);
+   CHECK_NEAR(polyAtan2Deg(1, 0), 90, 0.001);
+   CHECK_NEAR(polyAtan2Deg(-1, 0), -90, 0.001);
+   CHECK_NEAR(polyAtan2Deg(0, -1), 180, 0.001);
+} // polyTest()
+
+/**
+ * @brief Every roll round the circle, with and without yaw & pitch, against the three calls
+=================================================================================================== */
+void accuracyTest()
+{
+   static const double tips[][2] = { {0, 0}, {3, 0}, {0, 40}, {-5, 120} };   // pitch, yaw, degrees
+   double worstQ14 = 0, worstPoly = 0, worstQ30 = 0;
+   long compared = 0;
+   for (const double *tip : tips)
+   {  for (double roll = -180; roll <= 180; roll += rollStep)
+      {  if (fabs(roll + 90) < foldGap) continue;
+         int16_t q14[4];
+         int32_t q30[4];
+         makeQuaternion(roll, tip[0], tip[1], q14, q30);
+         double old = threeCallTilt(q14);
+         worstQ14 = fmax(worstQ14, fabs(tiltFromQ14(q14, false) - old));
+         worstPoly = fmax(worstPoly, fabs(tiltFromQ14(q14, true) - old));
+         worstQ30 = fmax(worstQ30, fabs(ctlToFloat(tiltFromQ30(q30)) - exactTilt(q30)));
+         compared++;
+      }
+   }
+   printf("%ld quaternions, worst against the three calls: tiltFromQ14 atan2f %.5f, polyAtan2Deg %.5f. tiltFromQ30 %.5f degrees\n",
+          compared, worstQ14, worstPoly, worstQ30);
+   CHECK(worstQ14 < q14Tol);
+   CHECK(worstPoly < polyTol);
+   CHECK(worstQ30 < cordicTol);
+} // accuracyTest()
+
+/**
+ * @brief Host cycles per tilt, each way
+=================================================================================================== */
+static int16_t benchQ[benchCount][4];
+
+template <typename fn> double benchTilt(fn tilt)
+{
+   double sum = 0;
+   uint64_t start = benchNow();
+   for (int r = 0; r < benchRounds; r++)
+      for (int n = 0; n < benchCount; n++) sum += tilt(benchQ[n]);
+   uint64_t took = benchNow() - start;
+   benchSink = sum;
+   return (double)took / ((double)benchRounds * benchCount);
+}
+
+void benchmark()
+{
+   int32_t q30[4];
+   for (int n = 0; n < benchCount; n++) makeQuaternion(-180 + 360.0 * n / benchCount, 2, 10, benchQ[n], q30);
+   double old = benchTilt([](const int16_t *q) { return threeCallTilt(q); });
+   double q14 = benchTilt([](const int16_t *q) { return tiltFromQ14(q, false); });
+   double poly = benchTilt([](const int16_t *q) { return tiltFromQ14(q, true); });
+   printf("%s per tilt: three calls %.1f, tiltFromQ14 atan2f %.1f, tiltFromQ14 polyAtan2Deg %.1f\n",
+          benchUnits(), old, q14, poly);
+} // benchmark()
+
+int main()
+{
+   polyTest();
+   accuracyTest();
+   benchmark();
+   return testsDone("test_tilt");
+} // main()
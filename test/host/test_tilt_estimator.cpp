@@ -0,0 +1,199 @@
+/*************************************************************************************************************************************
+ * @file test_tilt_estimator.cpp
+ * @author va3wam
+ * @brief Host test and benchmark of tilt_estimator.h's complementary filter, against the DMP roll for the same motion
+ * @details makeStream() makes what a recording of controlTask's raw reads would look like while balancing: every rawImuPeriod
+ *          (1 mS), accel y & z and gyro x as the MPU6050's int16 readings, and the DMP's tilt for the same moment. The robot
+ *          rocks a few degrees either side of vertical at a couple of frequencies, the accelerometer also feels the wheels
+ *          pushing it around, and both sensors have noise. The gyro has a bias, as the MPU6050's does after calibration
+ *          drifts. Tests:
+ *             steadyTest()  after settleSecs, the estimator's tilt against the DMP's. The average difference has to be within
+ *                           meanTol and the worst within worstTol. The gyro bias alone is worth bias * estTau degrees
+ *             knockTest()   after settleSecs still, a knock tips the robot knockDeg in knockMs. The estimator gets 90% of
+ *                           the way from where it was within lagTol mS of the DMP getting there. That's the gyro side
+ *             pullInTest()  seeded knockDeg out from where the accelerometer says and held still, the estimator has to
+ *                           be 1/e of the way there (63%) within tauTol of estTau. That's the accelerometer side
+ *          The benchmark prints host cycles per update(). They're for comparing with each other, not ESP32 cycles.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -Iinclude -Itest/host -o test_tilt_estimator test/host/test_tilt_estimator.cpp
+ *             ./test_tilt_estimator
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <Arduino.h>
+#include <tilt_estimator.h> // what's being tested
+#include "host_test.h"
+
+#define estTau 0.5f              // seconds, balance.estTau's default
+#define dt 0.001f                // seconds, rawImuPeriod
+#define streamSamples 20000      // 20 seconds
+#define settleSecs 3             // 6 estTau, for the seed's error to die away
+#define gyroBias 0.5f            // degrees per second
+#define accelNoise 0.01f         // g, peak, plus the wheels' push below
+#define pushG 0.03f              // g, peak, wheels accelerating the robot back and forth
+#define gyroNoise 0.3f           // degrees per second, peak
+#define meanTol 0.4              // degrees
+#define worstTol 1.0
+#define knockDeg 5.0f            // degrees
+#define knockMs 20
+#define lagTol 2                 // mS
+#define tauTol 0.05              // seconds
+#define benchRounds 20           // times round the stream
+
+typedef struct
+{
+   int16_t ay, az, gx;           // raw readings, as readRawIMU() gets them
+   float dmpTilt;                // the DMP's tilt for the same moment
+} rawSample;
+
+rawSample stream[streamSamples];
+
+uint32_t noise = 12345;
+float wobble(float peak)         // -peak .. +peak, same every run
+{  noise = noise * 1664525u + 1013904223u;
+   return ((noise >> 8) / 16777216.0f - 0.5f) * 2 * peak;
+}
+
+int16_t raw(float v) { return (int16_t)lroundf(v); }
+
+rawSample makeSample(float roll, float rollRate, float push)   // degrees, degrees per second, g sideways along the y axis
+{  rawSample s;
+   float r = roll * DEG_TO_RAD;
+   s.ay = raw((sinf(r) + push + wobble(accelNoise)) * accelLsbPerG);
+   s.az = raw((cosf(r) + wobble(accelNoise)) * accelLsbPerG);
+   s.gx = raw((rollRate + gyroBias + wobble(gyroNoise)) * gyroLsbPerDegSecRaw);
+   s.dmpTilt = roll - 90;
+   return s;
+}
+
+/**
+ * @brief Balancing, recorded: rocking at 1.3 & 4.1 Hz, with the wheels pushing at 0.7 Hz
+=================================================================================================== */
+void makeStream()
+{
+   for (int n = 0; n < streamSamples; n++)
+   {  float t = n * dt;
+      float a1 = 2 * PI * 1.3f, a2 = 2 * PI * 4.1f;
+      float roll = 90 + 2.0f * sinf(a1 * t) + 0.7f * sinf(a2 * t);
+      float rate = 2.0f * a1 * cosf(a1 * t) + 0.7f * a2 * cosf(a2 * t);
+      stream[n] = makeSample(roll, rate, pushG * sinf(2 * PI * 0.7f * t));
+   }
+} // makeStream()
+
+/**
+ * @brief Estimator's tilt against the DMP's, once the seed's error has gone
+=================================================================================================== */
+void steadyTest()
+{
+   tiltEstimator e;
+   e.setTimeConstant(estTau, dt);
+   e.seed(stream[0].ay, stream[0].az);
+   double sum = 0, worst = 0;
+   int counted = 0;
+   for (int n = 0; n < streamSamples; n++)
+   {  e.update(stream[n].ay, stream[n].az, stream[n].gx, dt);
+      if (n * dt < settleSecs) continue;
+      double err = e.tilt - stream[n].dmpTilt;
+      sum += err;
+      worst = fmax(worst, fabs(err));
+      counted++;
+   }
+   printf("steady: average difference %.3f, worst %.3f degrees over %d samples, gyro bias worth %.3f\n",
+          sum / counted, worst, counted, gyroBias * estTau);
+   CHECK(fabs(sum / counted) <= meanTol);
+   CHECK(worst <= worstTol);
+   CHECK(e.updates == streamSamples);
+} // steadyTest()
+
+int crossing(const float *tilt, int count, float level)   // first sample at or past level, going up
+{  for (int n = 0; n < count; n++) if (tilt[n] >= level) return n;
+   return count;
+}
+
+/**
+ * @brief Time from the DMP getting 90% of the way through a knock to the estimator getting there
+=================================================================================================== */
+void knockTest()
+{
+   const int still = settleSecs / dt, samples = still + 200;
+   static float dmp[samples], est[samples];
+   tiltEstimator e;
+   e.setTimeConstant(estTau, dt);
+   rawSample s = makeSample(90, 0, 0);
+   e.seed(s.ay, s.az);
+   for (int n = 0; n < samples; n++)
+   {  float t = (n - still) / (float)knockMs;                // 0 .. 1 through the knock, after settleSecs still
+      t = t < 0 ? 0 : t > 1 ? 1 : t;
+      float roll = 90 + knockDeg * (1 - cosf(PI * t)) / 2;     // smooth, so the rate's finite
+      float rate = t > 0 && t < 1 ? knockDeg * PI / 2 * sinf(PI * t) * 1000 / knockMs : 0;
+      s = makeSample(roll, rate, 0);
+      e.update(s.ay, s.az, s.gx, dt);
+      dmp[n] = s.dmpTilt;
+      est[n] = e.tilt;
+   }
+   float offset = est[still - 1];                             // gyro bias & noise, before the knock. Not lag
+   int lag = crossing(est, samples, offset + 0.9f * knockDeg) - crossing(dmp, samples, 0.9f * knockDeg);
+   printf("knock: %.1f degrees in %d mS, estimator %d mS behind the DMP at 90%%, from %.3f degrees out\n",
+          knockDeg, knockMs, lag, offset);
+   CHECK(abs(lag) <= lagTol);
+} // knockTest()
+
+/**
+ * @brief Time for the accelerometer to pull a wrong seed 63% of the way in
+=================================================================================================== */
+void pullInTest()
+{
+   tiltEstimator e;
+   e.setTimeConstant(estTau, dt);
+   rawSample off = makeSample(90 + knockDeg, 0, 0);
+   e.seed(off.ay, off.az);                                   // knockDeg out
+   float start = e.tilt;
+   int n = 0;
+   for (; n < 10 * estTau / dt; n++)
+   {  rawSample s = makeSample(90, 0, 0);
+      e.update(s.ay, s.az, raw(wobble(gyroNoise) * gyroLsbPerDegSecRaw), dt);   // still, so no bias either
+      if (e.tilt <= start / M_E) break;                     // the DMP says 0
+   }
+   printf("pull in: 63%% of %.1f degrees in %.3f seconds, estTau %.3f\n", knockDeg, n * dt, estTau);
+   CHECK_NEAR(n * dt, estTau, tauTol);
+} // pullInTest()
+
+/**
+ * @brief Host cycles per update()
+=================================================================================================== */
+void benchmark()
+{
+   tiltEstimator e;
+   e.setTimeConstant(estTau, dt);
+   e.seed(stream[0].ay, stream[0].az);
+   double best = 1e30;
+   for (int r = 0; r < benchRounds; r++)
+   {  float sum = 0;
+      uint64_t start = benchNow();
+      for (int n = 0; n < streamSamples; n++)
+      {  e.update(stream[n].ay, stream[n].az, stream[n].gx, dt);
+         sum += e.tilt;
+      }
+      best = fmin(best, (double)(benchNow() - start) / streamSamples);
+      benchSink = sum;
+   }
+   printf("%s per update: %.1f\n", benchUnits(), best);
+} // benchmark()
+
+int main()
+{
+   makeStream();
+   steadyTest();
+   knockTest();
+   pullInTest();
+   benchmark();
+   return testsDone("test_tilt_estimator");
+} // main()
@@ -0,0 +1,109 @@
+/*************************************************************************************************************************************
+ * @file test_wheel_odometry.cpp
+ * @author va3wam
+ * @brief Host test of wheelOdometry (wheel_odometry.h): speed over the window, and whole snapshots across threads
+ * @details speedTest() feeds update() steady and changing step counts and checks the speeds against what they should be.
+ *          snapshotTest() has one thread calling update() as fast as it can, as controlTask does, while another calls
+ *          latest(), as housekeepingTask does on the other core. Every snapshot the reader gets has to be one update()
+ *          actually published: the counts, time and speeds all have to agree with each other.
+ *
+ *          To build and run, on Linux, from the repo's top folder (or use test/host/run_tests.sh):
+ *             g++ -O2 -pthread -Iinclude -Itest/host -o test_wheel_odometry test/host/test_wheel_odometry.cpp
+ *             ./test_wheel_odometry
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <atomic>
+#include <thread>
+#include <Arduino.h>
+#include <wheel_odometry.h> // what's being tested
+#include "host_test.h"
+
+#define cycleUs 12000            // update() every tmrIMU = 12 mS
+#define raceMs 500               // how long the writer and reader race
+#define raceUs 10                // update() spacing in the race, small enough that micros() can't wrap in raceMs
+
+/**
+ * @brief Speeds from known step counts
+=================================================================================================== */
+void speedTest()
+{
+   wheelOdometry odo;
+   wheelSnapshot s = {0, 0, 0, 0, 0};
+   uint32_t seen = 0;
+   CHECK(!odo.latest(s, seen));                            // nothing yet
+   uint32_t us = 1000;
+   for (int n = 0; n < 3 * odoWindow; n++)                 // 5 steps per cycle forward on the left, 2 back on the right
+   {  odo.update(us, 5 * n, -2 * n);
+      us += cycleUs;
+   }
+   CHECK(odo.latest(s, seen));
+   CHECK(s.leftSteps == 5 * (3 * odoWindow - 1));
+   CHECK(s.rightSteps == -2 * (3 * odoWindow - 1));
+   CHECK_NEAR(s.leftSpeed, 5 * 1000000.0 / cycleUs, 0.01);
+   CHECK_NEAR(s.rightSpeed, -2 * 1000000.0 / cycleUs, 0.01);
+   CHECK(!odo.latest(s, seen));                            // already seen
+   int32_t left = s.leftSteps;
+   for (int n = 0; n < odoWindow / 2; n++)                 // stop the left wheel. Half the window is still moving
+   {  odo.update(us, left, 0);
+      us += cycleUs;
+   }
+   CHECK(odo.latest(s, seen));
+   CHECK(s.leftSpeed > 0 && s.leftSpeed < 5 * 1000000.0 / cycleUs);
+   for (int n = 0; n < odoWindow; n++)                     // and long enough for the whole window to see it stopped
+   {  odo.update(us, left, 0);
+      us += cycleUs;
+   }
+   CHECK(odo.latest(s, seen));
+   CHECK_NEAR(s.leftSpeed, 0, 0.001);
+   CHECK_NEAR(s.rightSpeed, 0, 0.001);
+} // speedTest()
+
+/**
+ * @brief update() and latest() in different threads
+=================================================================================================== */
+void snapshotTest()
+{
+   wheelOdometry odo;
+   std::atomic<bool> updating(true);
+   std::thread updater([&]
+   {  unsigned long start = millis();
+      uint32_t n = 0;
+      while (millis() - start < raceMs)
+      {  n++;
+         odo.update(n * raceUs, 3 * n, -7 * (int32_t)n);   // every field follows from n
+      }
+      updating = false;
+   });
+   wheelSnapshot s = {0, 0, 0, 0, 0};
+   uint32_t seen = 0;
+   long got = 0, bad = 0;
+   while (updating)
+   {  if (!odo.latest(s, seen)) continue;
+      got++;
+      uint32_t n = s.us / raceUs;
+      bool whole = s.us == n * raceUs && s.leftSteps == 3 * (int32_t)n && s.rightSteps == -7 * (int32_t)n;
+      if (n > odoWindow)                                   // window's full, so speeds are steady
+         whole = whole && fabs(s.leftSpeed - 3 * 1000000.0 / raceUs) < 1
+                       && fabs(s.rightSpeed + 7 * 1000000.0 / raceUs) < 1;
+      if (!whole) bad++;
+   }
+   updater.join();
+   printf("snapshots: %ld read, %ld not whole\n", got, bad);
+   CHECK(got > 0);
+   CHECK(bad == 0);
+} // snapshotTest()
+
+int main()
+{
+   speedTest();
+   snapshotTest();
+   return testsDone("test_wheel_odometry");
+} // main()
@@ -0,0 +1,208 @@
+/*************************************************************************************************************************************
+ * @file lqr_gains.cpp
+ * @author va3wam
+ * @brief Host side tool that works out bm_state gains for the robot by discrete LQR, and prints them as setvar commands
+ * @details Models the robot as an inverted pendulum on the wheel axle, with wheel acceleration as the input. Steppers are
+ *          told a speed each cycle, so the firmware integrates the acceleration into that speed (see state_feedback.h).
+ *          State is tilt (rad), tilt rate (rad/s), wheel position (m) and wheel speed (m/s):
+ *             tilt''  = (g * tilt - accel) / l      l = heightCOM - wheelDiameter / 2, i.e. COM height above the axle
+ *             pos''   = accel
+ *          That's discretized at tmrIMU with a zero order hold, the discrete Riccati equation is iterated until it settles,
+ *          and the gains are converted to the firmware's units: degrees, inches and seconds.
+ *          Weights are by Bryson's rule: each state and the input are weighted by 1 / (largest acceptable value)^2.
+ *          With acceleration as the input, mass drops out of the model. It's used to check the result: a simulated
+ *          recovery from a 2 degree lean gives the peak wheel acceleration, and so the torque each motor needs.
+ *
+ *          To build and run, on Linux:
+ *             g++ -O2 -o lqr_gains tools/lqr_gains/lqr_gains.cpp
+ *             ./lqr_gains height=5 wheel=3.937 mass=1.2 tmr=12
+ *          All arguments are optional name=value pairs:
+ *          | Name   | Default | Meaning                                                        |
+ *          |:-------|:--------|:---------------------------------------------------------------|
+ *          | height | 5       | attribute.heightCOM, inches from the ground to Centre Of Mass  |
+ *          | wheel  | 3.937   | attribute.wheelDiameter, inches                                |
+ *          | mass   | 1.0     | robot mass, kg, for the torque check only                      |
+ *          | tmr    | 12      | balance.tmrIMU, milliseconds per control cycle                 |
+ *          | tilt   | 2       | Bryson: largest acceptable tilt, degrees                       |
+ *          | rate   | 60      | Bryson: largest acceptable tilt rate, degrees/second           |
+ *          | pos    | 6       | Bryson: largest acceptable wander from the hold point, inches  |
+ *          | vel    | 10      | Bryson: largest acceptable wheel speed, inches/second          |
+ *          | accel  | 200     | Bryson: largest acceptable wheel acceleration, inches/s/s      |
+ * @version 0.0.1
+ * @date 2026-10-16
+ * @copyright Copyright (c) 2020
+ * @note Change history uses Semantic Versioning
+ * @ref https://semver.org/
+ * Version YYYY-MM-DD Description
+ * ------- ---------- ----------------------------------------------------------------------------------------------------------------
+ * 0.0.1   2026-10-16 File created
+ *************************************************************************************************************************************/
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#define N 4                     // number of states
+#define metresPerInch 0.0254
+#define gravity 9.80665         // m/s/s
+
+typedef double mat[N][N];
+typedef double vec[N];
+
+/**
+ * @brief Parameters, with their defaults, and what each one is called on the command line
+=================================================================================================== */
+struct toolParam
+{
+   const char *name;
+   double value;
+} params[] =
+{
+   {"height", 5}, {"wheel", 3.937}, {"mass", 1.0}, {"tmr", 12},
+   {"tilt", 2}, {"rate", 60}, {"pos", 6}, {"vel", 10}, {"accel", 200}
+};
+#define paramCount (int)(sizeof(params) / sizeof(params[0]))
+
+double param(const char *name)
+{
+   for (int p = 0; p < paramCount; p++) if (strcmp(params[p].name, name) == 0) return params[p].value;
+   return 0;
+} // param()
+
+/**
+ * @brief Discretize x' = A x + B u with a zero order hold over dt, by power series. A dt is small, so it converges fast
+=================================================================================================== */
+void discretize(const mat A, const vec B, double dt, mat Ad, vec Bd)
+{
+   mat term;                    // (A dt)^k / k!
+   for (int r = 0; r < N; r++)
+   {  Bd[r] = B[r] * dt;
+      for (int c = 0; c < N; c++) Ad[r][c] = term[r][c] = r == c ? 1 : 0;
+   }
+   for (int k = 1; k < 30; k++)
+   {  mat next;
+      for (int r = 0; r < N; r++)
+         for (int c = 0; c < N; c++)
+         {  next[r][c] = 0;
+            for (int i = 0; i < N; i++) next[r][c] += term[r][i] * A[i][c] * dt / k;
+         }
+      memcpy(term, next, sizeof(mat));
+      for (int r = 0; r < N; r++)
+      {  for (int c = 0; c < N; c++) Ad[r][c] += term[r][c];
+         for (int i = 0; i < N; i++) Bd[r] += term[r][i] * B[i] * dt / (k + 1);   // integral of e^(A s) B over dt
+      }
+   }
+} // discretize()
+
+/**
+ * @brief Iterate the discrete algebraic Riccati equation until P settles, and return the LQR gains K, for u = -K x
+ * @return number of iterations, or 0 if it didn't converge
+=================================================================================================== */
+int dlqr(const mat A, const vec B, const vec Q, double R, vec K)
+{
+   mat P;
+   for (int r = 0; r < N; r++) for (int c = 0; c < N; c++) P[r][c] = r == c ? Q[r] : 0;
+   for (int it = 1; it <= 100000; it++)
+   {  vec PB, BtPA;
+      double BtPB = 0;
+      for (int r = 0; r < N; r++)
+      {  PB[r] = 0;
+         for (int i = 0; i < N; i++) PB[r] += P[r][i] * B[i];
+         BtPB += B[r] * PB[r];
+      }
+      for (int c = 0; c < N; c++)
+      {  BtPA[c] = 0;
+         for (int i = 0; i < N; i++) BtPA[c] += PB[i] * A[i][c];        // P is symmetric, so B'P = (PB)'
+      }
+      for (int c = 0; c < N; c++) K[c] = BtPA[c] / (R + BtPB);
+      mat Acl;                                                          // closed loop A - B K
+      for (int r = 0; r < N; r++) for (int c = 0; c < N; c++) Acl[r][c] = A[r][c] - B[r] * K[c];
+      mat next;                                                         // Q + K'RK + Acl'P Acl, which stays symmetric
+      double change = 0;
+      for (int r = 0; r < N; r++)
+         for (int c = 0; c < N; c++)
+         {  double AtPA = 0;
+            for (int i = 0; i < N; i++)
+               for (int j = 0; j < N; j++) AtPA += Acl[i][r] * P[i][j] * Acl[j][c];
+            next[r][c] = (r == c ? Q[r] : 0) + K[r] * R * K[c] + AtPA;
+            if (!std::isfinite(next[r][c])) return 0;
+            change = fmax(change, fabs(next[r][c] - P[r][c]) / fmax(1, fabs(P[r][c])));
+         }
+      memcpy(P, next, sizeof(mat));
+      if (change < 1e-12) return it;
+   }
+   return 0;
+} // dlqr()
+
+int main(int argc, char **argv)
+{
+   for (int a = 1; a < argc; a++)
+   {  const char *eq = strchr(argv[a], '=');
+      int p = 0;
+      while (eq && p < paramCount && (strncmp(params[p].name, argv[a], eq - argv[a]) != 0
+             || strlen(params[p].name) != (size_t)(eq - argv[a]))) p++;
+      if (!eq || p == paramCount)
+      {  fprintf(stderr, "lqr_gains: don't know %s. Arguments are name=value, with names:", argv[a]);
+         for (int q = 0; q < paramCount; q++) fprintf(stderr, " %s", params[q].name);
+         fprintf(stderr, "\n");
+         return 1;
+      }
+      params[p].value = atof(eq + 1);
+   }
+
+   double l = (param("height") - param("wheel") / 2) * metresPerInch;   // pendulum length, axle to COM
+   double r = param("wheel") / 2 * metresPerInch;
+   double dt = param("tmr") / 1000;
+   if (l <= 0 || dt <= 0)
+   {  fprintf(stderr, "lqr_gains: height must be more than wheel / 2, and tmr more than 0\n");
+      return 1;
+   }
+
+   mat A = {{0, 1, 0, 0}, {gravity / l, 0, 0, 0}, {0, 0, 0, 1}, {0, 0, 0, 0}};
+   vec B = {0, -1 / l, 0, 1};
+   double deg = M_PI / 180;
+   vec Q = {1 / pow(param("tilt") * deg, 2), 1 / pow(param("rate") * deg, 2),
+            1 / pow(param("pos") * metresPerInch, 2), 1 / pow(param("vel") * metresPerInch, 2)};
+   double R = 1 / pow(param("accel") * metresPerInch, 2);
+
+   mat Ad;
+   vec Bd, K;
+   discretize(A, B, dt, Ad, Bd);
+   int iterations = dlqr(Ad, Bd, Q, R, K);
+   if (iterations == 0)
+   {  fprintf(stderr, "lqr_gains: Riccati equation didn't settle. Try different weights\n");
+      return 1;
+   }
+
+   // check: recover from a 2 degree lean, and see how hard the wheels have to work
+   vec x = {2 * deg, 0, 0, 0};
+   double peakAccel = 0, peakSpeed = 0;
+   for (int t = 0; t < (int)(5 / dt); t++)
+   {  double u = 0;
+      for (int i = 0; i < N; i++) u -= K[i] * x[i];
+      vec next;
+      for (int i = 0; i < N; i++)
+      {  next[i] = Bd[i] * u;
+         for (int j = 0; j < N; j++) next[i] += Ad[i][j] * x[j];
+      }
+      memcpy(x, next, sizeof(vec));
+      peakAccel = fmax(peakAccel, fabs(u));
+      peakSpeed = fmax(peakSpeed, fabs(x[3]));
+   }
+   double torque = param("mass") * peakAccel * r / 2;                   // per motor, ignoring wheel inertia
+
+   // gains in firmware units: accel in inches/s/s, from degrees, degrees/s, inches and inches/s
+   double k[N] = {K[0] * deg / metresPerInch, K[1] * deg / metresPerInch, K[2], K[3]};
+   printf("# pendulum %.2f in above axle, tmrIMU %g ms, Riccati settled in %d iterations\n", l / metresPerInch,
+          param("tmr"), iterations);
+   printf("# 2 degree recovery: peak wheel acceleration %.1f in/s/s, speed %.1f in/s, torque %.3f N.m (%.1f oz.in) per motor\n",
+          peakAccel / metresPerInch, peakSpeed / metresPerInch, torque, torque * 141.612);
+   printf("# final state after 5 s: tilt %.4f deg, position %.4f in\n", x[0] / deg, x[2] / metresPerInch);
+   printf("setvar,BALANCE.LQRTILT,%.6g\n", k[0]);
+   printf("setvar,BALANCE.LQRRATE,%.6g\n", k[1]);
+   printf("setvar,BALANCE.LQRPOS,%.6g\n", k[2]);
+   printf("setvar,BALANCE.LQRVEL,%.6g\n", k[3]);
+   printf("setvar,BALANCE.METHOD,3\n");
+   return 0;
+} // main()